@@ -5,6 +5,7 @@
 #include "core/math/vec4.h"
 #include "core/container/slice.h"
 #include "core/container/vector.h"
+#include "core/container/bitset.h"
 
 struct SurfaceTriMesh;
 
@@ -86,7 +87,7 @@ class SurfaceCrossField {
 
 	vector<vec3> centers;
 	vector<Cross> edge_flux_boundary;
-    vector<uint> edge_flux_stencil[2];
+    dynamic_bitset edge_flux_stencil[2];
 	vector<Cross> theta_cell_center[2];
 	vector<float> distance_cell_center[2];
 	bool current;
@@ -12,8 +12,8 @@ SurfaceCrossField::SurfaceCrossField(SurfaceTriMesh& mesh, CFDDebugRenderer& deb
 	centers.resize(mesh.tri_count);
 	theta_cell_center[0].resize(mesh.tri_count);
 	theta_cell_center[1].resize(mesh.tri_count);
-    edge_flux_stencil[0].resize(mesh.tri_count / 32 + 1);
-    edge_flux_stencil[1].resize(mesh.tri_count / 32 + 1);
+    edge_flux_stencil[0].resize(mesh.tri_count);
+    edge_flux_stencil[1].resize(mesh.tri_count);
 	distance_cell_center[0].resize(mesh.tri_count);
 	distance_cell_center[1].resize(mesh.tri_count);
 
@@ -38,31 +38,19 @@ struct PropagateJob {
     edge_handle* edges;
     Cross* edge_flux_boundary;
     Cross* cross_center_in;
-    uint* active_in;
+    const dynamic_bitset* active_in;
     
     Cross* cross_center_out;
-    uint* active_out;
+    dynamic_bitset* active_out;
     float residual;
 };
 
 void propagate_cross(PropagateJob& job) {
     float residual = 0.0f;
-    uint nskipped = false;
+    uint nskipped = (job.end - job.begin) - job.active_in->count(job.begin, job.end);
     
-    for (uint i = job.begin; i < job.end; i++) {
-        uint active = job.active_in[i / 32];
-        uint mask = 1 << i%32;
-        if (!active && i%32 == 0) {
-            i += 31;
-            nskipped += 32;
-            continue;
-        }
-        if (!(active & mask)) {
-            nskipped++;
-            continue;
-        }
-        
-        job.active_out[i / 32] |= mask;
+    for (uint i = job.active_in->find_next(job.begin); i < job.end; i = job.active_in->find_next(i + 1)) {
+        job.active_out->set(i);
 
         Cross cross1 = job.cross_center_in[i];
         vec3 center = job.centers[i];
@@ -78,7 +66,6 @@ void propagate_cross(PropagateJob& job) {
             edge_handle edge = i*3 + j;
             edge_handle opp_edge = job.edges[edge];
             uint opp_cell = opp_edge / 3;
-            uint mask = 1 << opp_cell % 32;
             
             Cross edge_flux_boundary = job.edge_flux_boundary[edge];
             Cross opp_cross = job.cross_center_in[opp_cell];
@@ -86,7 +73,7 @@ void propagate_cross(PropagateJob& job) {
             bool is_boundary_edge = !(edge_flux_boundary.tangent == 0.0);
             bool active = !(opp_cross.tangent == 0.0);
             
-            job.active_out[opp_cell / 32] |= mask;
+            job.active_out->set(opp_cell);
             
             if (!is_boundary_edge && !active) continue;
             
@@ -213,8 +200,8 @@ void SurfaceCrossField::propagate() {
         tri1 /= 3;
         tri2 /= 3;
 
-        edge_flux_stencil[!current][tri1 / 32] |= 1 << tri1 % 32;
-        edge_flux_stencil[!current][tri2 / 32] |= 1 << tri2 % 32;
+        edge_flux_stencil[!current].set(tri1);
+        edge_flux_stencil[!current].set(tri2);
         
 		//edge_flux_stencil[edge] = true;
 		//edge_flux_stencil[mesh.edges[edge]] = true;
@@ -251,8 +238,8 @@ void SurfaceCrossField::propagate() {
             job.edges = mesh.edges;
             job.cross_center_in = theta_cell_center[past].data;
             job.cross_center_out = theta_cell_center[current].data;
-            job.active_in = edge_flux_stencil[past].data;
-            job.active_out = edge_flux_stencil[current].data;
+            job.active_in = &edge_flux_stencil[past];
+            job.active_out = &edge_flux_stencil[current];
             
             jobs[i] = JobDesc(propagate_cross, &job);
         }
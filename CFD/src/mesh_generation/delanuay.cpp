@@ -2,6 +2,7 @@
 #include "core/math/vec3.h"
 #include <glm/mat3x3.hpp>
 #include "core/memory/allocator.h"
+#include "core/memory/memory_tracking.h"
 #include "core/container/tvector.h"
 #include "core/container/hash_map.h"
 #include "core/algorithm.h"
@@ -1059,7 +1060,7 @@ Delaunay* make_Delaunay(CFDVolume& volume, const AABB& aabb, CFDDebugRenderer& d
 
 	//Delaunay::Delaunay(CFDVolume& volume, const AABB& aabb) : vertices(volume.vertices), volume(volume) {
     
-	Delaunay* d = PERMANENT_ALLOC(Delaunay, { volume, volume.vertices, debug });
+	Delaunay* d = TAGGED_ALLOC(MEMORY_CFD, Delaunay, { volume, volume.vertices, debug });
 	d->vertices = volume.vertices;
 	d->max_shared_face = kb(64);
 	d->aabb = aabb;
@@ -3,6 +3,7 @@
 #include "core/math/aabb.h"
 #include "geo/predicates.h"
 #include "core/container/tvector.h"
+#include "core/container/sort.h"
 
 /* create a nextbefore macro
  * for a strictly positive value, round to previous double value */
@@ -296,9 +297,7 @@ void brio_vertices(CFDVolume& mesh, const AABB& aabb, slice<vertex_handle> verti
     uint32_t nbits=0;
     hilbert_dist(mesh, aabb, vert_dist, n, &nbits);
 
-    std::sort(vert_dist, vert_dist + n, [&](const VertDist& a, const VertDist& b) {
-        return a.dist < b.dist;
-    });
+    radix_sort_by_key(vert_dist, n, [](const VertDist& a) { return a.dist; });
 
     for (uint i = 0; i < n; i++) {
         vertices[i] = vert_dist[i].vert;
@@ -7,6 +7,7 @@
 #include "graphics/renderer/renderer.h"
 #include "graphics/assets/assets.h"
 #include "core/time.h"
+#include "core/memory/memory_tracking.h"
 #include <glm/gtc/matrix_transform.hpp>
 
 struct CFDRenderBackend {
@@ -32,7 +33,7 @@ struct CFDRenderBackend {
 };
 
 CFDRenderBackend* make_cfd_render_backend(const CFDRenderBackendOptions& options) {
-    CFDRenderBackend* backend = PERMANENT_ALLOC(CFDRenderBackend);
+    CFDRenderBackend* backend = TAGGED_ALLOC(MEMORY_CFD, CFDRenderBackend);
 
     VertexLayoutDesc triangle_vertex_layout = {
         {
@@ -7,6 +7,7 @@
 #include "components/transform.h"
 #include "ecs/ecs.h"
 #include "core/time.h"
+#include "core/memory/memory_tracking.h"
 #include "cfd_ids.h"
 
 #include "core/math/vec3.h"
@@ -23,7 +24,7 @@ struct CFDVisualization {
 };
 
 CFDVisualization* make_cfd_visualization(CFDRenderBackend& backend) {
-    CFDVisualization* visualization = PERMANENT_ALLOC(CFDVisualization, {backend});
+    CFDVisualization* visualization = TAGGED_ALLOC(MEMORY_CFD, CFDVisualization, {backend});
     alloc_triangle_buffer(backend, visualization->triangles, mb(200), mb(200));
     alloc_line_buffer(backend, visualization->lines, mb(200), mb(200));
 
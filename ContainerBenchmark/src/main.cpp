@@ -0,0 +1,151 @@
+#include "core/core.h"
+#include "core/container/hash_map.h"
+#include "core/container/flat_hash_map.h"
+#include "core/memory/allocator.h"
+#include "core/context.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//CONTAINER BENCHMARKS
+//Results are written as one JSON object per line, in the same format as JobBenchmark.
+//usage: ContainerBenchmark [--out results.json]
+
+FILE* out = stdout;
+
+u64 now_ns() {
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void report(const char* benchmark, float load_factor, u64 iterations, double value, const char* unit) {
+	fprintf(out, "{\"benchmark\":\"%s\",\"load_factor\":%.2f,\"iterations\":%llu,\"value\":%.3f,\"unit\":\"%s\"}\n",
+		benchmark, load_factor, (unsigned long long)iterations, value, unit);
+	fflush(out);
+}
+
+//HASH MAPS
+//Keys are spaced like heap pointers, the low bits carry no information.
+//The fixed tables all have the same prime capacity, the flat map is reserved for the same number of keys.
+
+constexpr uint HASH_BENCH_CAPACITY = 4093;
+constexpr uint HASH_BENCH_REPEAT = 200;
+
+u64 bench_key(uint i) { return 0x7f0000000000ull + (u64)i * 64; }
+u64 bench_missing_key(uint i) { return 0x7f0000000000ull + (u64)i * 64 + 32; }
+
+//Previous fixed table, linear probing over 64 bit hashes with a prime modulo
+struct OldHashMap : hash_map_base<u64, u64> {
+	hash_meta meta_storage[HASH_BENCH_CAPACITY];
+	u64 key_storage[HASH_BENCH_CAPACITY];
+	u64 value_storage[HASH_BENCH_CAPACITY];
+
+	OldHashMap() : hash_map_base(HASH_BENCH_CAPACITY, meta_storage, key_storage, value_storage) {
+		hash_map_base::clear();
+	}
+
+	u64* get(u64 key) {
+		int i = this->index(key);
+		return i != -1 ? &values[i] : nullptr;
+	}
+};
+
+using FixedHashMap = hash_map<u64, u64, HASH_BENCH_CAPACITY>;
+
+struct HashBenchResult {
+	double insert;
+	double lookup_hit;
+	double lookup_miss;
+	u64 checksum;
+};
+
+template<typename Map>
+HashBenchResult bench_hash_map(Map& map, uint count) {
+	HashBenchResult result = {};
+	u64 insert_ns = 0, hit_ns = 0, miss_ns = 0;
+
+	for (uint repeat = 0; repeat < HASH_BENCH_REPEAT; repeat++) {
+		map.clear();
+
+		u64 start = now_ns();
+		for (uint i = 0; i < count; i++) map[bench_key(i)] = i;
+		u64 inserted = now_ns();
+
+		for (uint i = 0; i < count; i++) result.checksum += *map.get(bench_key(i));
+		u64 hit = now_ns();
+
+		for (uint i = 0; i < count; i++) result.checksum += map.get(bench_missing_key(i)) != nullptr;
+		u64 miss = now_ns();
+
+		insert_ns += inserted - start;
+		hit_ns += hit - inserted;
+		miss_ns += miss - hit;
+	}
+
+	u64 ops = (u64)count * HASH_BENCH_REPEAT;
+	result.insert = (double)insert_ns / ops;
+	result.lookup_hit = (double)hit_ns / ops;
+	result.lookup_miss = (double)miss_ns / ops;
+	return result;
+}
+
+void report_hash_map(const char* name, float load_factor, uint count, HashBenchResult result) {
+	char benchmark[64];
+	u64 ops = (u64)count * HASH_BENCH_REPEAT;
+
+	snprintf(benchmark, sizeof(benchmark), "%s_insert", name);
+	report(benchmark, load_factor, ops, result.insert, "ns/op");
+	snprintf(benchmark, sizeof(benchmark), "%s_lookup_hit", name);
+	report(benchmark, load_factor, ops, result.lookup_hit, "ns/op");
+	snprintf(benchmark, sizeof(benchmark), "%s_lookup_miss", name);
+	report(benchmark, load_factor, ops, result.lookup_miss, "ns/op");
+}
+
+void bench_hash_maps() {
+	static OldHashMap old_map;
+	static FixedHashMap fixed_map;
+	const float load_factors[] = { 0.25f, 0.5f, 0.75f, 0.9f };
+
+	for (float load_factor : load_factors) {
+		uint count = (uint)(HASH_BENCH_CAPACITY * load_factor);
+
+		flat_hash_map<u64, u64> flat_map;
+		flat_map.reserve(count);
+
+		report_hash_map("hash_map_linear_probing", load_factor, count, bench_hash_map(old_map, count));
+		report_hash_map("hash_map_fixed", load_factor, count, bench_hash_map(fixed_map, count));
+		report_hash_map("flat_hash_map", load_factor, count, bench_hash_map(flat_map, count));
+	}
+}
+
+void run_benchmarks() {
+	bench_hash_maps();
+}
+
+int main(int argc, char** argv) {
+	const char* out_path = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) out_path = argv[++i];
+		else {
+			fprintf(stderr, "usage: %s [--out results.json]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (out_path) {
+		out = fopen(out_path, "a");
+		if (!out) {
+			fprintf(stderr, "Could not open %s\n", out_path);
+			return 1;
+		}
+	}
+
+	get_context().allocator = &default_allocator;
+
+	run_benchmarks();
+
+	if (out != stdout) fclose(out);
+	return 0;
+}
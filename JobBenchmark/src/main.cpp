@@ -0,0 +1,293 @@
+#include "core/core.h"
+#include "core/job_system/job.h"
+#include "core/job_system/fiber.h"
+#include "core/job_system/work_stealing_queue.h"
+#include "core/container/queue.h"
+#include "core/memory/linear_allocator.h"
+#include "core/context.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//JOB SYSTEM BENCHMARKS
+//Results are written as one JSON object per line, so runs can be appended to a single file and diffed.
+//usage: JobBenchmark [--workers N] [--out results.json] [--scaling]
+//--scaling re-launches the benchmark for every worker count from 1 to N, the job system can only be created once.
+
+FILE* out = stdout;
+uint num_workers = 0;
+
+u64 now_ns() {
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void report(const char* benchmark, u64 iterations, double value, const char* unit) {
+	fprintf(out, "{\"benchmark\":\"%s\",\"workers\":%u,\"iterations\":%llu,\"value\":%.3f,\"unit\":\"%s\"}\n",
+		benchmark, num_workers, (unsigned long long)iterations, value, unit);
+	fflush(out);
+}
+
+//QUEUES
+
+struct BenchJob {
+	u64 time;
+};
+
+using BenchQueue = work_stealing_queue<1024, BenchJob>;
+
+void bench_work_stealing_queue() {
+	static BenchQueue stealing_queue;
+	const u64 iterations = 10000000;
+
+	u64 start = now_ns();
+	for (u64 i = 0; i < iterations; i++) {
+		BenchJob job = { i };
+		stealing_queue.push(job);
+		stealing_queue.pop(&job);
+	}
+	u64 end = now_ns();
+
+	report("work_stealing_queue_push_pop", iterations, (double)(end - start) / iterations, "ns/op");
+}
+
+//Time from the owner publishing a job to another thread stealing it
+void bench_steal_latency() {
+	static BenchQueue stealing_queue;
+	const u64 iterations = 100000;
+
+	std::atomic<bool> stolen = false;
+	std::atomic<u64> total_latency = 0;
+
+	std::thread thief([&]() {
+		for (u64 i = 0; i < iterations; i++) {
+			BenchJob job;
+			while (!stealing_queue.steal(&job)) {}
+
+			total_latency += now_ns() - job.time;
+			stolen.store(true, std::memory_order_release);
+		}
+	});
+
+	for (u64 i = 0; i < iterations; i++) {
+		stealing_queue.push({ now_ns() });
+		while (!stolen.load(std::memory_order_acquire)) {}
+		stolen.store(false, std::memory_order_relaxed);
+	}
+
+	thief.join();
+
+	report("steal_latency", iterations, (double)total_latency / iterations, "ns");
+}
+
+void bench_mpmc_queue() {
+	static queue<BenchJob, 1024> mpmc_queue;
+	const u64 iterations = 1000000;
+
+	u64 start = now_ns();
+
+	std::thread consumer([&]() {
+		BenchJob job;
+		for (u64 i = 0; i < iterations; i++) {
+			while (!mpmc_queue.dequeue(&job)) {}
+		}
+	});
+
+	for (u64 i = 0; i < iterations; i++) {
+		while (!mpmc_queue.enqueue({ i })) {}
+	}
+
+	consumer.join();
+	u64 end = now_ns();
+
+	report("mpmc_queue_transfer", iterations, (double)(end - start) / iterations, "ns/op");
+}
+
+//FIBERS
+
+Fiber* bench_main_fiber;
+Fiber* bench_ping_fiber;
+
+void ping_fiber(void*) {
+	while (true) switch_to_fiber(bench_main_fiber);
+}
+
+void bench_fiber_switch() {
+	const u64 iterations = 1000000;
+
+	bench_main_fiber = get_current_fiber();
+	bench_ping_fiber = make_fiber(kb(128), ping_fiber);
+
+	u64 start = now_ns();
+	for (u64 i = 0; i < iterations; i++) {
+		switch_to_fiber(bench_ping_fiber);
+	}
+	u64 end = now_ns();
+
+	report("fiber_switch", iterations * 2, (double)(end - start) / (iterations * 2), "ns/switch");
+}
+
+//SCHEDULER
+
+void empty_job(void*) {}
+
+void bench_empty_jobs() {
+	const uint JOB_COUNT = 1000;
+	const uint rounds = 1000;
+
+	JobDesc desc[JOB_COUNT];
+	for (uint i = 0; i < JOB_COUNT; i++) desc[i] = { empty_job, nullptr };
+
+	u64 start = now_ns();
+	for (uint i = 0; i < rounds; i++) {
+		atomic_counter counter = 0;
+		add_jobs(PRIORITY_HIGH, { desc, JOB_COUNT }, &counter);
+		wait_for_counter(&counter, 0);
+	}
+	u64 end = now_ns();
+
+	u64 jobs = (u64)JOB_COUNT * rounds;
+	report("empty_job_throughput", jobs, jobs / ((end - start) / 1e9), "jobs/s");
+}
+
+const uint FAN_OUT = 10;
+
+void fork_leaf(void*) {}
+
+void fork_inner(void*) {
+	JobDesc desc[FAN_OUT];
+	for (uint i = 0; i < FAN_OUT; i++) desc[i] = { fork_leaf, nullptr };
+	wait_for_jobs(PRIORITY_HIGH, { desc, FAN_OUT });
+}
+
+void fork_outer(void*) {
+	JobDesc desc[FAN_OUT];
+	for (uint i = 0; i < FAN_OUT; i++) desc[i] = { fork_inner, nullptr };
+	wait_for_jobs(PRIORITY_HIGH, { desc, FAN_OUT });
+}
+
+//Three levels of fork-join compared to enqueuing the same number of leaves at once
+void bench_nested_wait() {
+	const uint rounds = 100;
+	const uint leaves = FAN_OUT * FAN_OUT * FAN_OUT;
+
+	JobDesc nested[FAN_OUT];
+	for (uint i = 0; i < FAN_OUT; i++) nested[i] = { fork_outer, nullptr };
+
+	JobDesc flat[leaves];
+	for (uint i = 0; i < leaves; i++) flat[i] = { fork_leaf, nullptr };
+
+	u64 start = now_ns();
+	for (uint i = 0; i < rounds; i++) wait_for_jobs(PRIORITY_HIGH, { nested, FAN_OUT });
+	double nested_time = now_ns() - start;
+
+	start = now_ns();
+	for (uint i = 0; i < rounds; i++) wait_for_jobs(PRIORITY_HIGH, { flat, leaves });
+	double flat_time = now_ns() - start;
+
+	uint waits = FAN_OUT * FAN_OUT + FAN_OUT + 1;
+	report("nested_wait_overhead", (u64)rounds * waits, (nested_time - flat_time) / (rounds * waits), "ns/wait");
+}
+
+//Compute bound loop to see how close parallel_for gets to linear scaling
+void bench_parallel_for() {
+	const uint count = 1 << 24;
+	const uint rounds = 10;
+
+	std::atomic<u64> checksum = 0;
+
+	u64 start = now_ns();
+	for (uint i = 0; i < rounds; i++) {
+		parallel_for(0, count, 4096, [&](uint begin, uint end) {
+			u64 hash = 0;
+			for (uint i = begin; i < end; i++) hash += (i * 2654435761u) >> 7;
+			checksum += hash;
+		});
+	}
+	u64 end = now_ns();
+
+	if (checksum == 0) printf("Unexpected checksum\n");
+
+	u64 iterations = (u64)count * rounds;
+	report("parallel_for_throughput", iterations, iterations / ((end - start) / 1e9), "items/s");
+}
+
+void run_benchmarks() {
+	bench_work_stealing_queue();
+	if (num_workers > 1) {
+		bench_steal_latency();
+		bench_mpmc_queue();
+	}
+
+	bench_fiber_switch();
+	bench_empty_jobs();
+	bench_nested_wait();
+	bench_parallel_for();
+}
+
+int run_scaling(const char* exe, const char* out_path) {
+	for (uint workers = 1; workers <= num_workers; workers++) {
+		char command[1024];
+		if (out_path) snprintf(command, sizeof(command), "\"%s\" --workers %u --out \"%s\"", exe, workers, out_path);
+		else snprintf(command, sizeof(command), "\"%s\" --workers %u", exe, workers);
+
+		fflush(stdout);
+		if (system(command) != 0) {
+			fprintf(stderr, "Benchmark with %u workers failed\n", workers);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	const char* out_path = nullptr;
+	bool scaling = false;
+
+	num_workers = hardware_thread_count();
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) num_workers = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) out_path = argv[++i];
+		else if (strcmp(argv[i], "--scaling") == 0) scaling = true;
+		else {
+			fprintf(stderr, "usage: %s [--workers N] [--out results.json] [--scaling]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (num_workers == 0 || num_workers > hardware_thread_count()) {
+		fprintf(stderr, "Worker count must be between 1 and %u\n", hardware_thread_count());
+		return 1;
+	}
+
+	if (scaling) return run_scaling(argv[0], out_path);
+
+	if (out_path) {
+		out = fopen(out_path, "a");
+		if (!out) {
+			fprintf(stderr, "Could not open %s\n", out_path);
+			return 1;
+		}
+	}
+
+	make_job_system(20, num_workers);
+	convert_thread_to_fiber();
+
+	LinearAllocator temporary_allocator(mb(10));
+	Context& context = get_context();
+	context.allocator = &default_allocator;
+	context.temporary_allocator = &temporary_allocator;
+
+	run_benchmarks();
+
+	convert_fiber_to_thread();
+	destroy_job_system();
+
+	if (out != stdout) fclose(out);
+	return 0;
+}
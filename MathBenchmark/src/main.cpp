@@ -0,0 +1,671 @@
+#include "core/core.h"
+#include "core/math/model_matrices.h"
+#include "core/math/aabb_batch.h"
+#include "core/math/bvh.h"
+#include "core/math/dynamic_bvh.h"
+#include "core/simd.h"
+#include "core/memory/allocator.h"
+#include "core/memory/linear_allocator.h"
+#include "core/job_system/job.h"
+#include "core/job_system/fiber.h"
+#include "core/context.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//MATH BENCHMARKS
+//Results are written as one JSON object per line, in the same format as JobBenchmark.
+//usage: MathBenchmark [--out results.json] [--scene boxes.txt]
+//The widest model matrix path is picked at compile time, build with AVX enabled to measure the 8 wide path.
+//The AABB kernels dispatch at runtime, every level the cpu supports is measured.
+
+FILE* out = stdout;
+
+u64 now_ns() {
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void report(const char* benchmark, uint count, u64 iterations, double value, const char* unit) {
+	fprintf(out, "{\"benchmark\":\"%s\",\"count\":%u,\"iterations\":%llu,\"value\":%.3f,\"unit\":\"%s\"}\n",
+		benchmark, count, (unsigned long long)iterations, value, unit);
+	fflush(out);
+}
+
+float random_float(float min, float max) {
+	return min + (max - min) * (rand() / (float)RAND_MAX);
+}
+
+//MODEL MATRICES
+//The glm path is the one compute_model_matrix takes, a matrix per transform from glm calls.
+
+constexpr u64 MODEL_MATRIX_BENCH_MATRICES = 20000000; //per measurement, spread over repeats
+
+struct BenchTransform {
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
+};
+
+struct ModelMatrixBench {
+	uint count;
+	BenchTransform* transforms;
+	float* arrays[10];
+	TransformArrays soa;
+	glm::mat4* model_m;
+	glm::mat4* expected;
+};
+
+void make_model_matrix_bench(ModelMatrixBench& bench, uint count) {
+	bench.count = count;
+	bench.transforms = new BenchTransform[count];
+	bench.model_m = new glm::mat4[count];
+	bench.expected = new glm::mat4[count];
+	for (uint i = 0; i < 10; i++) bench.arrays[i] = new float[count];
+
+	for (uint i = 0; i < count; i++) {
+		BenchTransform& trans = bench.transforms[i];
+		trans.position = glm::vec3(random_float(-100, 100), random_float(-100, 100), random_float(-100, 100));
+		trans.rotation = glm::normalize(glm::quat(random_float(-1, 1), random_float(-1, 1), random_float(-1, 1), random_float(-1, 1)));
+		trans.scale = glm::vec3(random_float(0.5f, 2), random_float(0.5f, 2), random_float(0.5f, 2));
+
+		bench.arrays[0][i] = trans.position.x;
+		bench.arrays[1][i] = trans.position.y;
+		bench.arrays[2][i] = trans.position.z;
+		bench.arrays[3][i] = trans.rotation.x;
+		bench.arrays[4][i] = trans.rotation.y;
+		bench.arrays[5][i] = trans.rotation.z;
+		bench.arrays[6][i] = trans.rotation.w;
+		bench.arrays[7][i] = trans.scale.x;
+		bench.arrays[8][i] = trans.scale.y;
+		bench.arrays[9][i] = trans.scale.z;
+	}
+
+	float** a = bench.arrays;
+	bench.soa = { { a[0], a[1], a[2] }, { a[3], a[4], a[5], a[6] }, { a[7], a[8], a[9] } };
+}
+
+void free_model_matrix_bench(ModelMatrixBench& bench) {
+	delete[] bench.transforms;
+	delete[] bench.model_m;
+	delete[] bench.expected;
+	for (uint i = 0; i < 10; i++) delete[] bench.arrays[i];
+}
+
+void glm_model_matrices(ModelMatrixBench& bench, glm::mat4* model_m) {
+	glm::mat4 identity(1.0f);
+	for (uint i = 0; i < bench.count; i++) {
+		BenchTransform& trans = bench.transforms[i];
+		model_m[i] = glm::translate(identity, trans.position) * glm::scale(identity, trans.scale) * glm::mat4_cast(trans.rotation);
+	}
+}
+
+void scalar_model_matrices(ModelMatrixBench& bench, glm::mat4* model_m) {
+	for (uint i = 0; i < bench.count; i++) {
+		f32x1 m[16];
+		model_matrix_lanes<f32x1, 4>(bench.soa, i, m);
+		for (uint j = 0; j < 16; j++) ((float*)(model_m + i))[j] = m[j].v;
+	}
+}
+
+void simd_model_matrices(ModelMatrixBench& bench, glm::mat4* model_m) {
+	compute_model_matrices(model_m, bench.soa, bench.count);
+}
+
+float max_difference(const glm::mat4* a, const glm::mat4* b, uint count) {
+	float result = 0.0f;
+	for (uint i = 0; i < count * 16; i++) result = fmaxf(result, fabsf(((const float*)a)[i] - ((const float*)b)[i]));
+	return result;
+}
+
+template<typename F>
+void bench_model_matrix_path(ModelMatrixBench& bench, const char* name, F func) {
+	u64 repeat = MODEL_MATRIX_BENCH_MATRICES / bench.count;
+
+	func(bench, bench.model_m); //warm up
+	float difference = max_difference(bench.model_m, bench.expected, bench.count);
+
+	u64 start = now_ns();
+	for (u64 i = 0; i < repeat; i++) func(bench, bench.model_m);
+	u64 end = now_ns();
+
+	char benchmark[64];
+	snprintf(benchmark, sizeof(benchmark), "model_matrices_%s", name);
+	report(benchmark, bench.count, repeat * bench.count, (double)(end - start) / (repeat * bench.count), "ns/matrix");
+
+	snprintf(benchmark, sizeof(benchmark), "model_matrices_%s_max_error", name);
+	report(benchmark, bench.count, bench.count, difference, "abs");
+}
+
+void bench_model_matrices() {
+	const uint counts[] = { 1000, 10000, 100000, 1000000 };
+	SimdLevel detected = detect_simd_level();
+
+	for (uint count : counts) {
+		ModelMatrixBench bench;
+		make_model_matrix_bench(bench, count);
+		glm_model_matrices(bench, bench.expected);
+
+		bench_model_matrix_path(bench, "glm", glm_model_matrices);
+		bench_model_matrix_path(bench, "scalar", scalar_model_matrices);
+
+		//The scalar level runs the batched kernel's scalar lanes
+		for (int level = SIMD_SCALAR; level <= detected; level++) {
+			set_simd_level((SimdLevel)level);
+			char name[32];
+			snprintf(name, sizeof(name), "batch_%s", simd_level_name((SimdLevel)level));
+			bench_model_matrix_path(bench, name, simd_model_matrices);
+		}
+
+		free_model_matrix_bench(bench);
+	}
+
+	set_simd_level(detected);
+}
+
+//AABB TRANSFORM AND CULLING
+//The reference transforms all 8 corners and tests the planes the same way frustum_test does.
+
+constexpr u64 AABB_BENCH_BOXES = 20000000; //per measurement, spread over repeats
+
+//Same planes as extract_planes makes for a viewport
+void extract_frustum_planes(glm::vec4 planes[6], const glm::mat4& mat) {
+	for (uint i = 0; i < 4; i++) {
+		planes[0][i] = mat[i][3] + mat[i][0];
+		planes[1][i] = mat[i][3] - mat[i][0];
+		planes[2][i] = mat[i][3] + mat[i][1];
+		planes[3][i] = mat[i][3] - mat[i][1];
+		planes[4][i] = mat[i][3] + mat[i][2];
+		planes[5][i] = mat[i][3] - mat[i][2];
+	}
+}
+
+struct AABBBench {
+	uint count;
+	AABB* local;
+	glm::mat4* model_m;
+	AABBArrays local_arrays;
+	AABBArrays world_arrays;
+	u64* visible;
+	bool* expected_visible;
+	AABB* expected;
+	glm::vec4 planes[6];
+};
+
+AABB corner_apply(const AABB& aabb, const glm::mat4& model_m) {
+	glm::vec3 verts[8];
+	aabb.to_verts(verts);
+
+	AABB result;
+	for (uint i = 0; i < 8; i++) result.update(glm::vec3(model_m * glm::vec4(verts[i], 1.0f)));
+	return result;
+}
+
+bool outside_frustum(const glm::vec4 planes[6], const AABB& aabb) {
+	for (uint i = 0; i < 6; i++) {
+		glm::vec3 positive;
+		for (uint j = 0; j < 3; j++) positive[j] = planes[i][j] < 0 ? aabb.min[j] : aabb.max[j];
+		if (glm::dot(glm::vec3(planes[i]), positive) + planes[i].w < 0.0f) return true;
+	}
+	return false;
+}
+
+void make_aabb_bench(AABBBench& bench, uint count) {
+	bench.count = count;
+	bench.local = new AABB[count];
+	bench.model_m = new glm::mat4[count];
+	bench.expected = new AABB[count];
+	bench.expected_visible = new bool[count];
+	bench.visible = new u64[(count + 63) / 64];
+	bench.local_arrays = alloc_aabb_arrays(default_allocator, count);
+	bench.world_arrays = alloc_aabb_arrays(default_allocator, count);
+
+	glm::mat4 view = glm::lookAt(glm::vec3(0, 10, -50), glm::vec3(0), glm::vec3(0, 1, 0));
+	glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 200.0f);
+	extract_frustum_planes(bench.planes, proj * view);
+
+	glm::mat4 identity(1.0f);
+
+	for (uint i = 0; i < count; i++) {
+		glm::vec3 center(random_float(-1, 1), random_float(-1, 1), random_float(-1, 1));
+		glm::vec3 extent(random_float(0.1f, 2), random_float(0.1f, 2), random_float(0.1f, 2));
+		bench.local[i].min = center - extent;
+		bench.local[i].max = center + extent;
+		set_aabb(bench.local_arrays, i, bench.local[i]);
+
+		glm::vec3 position(random_float(-150, 150), random_float(-50, 50), random_float(-150, 150));
+		glm::quat rotation = glm::normalize(glm::quat(random_float(-1, 1), random_float(-1, 1), random_float(-1, 1), random_float(-1, 1)));
+		glm::vec3 scale(random_float(0.5f, 2), random_float(0.5f, 2), random_float(0.5f, 2));
+		bench.model_m[i] = glm::translate(identity, position) * glm::scale(identity, scale) * glm::mat4_cast(rotation);
+
+		bench.expected[i] = corner_apply(bench.local[i], bench.model_m[i]);
+		bench.expected_visible[i] = !outside_frustum(bench.planes, bench.expected[i]);
+	}
+}
+
+void free_aabb_bench(AABBBench& bench) {
+	delete[] bench.local;
+	delete[] bench.model_m;
+	delete[] bench.expected;
+	delete[] bench.expected_visible;
+	delete[] bench.visible;
+	for (uint i = 0; i < 3; i++) {
+		default_allocator.deallocate(bench.local_arrays.center[i]);
+		default_allocator.deallocate(bench.local_arrays.extent[i]);
+		default_allocator.deallocate(bench.world_arrays.center[i]);
+		default_allocator.deallocate(bench.world_arrays.extent[i]);
+	}
+}
+
+void reference_aabbs(AABBBench& bench) {
+	for (uint i = 0; i < bench.count; i++) {
+		AABB aabb = corner_apply(bench.local[i], bench.model_m[i]);
+		if (outside_frustum(bench.planes, aabb)) bench.visible[i / 64] &= ~(1ull << (i % 64));
+		else bench.visible[i / 64] |= 1ull << (i % 64);
+	}
+}
+
+void batch_aabbs(AABBBench& bench) {
+	transform_aabbs(bench.world_arrays, bench.local_arrays, bench.model_m, bench.count);
+	frustum_cull_aabbs(bench.visible, bench.planes, bench.world_arrays, bench.count);
+}
+
+//Boxes are only compared to the reference up to rounding, so a box touching a plane may flip
+uint visibility_mismatches(AABBBench& bench) {
+	uint mismatches = 0;
+	for (uint i = 0; i < bench.count; i++) {
+		bool visible = bench.visible[i / 64] >> (i % 64) & 1;
+		if (visible != bench.expected_visible[i]) mismatches++;
+	}
+	return mismatches;
+}
+
+float max_aabb_difference(AABBBench& bench) {
+	float result = 0.0f;
+	for (uint i = 0; i < bench.count; i++) {
+		AABB aabb = get_aabb(bench.world_arrays, i);
+		for (uint j = 0; j < 3; j++) {
+			result = fmaxf(result, fabsf(aabb.min[j] - bench.expected[i].min[j]));
+			result = fmaxf(result, fabsf(aabb.max[j] - bench.expected[i].max[j]));
+		}
+	}
+	return result;
+}
+
+template<typename F>
+void bench_aabb_path(AABBBench& bench, const char* name, F func, bool batched) {
+	u64 repeat = AABB_BENCH_BOXES / bench.count;
+
+	func(bench); //warm up
+	uint mismatches = visibility_mismatches(bench);
+
+	u64 start = now_ns();
+	for (u64 i = 0; i < repeat; i++) func(bench);
+	u64 end = now_ns();
+
+	char benchmark[64];
+	snprintf(benchmark, sizeof(benchmark), "aabb_cull_%s", name);
+	report(benchmark, bench.count, repeat * bench.count, (double)(end - start) / (repeat * bench.count), "ns/box");
+
+	snprintf(benchmark, sizeof(benchmark), "aabb_cull_%s_mismatches", name);
+	report(benchmark, bench.count, bench.count, mismatches, "boxes");
+
+	if (batched) {
+		snprintf(benchmark, sizeof(benchmark), "aabb_cull_%s_max_error", name);
+		report(benchmark, bench.count, bench.count, max_aabb_difference(bench), "abs");
+	}
+}
+
+void bench_aabb_culling() {
+	const uint counts[] = { 1000, 10000, 100000, 1000000 };
+	SimdLevel detected = detect_simd_level();
+
+	for (uint count : counts) {
+		AABBBench bench;
+		make_aabb_bench(bench, count);
+
+		bench_aabb_path(bench, "corners", reference_aabbs, false);
+
+		for (int level = SIMD_SCALAR; level <= detected; level++) {
+			set_simd_level((SimdLevel)level);
+			bench_aabb_path(bench, simd_level_name((SimdLevel)level), batch_aabbs, true);
+		}
+
+		free_aabb_bench(bench);
+	}
+
+	set_simd_level(detected);
+}
+
+//BVH
+//Compares the binned SAH build against splitting at the object median, on synthetic scenes and on a scene
+//passed with --scene, a text file with a box per line: min_x min_y min_z max_x max_y max_z.
+//Culling counts the nodes and boxes tested per frustum, which is what the SAH cost estimates.
+
+const char* scene_path = nullptr;
+
+constexpr uint BVH_BENCH_BUILDS = 5;
+constexpr uint BVH_BENCH_VIEWS = 64;
+
+struct BVHScene {
+	const char* name;
+	vector<AABB> boxes;
+	float size; //half the extent of the scene
+
+	BVHScene() { boxes.allocator = &default_allocator; }
+};
+
+AABB make_box(glm::vec3 center, glm::vec3 extent) {
+	AABB aabb;
+	aabb.min = center - extent;
+	aabb.max = center + extent;
+	return aabb;
+}
+
+//Props spread over a square world
+void uniform_scene(BVHScene& scene, uint count) {
+	scene.name = "uniform";
+	scene.size = 1000.0f;
+
+	for (uint i = 0; i < count; i++) {
+		glm::vec3 center(random_float(-1000, 1000), random_float(0, 20), random_float(-1000, 1000));
+		glm::vec3 extent(random_float(0.2f, 3), random_float(0.2f, 3), random_float(0.2f, 3));
+		scene.boxes.append(make_box(center, extent));
+	}
+}
+
+//Dense towns of small props with a few large boxes spanning them, like terrain chunks and buildings,
+//the case where oversized boxes make median splits overlap
+void clustered_scene(BVHScene& scene, uint count) {
+	scene.name = "clustered";
+	scene.size = 1000.0f;
+
+	uint clusters = count / 2000 + 1;
+	glm::vec3 centers[1024];
+	for (uint i = 0; i < clusters && i < 1024; i++) {
+		centers[i] = glm::vec3(random_float(-900, 900), 0, random_float(-900, 900));
+	}
+
+	for (uint i = 0; i < count; i++) {
+		if (i % 200 == 0) {
+			glm::vec3 center(random_float(-900, 900), 0, random_float(-900, 900));
+			glm::vec3 extent(random_float(20, 150), random_float(5, 40), random_float(20, 150));
+			scene.boxes.append(make_box(center, extent));
+			continue;
+		}
+
+		glm::vec3 cluster = centers[i % (clusters < 1024 ? clusters : 1024)];
+		glm::vec3 offset(random_float(-1, 1), random_float(0, 0.5f), random_float(-1, 1));
+		float spread = 60.0f * offset.x * offset.x + 5.0f;
+		glm::vec3 center = cluster + glm::vec3(offset.x * spread, offset.y * 30.0f, offset.z * spread);
+		glm::vec3 extent(random_float(0.1f, 2), random_float(0.1f, 4), random_float(0.1f, 2));
+		scene.boxes.append(make_box(center, extent));
+	}
+}
+
+bool load_scene(BVHScene& scene, const char* path) {
+	FILE* file = fopen(path, "r");
+	if (!file) {
+		fprintf(stderr, "Could not open %s\n", path);
+		return false;
+	}
+
+	scene.name = "imported";
+	AABB bounds;
+	AABB aabb;
+
+	while (fscanf(file, "%f %f %f %f %f %f", &aabb.min.x, &aabb.min.y, &aabb.min.z, &aabb.max.x, &aabb.max.y, &aabb.max.z) == 6) {
+		scene.boxes.append(aabb);
+		bounds.update_aabb(aabb);
+	}
+
+	fclose(file);
+
+	glm::vec3 size = bounds.size();
+	scene.size = fmaxf(size.x, fmaxf(size.y, size.z)) * 0.5f;
+	return scene.boxes.length > 0;
+}
+
+void bench_bvh_scene(BVHScene& scene, BVHSplit split, const char* split_name) {
+	uint count = scene.boxes.length;
+	slice<AABB> boxes = { scene.boxes.data, count };
+
+	BVHBuildSettings settings;
+	settings.split = split;
+
+	BVH bvh;
+	build_bvh(bvh, boxes, settings); //warm up
+
+	u64 start = now_ns();
+	for (uint i = 0; i < BVH_BENCH_BUILDS; i++) build_bvh(bvh, boxes, settings);
+	u64 end = now_ns();
+
+	BVHStats stats = bvh_stats(bvh, settings.traversal_cost);
+
+	char benchmark[128];
+	auto report_scene = [&](const char* metric, u64 iterations, double value, const char* unit) {
+		snprintf(benchmark, sizeof(benchmark), "bvh_%s_%s_%s", scene.name, split_name, metric);
+		report(benchmark, count, iterations, value, unit);
+	};
+
+	report_scene("build", BVH_BENCH_BUILDS, (end - start) / (1e6 * BVH_BENCH_BUILDS), "ms");
+	report_scene("nodes", 1, stats.node_count, "nodes");
+	report_scene("depth", 1, stats.max_depth, "levels");
+	report_scene("leaf_size", 1, stats.average_leaf_size, "boxes");
+	report_scene("sah_cost", 1, stats.sah_cost, "tests");
+
+	//Cameras around the scene looking through it
+	BVHQueryStats query_stats;
+	u64 visible = 0;
+	u64 mismatches = 0;
+	u64 query_time = 0;
+
+	srand(2);
+
+	for (uint view = 0; view < BVH_BENCH_VIEWS; view++) {
+		glm::vec3 eye(random_float(-scene.size, scene.size), random_float(2, 50), random_float(-scene.size, scene.size));
+		glm::vec3 target(random_float(-scene.size, scene.size), 0, random_float(-scene.size, scene.size));
+		glm::mat4 view_m = glm::lookAt(eye, target, glm::vec3(0, 1, 0));
+		glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, scene.size * 0.5f);
+
+		glm::vec4 planes[6];
+		extract_frustum_planes(planes, proj * view_m);
+
+		uint found = 0;
+		u64 query_start = now_ns();
+
+		query_bvh(bvh, [&](const AABB& aabb) { return !outside_frustum(planes, aabb); }, [&](const BVHNode& leaf) {
+			for (uint i = leaf.offset; i < leaf.offset + leaf.count; i++) {
+				if (!outside_frustum(planes, scene.boxes[bvh.indices[i]])) found++;
+			}
+		}, &query_stats);
+
+		query_time += now_ns() - query_start;
+
+		uint expected = 0;
+		for (uint i = 0; i < count; i++) expected += !outside_frustum(planes, scene.boxes[i]);
+
+		visible += found;
+		mismatches += found != expected;
+	}
+
+	report_scene("cull", BVH_BENCH_VIEWS, query_time / (1e3 * BVH_BENCH_VIEWS), "us/view");
+	report_scene("cull_nodes_tested", BVH_BENCH_VIEWS, (double)query_stats.nodes_tested / BVH_BENCH_VIEWS, "nodes/view");
+	report_scene("cull_boxes_tested", BVH_BENCH_VIEWS, (double)query_stats.primitives / BVH_BENCH_VIEWS, "boxes/view");
+	report_scene("cull_visible", BVH_BENCH_VIEWS, (double)visible / BVH_BENCH_VIEWS, "boxes/view");
+	report_scene("cull_mismatches", BVH_BENCH_VIEWS, mismatches, "views");
+}
+
+void bench_bvh() {
+	const uint counts[] = { 10000, 100000, 1000000 };
+
+	for (uint count : counts) {
+		for (uint kind = 0; kind < 2; kind++) {
+			BVHScene scene;
+			srand(1);
+			if (kind == 0) uniform_scene(scene, count);
+			else clustered_scene(scene, count);
+
+			bench_bvh_scene(scene, BVH_SPLIT_MEDIAN, "median");
+			bench_bvh_scene(scene, BVH_SPLIT_SAH, "sah");
+		}
+	}
+
+	if (scene_path) {
+		BVHScene scene;
+		if (load_scene(scene, scene_path)) {
+			bench_bvh_scene(scene, BVH_SPLIT_MEDIAN, "median");
+			bench_bvh_scene(scene, BVH_SPLIT_SAH, "sah");
+		}
+	}
+}
+
+//DYNAMIC BVH
+//A fraction of the objects in the uniform scene move at their own steady velocity, and a few teleport.
+//Updating should cost about the number of objects that moved and culling the number that are visible.
+
+constexpr uint DYNAMIC_BENCH_FRAMES = 100;
+
+void bench_dynamic_bvh_scene(uint count, uint moving_percent) {
+	BVHScene scene;
+	srand(3);
+	uniform_scene(scene, count);
+
+	DynamicBVH bvh;
+	vector<uint> leaves;
+	leaves.allocator = &default_allocator;
+	leaves.resize(count);
+
+	vector<glm::vec3> velocities;
+	velocities.allocator = &default_allocator;
+	velocities.resize(count);
+
+	for (uint i = 0; i < count; i++) {
+		if ((uint)(rand() % 100) >= moving_percent) continue;
+		velocities[i] = glm::vec3(random_float(-0.3f, 0.3f), random_float(-0.1f, 0.1f), random_float(-0.3f, 0.3f));
+	}
+
+	u64 start = now_ns();
+	for (uint i = 0; i < count; i++) leaves[i] = insert_dynamic_bvh(bvh, scene.boxes[i], i);
+	u64 insert_time = now_ns() - start;
+
+	u64 update_time = 0;
+	u64 query_time = 0;
+	u64 brute_time = 0;
+	u64 mismatches = 0;
+	u64 visible = 0;
+
+	for (uint frame = 0; frame < DYNAMIC_BENCH_FRAMES; frame++) {
+		for (uint i = 0; i < count; i++) {
+			glm::vec3 offset = velocities[i];
+			if (rand() % 10000 == 0) offset = glm::vec3(random_float(-500, 500), 0, random_float(-500, 500));
+
+			scene.boxes[i].min = scene.boxes[i].min + offset;
+			scene.boxes[i].max = scene.boxes[i].max + offset;
+		}
+
+		u64 update_start = now_ns();
+		for (uint i = 0; i < count; i++) move_dynamic_bvh(bvh, leaves[i], scene.boxes[i]);
+		rebalance_dynamic_bvh(bvh, 64);
+		update_time += now_ns() - update_start;
+
+		glm::vec3 eye(random_float(-scene.size, scene.size), random_float(2, 50), random_float(-scene.size, scene.size));
+		glm::vec3 target(random_float(-scene.size, scene.size), 0, random_float(-scene.size, scene.size));
+		glm::mat4 view_m = glm::lookAt(eye, target, glm::vec3(0, 1, 0));
+		glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, scene.size * 0.5f);
+
+		glm::vec4 planes[6];
+		extract_frustum_planes(planes, proj * view_m);
+
+		uint found = 0;
+		u64 query_start = now_ns();
+
+		query_dynamic_bvh(bvh, [&](const AABB& aabb) { return !outside_frustum(planes, aabb); }, [&](const DynamicBVHNode& leaf) {
+			if (!outside_frustum(planes, scene.boxes[leaf.user])) found++;
+		});
+
+		u64 brute_start = now_ns();
+		uint expected = 0;
+		for (uint i = 0; i < count; i++) expected += !outside_frustum(planes, scene.boxes[i]);
+		u64 brute_end = now_ns();
+
+		query_time += brute_start - query_start;
+		brute_time += brute_end - brute_start;
+		visible += found;
+		mismatches += found != expected;
+	}
+
+	char benchmark[128];
+	auto report_dynamic = [&](const char* metric, u64 iterations, double value, const char* unit) {
+		snprintf(benchmark, sizeof(benchmark), "dynamic_bvh_moving%u_%s", moving_percent, metric);
+		report(benchmark, count, iterations, value, unit);
+	};
+
+	report_dynamic("insert", count, (double)insert_time / count, "ns/object");
+	report_dynamic("update", DYNAMIC_BENCH_FRAMES, update_time / (1e3 * DYNAMIC_BENCH_FRAMES), "us/frame");
+	report_dynamic("cull", DYNAMIC_BENCH_FRAMES, query_time / (1e3 * DYNAMIC_BENCH_FRAMES), "us/view");
+	report_dynamic("cull_brute_force", DYNAMIC_BENCH_FRAMES, brute_time / (1e3 * DYNAMIC_BENCH_FRAMES), "us/view");
+	report_dynamic("cull_visible", DYNAMIC_BENCH_FRAMES, (double)visible / DYNAMIC_BENCH_FRAMES, "boxes/view");
+	report_dynamic("cull_mismatches", DYNAMIC_BENCH_FRAMES, mismatches, "views");
+	report_dynamic("area_ratio", 1, dynamic_bvh_area_ratio(bvh), "root areas");
+}
+
+void bench_dynamic_bvh() {
+	const uint counts[] = { 10000, 100000 };
+	const uint moving[] = { 1, 10, 100 };
+
+	for (uint count : counts) {
+		for (uint moving_percent : moving) bench_dynamic_bvh_scene(count, moving_percent);
+	}
+}
+
+void run_benchmarks() {
+	bench_model_matrices();
+	bench_aabb_culling();
+	bench_bvh();
+	bench_dynamic_bvh();
+}
+
+int main(int argc, char** argv) {
+	const char* out_path = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) out_path = argv[++i];
+		else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) scene_path = argv[++i];
+		else {
+			fprintf(stderr, "usage: %s [--out results.json] [--scene boxes.txt]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (out_path) {
+		out = fopen(out_path, "a");
+		if (!out) {
+			fprintf(stderr, "Could not open %s\n", out_path);
+			return 1;
+		}
+	}
+
+	//The BVH build splits into jobs
+	make_job_system(20, hardware_thread_count());
+	convert_thread_to_fiber();
+
+	LinearAllocator temporary_allocator(mb(10));
+	Context& context = get_context();
+	context.allocator = &default_allocator;
+	context.temporary_allocator = &temporary_allocator;
+	srand(1);
+
+	run_benchmarks();
+
+	convert_fiber_to_thread();
+	destroy_job_system();
+
+	if (out != stdout) fclose(out);
+	return 0;
+}
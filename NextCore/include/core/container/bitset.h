@@ -1,9 +1,342 @@
 #pragma once
 
 #include "core/core.h"
+#include "core/memory/allocator.h"
+#include "core/simd.h"
+#include <assert.h>
+#include <string.h>
+#include <utility>
 
-inline bool get_b
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__)
+#define NE_BITSET_SSE2
+#include <emmintrin.h>
+#endif
+
+inline bool get_bit(uint* bitset, uint i) {
+	return bitset[i / 32] & (1u << (i % 32));
+}
 
 inline void set_bit(uint* bitset, uint i) {
 	bitset[i / 32] |= 1 << (i % 32);
-}
\ No newline at end of file
+}
+
+//BIT WORDS
+//Bitsets are arrays of 64 bit words, bits past the length are always kept clear.
+//The bulk operations handle two words at a time with SSE2, which every x64 target has.
+//Arrays of at least BITS_AVX2_WORDS go to the AVX2 kernels in bitset.cpp when simd_level() allows it,
+//below that the call and dispatch cost more than the wider loop saves.
+
+inline uint count_bits(u64 word) {
+#ifdef _MSC_VER
+	return (uint)__popcnt64(word);
+#else
+	return __builtin_popcountll(word);
+#endif
+}
+
+//Index of the lowest set bit, word must not be 0
+inline uint first_bit(u64 word) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return index;
+#else
+	return __builtin_ctzll(word);
+#endif
+}
+
+inline uint bit_words(uint bits) { return (bits + 63) / 64; }
+
+//Mask of the bits in use in the last word
+inline u64 bit_tail_mask(uint bits) {
+	return bits % 64 == 0 ? ~0ull : (1ull << (bits % 64)) - 1;
+}
+
+const uint BITS_AVX2_WORDS = 16;
+
+#ifdef NE_SIMD_X86
+CORE_API void bits_or_avx2(u64* dst, const u64* src, uint words);
+CORE_API void bits_and_avx2(u64* dst, const u64* src, uint words);
+CORE_API void bits_xor_avx2(u64* dst, const u64* src, uint words);
+CORE_API void bits_andnot_avx2(u64* dst, const u64* src, uint words);
+CORE_API uint bits_count_avx2(const u64* words, uint count);
+
+#define NE_BITS_AVX2(call) if (words >= BITS_AVX2_WORDS && simd_level() >= SIMD_AVX2) return call;
+#else
+#define NE_BITS_AVX2(call)
+#endif
+
+#ifdef NE_BITSET_SSE2
+#define NE_BITS_BINARY_OP(name, sse2_op, scalar_op) \
+inline void name(u64* dst, const u64* src, uint words) { \
+	NE_BITS_AVX2(name##_avx2(dst, src, words)) \
+	uint i = 0; \
+	for (; i + 2 <= words; i += 2) { \
+		__m128i a = _mm_loadu_si128((const __m128i*)(dst + i)); \
+		__m128i b = _mm_loadu_si128((const __m128i*)(src + i)); \
+		_mm_storeu_si128((__m128i*)(dst + i), sse2_op); \
+	} \
+	for (; i < words; i++) dst[i] = scalar_op; \
+}
+#else
+#define NE_BITS_BINARY_OP(name, sse2_op, scalar_op) \
+inline void name(u64* dst, const u64* src, uint words) { \
+	NE_BITS_AVX2(name##_avx2(dst, src, words)) \
+	for (uint i = 0; i < words; i++) dst[i] = scalar_op; \
+}
+#endif
+
+NE_BITS_BINARY_OP(bits_or, _mm_or_si128(a, b), dst[i] | src[i])
+NE_BITS_BINARY_OP(bits_and, _mm_and_si128(a, b), dst[i] & src[i])
+NE_BITS_BINARY_OP(bits_xor, _mm_xor_si128(a, b), dst[i] ^ src[i])
+NE_BITS_BINARY_OP(bits_andnot, _mm_andnot_si128(b, a), dst[i] & ~src[i]) //dst &= ~src
+
+#undef NE_BITS_BINARY_OP
+#undef NE_BITS_AVX2
+
+inline uint bits_count(const u64* words, uint count) {
+#ifdef NE_SIMD_X86
+	if (count >= BITS_AVX2_WORDS && simd_level() >= SIMD_AVX2) return bits_count_avx2(words, count);
+#endif
+
+	uint result = 0;
+	for (uint i = 0; i < count; i++) result += count_bits(words[i]);
+	return result;
+}
+
+inline bool bits_any(const u64* words, uint count) {
+	uint i = 0;
+
+#ifdef NE_BITSET_SSE2
+	for (; i + 2 <= count; i += 2) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(words + i));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xffff) return true;
+	}
+#endif
+
+	for (; i < count; i++) {
+		if (words[i]) return true;
+	}
+	return false;
+}
+
+//Number of set bits in [begin, end)
+inline uint bits_count_range(const u64* words, uint begin, uint end) {
+	if (begin >= end) return 0;
+
+	uint first = begin / 64;
+	uint last = (end - 1) / 64;
+	u64 first_mask = ~0ull << (begin % 64);
+	u64 last_mask = bit_tail_mask(end);
+
+	if (first == last) return count_bits(words[first] & first_mask & last_mask);
+
+	return count_bits(words[first] & first_mask)
+		+ bits_count(words + first + 1, last - first - 1)
+		+ count_bits(words[last] & last_mask);
+}
+
+//First set bit at or after from, bit_count if there is none
+inline uint bits_find_next(const u64* words, uint bit_count, uint from) {
+	if (from >= bit_count) return bit_count;
+
+	uint word_count = bit_words(bit_count);
+	uint i = from / 64;
+	u64 word = words[i] & (~0ull << (from % 64));
+
+	while (!word) {
+		if (++i >= word_count) return bit_count;
+		word = words[i];
+	}
+
+	return i * 64 + first_bit(word);
+}
+
+//Visits the set bits in increasing order, clearing the lowest bit of a copy of each word
+struct bit_iterator {
+	const u64* words;
+	uint word_count;
+	uint index;
+	u64 word;
+
+	void skip_empty() {
+		while (!word && ++index < word_count) word = words[index];
+	}
+
+	uint operator*() const { return index * 64 + first_bit(word); }
+
+	void operator++() {
+		word &= word - 1;
+		skip_empty();
+	}
+
+	bool operator!=(const bit_iterator& other) const {
+		return index != other.index || word != other.word;
+	}
+};
+
+inline bit_iterator bits_begin(const u64* words, uint word_count) {
+	bit_iterator it{ words, word_count, 0, word_count > 0 ? words[0] : 0 };
+	if (word_count > 0) it.skip_empty();
+	return it;
+}
+
+inline bit_iterator bits_end(const u64* words, uint word_count) {
+	return { words, word_count, word_count, 0 };
+}
+
+//BITSET
+template<uint N>
+struct bitset {
+	static constexpr uint WORDS = (N + 63) / 64;
+	u64 words[WORDS] = {};
+
+	static constexpr uint length = N;
+
+	bool operator[](uint i) const { return get(i); }
+	bool get(uint i) const { assert(i < N); return words[i / 64] & (1ull << (i % 64)); }
+	void set(uint i) { assert(i < N); words[i / 64] |= 1ull << (i % 64); }
+	void clear(uint i) { assert(i < N); words[i / 64] &= ~(1ull << (i % 64)); }
+	void set(uint i, bool value) { if (value) set(i); else clear(i); }
+
+	void set_all() {
+		for (uint i = 0; i < WORDS; i++) words[i] = ~0ull;
+		words[WORDS - 1] &= bit_tail_mask(N);
+	}
+
+	void clear_all() {
+		for (uint i = 0; i < WORDS; i++) words[i] = 0;
+	}
+
+	uint count() const { return bits_count(words, WORDS); }
+	uint count(uint begin, uint end) const { return bits_count_range(words, begin, end); }
+	bool any() const { return bits_any(words, WORDS); }
+	bool none() const { return !any(); }
+	uint find_next(uint from) const { return bits_find_next(words, N, from); }
+
+	bitset& operator|=(const bitset& other) { bits_or(words, other.words, WORDS); return *this; }
+	bitset& operator&=(const bitset& other) { bits_and(words, other.words, WORDS); return *this; }
+	bitset& operator^=(const bitset& other) { bits_xor(words, other.words, WORDS); return *this; }
+	bitset& andnot(const bitset& other) { bits_andnot(words, other.words, WORDS); return *this; }
+
+	bool operator==(const bitset& other) const { return memcmp(words, other.words, sizeof(words)) == 0; }
+	bool operator!=(const bitset& other) const { return !(*this == other); }
+
+	bit_iterator begin() const { return bits_begin(words, WORDS); }
+	bit_iterator end() const { return bits_end(words, WORDS); }
+};
+
+//DYNAMIC BITSET
+//Growing keeps the existing bits and clears the new ones. Operations between two bitsets need equal lengths.
+struct dynamic_bitset {
+	Allocator* allocator = nullptr;
+	u64* words = nullptr;
+	uint length = 0;
+	uint capacity = 0; //in words
+
+	dynamic_bitset() {}
+
+	dynamic_bitset(uint length) {
+		resize(length);
+	}
+
+	dynamic_bitset(const dynamic_bitset& other) {
+		*this = other;
+	}
+
+	dynamic_bitset(dynamic_bitset&& other) {
+		*this = std::move(other);
+	}
+
+	~dynamic_bitset() {
+		if (allocator) allocator->deallocate(words);
+	}
+
+	dynamic_bitset& operator=(const dynamic_bitset& other) {
+		if (this == &other) return *this;
+		length = 0;
+		resize(other.length);
+		if (word_count() > 0) memcpy(words, other.words, sizeof(u64) * word_count());
+		return *this;
+	}
+
+	dynamic_bitset& operator=(dynamic_bitset&& other) {
+		if (allocator) allocator->deallocate(words);
+
+		allocator = other.allocator;
+		words = other.words;
+		length = other.length;
+		capacity = other.capacity;
+
+		other.words = nullptr;
+		other.length = 0;
+		other.capacity = 0;
+		return *this;
+	}
+
+	uint word_count() const { return bit_words(length); }
+
+	void reserve(uint bits) {
+		uint count = bit_words(bits);
+		if (count <= capacity) return;
+
+		if (!allocator) allocator = &get_allocator();
+		u64* data = (u64*)allocator->allocate(sizeof(u64) * count);
+		if (words) memcpy(data, words, sizeof(u64) * word_count());
+		allocator->deallocate(words);
+
+		words = data;
+		capacity = count;
+	}
+
+	void resize(uint bits) {
+		reserve(bits);
+
+		uint old_words = word_count();
+		uint new_words = bit_words(bits);
+		if (new_words > old_words) memset(words + old_words, 0, sizeof(u64) * (new_words - old_words));
+
+		length = bits;
+		if (new_words > 0) words[new_words - 1] &= bit_tail_mask(bits);
+	}
+
+	bool operator[](uint i) const { return get(i); }
+	bool get(uint i) const { assert(i < length); return words[i / 64] & (1ull << (i % 64)); }
+	void set(uint i) { assert(i < length); words[i / 64] |= 1ull << (i % 64); }
+	void clear(uint i) { assert(i < length); words[i / 64] &= ~(1ull << (i % 64)); }
+	void set(uint i, bool value) { if (value) set(i); else clear(i); }
+
+	void set_all() {
+		uint count = word_count();
+		if (count == 0) return;
+		memset(words, 0xff, sizeof(u64) * count);
+		words[count - 1] &= bit_tail_mask(length);
+	}
+
+	void clear_all() {
+		if (words) memset(words, 0, sizeof(u64) * word_count());
+	}
+
+	uint count() const { return bits_count(words, word_count()); }
+	uint count(uint begin, uint end) const { assert(end <= length); return bits_count_range(words, begin, end); }
+	bool any() const { return bits_any(words, word_count()); }
+	bool none() const { return !any(); }
+	uint find_next(uint from) const { return bits_find_next(words, length, from); }
+
+	dynamic_bitset& operator|=(const dynamic_bitset& other) { assert(length == other.length); bits_or(words, other.words, word_count()); return *this; }
+	dynamic_bitset& operator&=(const dynamic_bitset& other) { assert(length == other.length); bits_and(words, other.words, word_count()); return *this; }
+	dynamic_bitset& operator^=(const dynamic_bitset& other) { assert(length == other.length); bits_xor(words, other.words, word_count()); return *this; }
+	dynamic_bitset& andnot(const dynamic_bitset& other) { assert(length == other.length); bits_andnot(words, other.words, word_count()); return *this; }
+
+	bool operator==(const dynamic_bitset& other) const {
+		return length == other.length && (length == 0 || memcmp(words, other.words, sizeof(u64) * word_count()) == 0);
+	}
+	bool operator!=(const dynamic_bitset& other) const { return !(*this == other); }
+
+	bit_iterator begin() const { return bits_begin(words, word_count()); }
+	bit_iterator end() const { return bits_end(words, word_count()); }
+};
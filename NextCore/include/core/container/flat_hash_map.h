@@ -0,0 +1,229 @@
+#pragma once
+
+#include "core/container/hash_map.h"
+#include "core/memory/allocator.h"
+#include <new>
+#include <string.h>
+
+//Resizable version of hash_map, the capacity is a power of two and grows once 7/8 of the slots are full or deleted.
+//Growing moves keys and values with memcpy like vector does, so indices and pointers into the map are invalidated.
+template<typename K, typename V>
+struct flat_hash_map {
+	Allocator* allocator = nullptr;
+	u8* control = nullptr;
+	K* keys = nullptr;
+	V* values = nullptr;
+	uint capacity = 0;
+	uint length = 0;
+	uint tombstones = 0;
+
+	static constexpr uint MIN_CAPACITY = 16;
+
+	flat_hash_map() {}
+
+	flat_hash_map(uint count) {
+		reserve(count);
+	}
+
+	flat_hash_map(flat_hash_map&& other) {
+		*this = std::move(other);
+	}
+
+	flat_hash_map(const flat_hash_map& other) {
+		*this = other;
+	}
+
+	~flat_hash_map() {
+		free_data();
+	}
+
+	flat_hash_map& operator=(flat_hash_map&& other) {
+		free_data();
+
+		allocator = other.allocator;
+		control = other.control;
+		keys = other.keys;
+		values = other.values;
+		capacity = other.capacity;
+		length = other.length;
+		tombstones = other.tombstones;
+
+		other.control = nullptr;
+		other.keys = nullptr;
+		other.values = nullptr;
+		other.capacity = 0;
+		other.length = 0;
+		other.tombstones = 0;
+		return *this;
+	}
+
+	flat_hash_map& operator=(const flat_hash_map& other) {
+		if (this == &other) return *this;
+
+		free_data();
+		if (!allocator) allocator = other.allocator;
+		if (other.capacity == 0) return *this;
+
+		alloc_slots(other.capacity);
+		memcpy(control, other.control, capacity + HASH_GROUP_WIDTH - 1);
+
+		for (uint i = 0; i < capacity; i++) {
+			if (!is_full(i)) continue;
+			new (keys + i) K(other.keys[i]);
+			new (values + i) V(other.values[i]);
+		}
+
+		length = other.length;
+		tombstones = other.tombstones;
+		return *this;
+	}
+
+	bool is_full(uint i) const { return control[i] & HASH_FULL; }
+
+	int index(K key) const {
+		if (length == 0) return -1;
+		return hash_table_find(control, keys, capacity, hash_wrap_mask{ capacity - 1 }, hash_key(key), key);
+	}
+
+	bool contains(K key) const { return index(key) != -1; }
+
+	//Inserts a default constructed value if the key is missing
+	int add(K key) {
+		u64 hash = hash_key(key);
+		if (length > 0) {
+			int i = hash_table_find(control, keys, capacity, hash_wrap_mask{ capacity - 1 }, hash, key);
+			if (i != -1) return i;
+		}
+
+		if ((length + tombstones + 1) * 8 > capacity * 7) grow();
+
+		uint i = hash_table_find_free(control, capacity, hash_wrap_mask{ capacity - 1 }, hash);
+		if (control[i] == HASH_DELETED) tombstones--;
+
+		hash_set_control(control, capacity, i, hash_control(hash));
+		new (keys + i) K(key);
+		new (values + i) V();
+		length++;
+		return i;
+	}
+
+	uint set(K key, const V& value) {
+		int i = add(key);
+		values[i] = value;
+		return i;
+	}
+
+	V& operator[](K key) {
+		int i = add(key); //add may move values
+		return values[i];
+	}
+
+	V* get(K key) {
+		int i = index(key);
+		if (i != -1) return &values[i];
+		else return nullptr;
+	}
+
+	void remove(K key) {
+		int i = index(key);
+		if (i == -1) return;
+
+		keys[i].~K();
+		values[i].~V();
+		length--;
+
+		if (hash_table_erase(control, capacity, hash_wrap_mask{ capacity - 1 }, i)) tombstones++;
+	}
+
+	void clear() {
+		destruct_slots();
+		if (control) memset(control, HASH_EMPTY, capacity + HASH_GROUP_WIDTH - 1);
+		length = 0;
+		tombstones = 0;
+	}
+
+	void reserve(uint count) {
+		uint new_capacity = MIN_CAPACITY;
+		while (new_capacity * 7 < count * 8) new_capacity *= 2;
+
+		if (new_capacity > capacity) rehash(new_capacity);
+	}
+
+	hash_table_it<K, V> begin() {
+		hash_table_it<K, V> it{ control, keys, values, capacity, 0 };
+		it.skip_empty();
+		return it;
+	}
+
+	hash_table_it<K, V> end() {
+		return { control, keys, values, capacity, capacity };
+	}
+
+private:
+	void alloc_slots(uint count) {
+		if (!allocator) allocator = &get_allocator();
+
+		u64 size = count + HASH_GROUP_WIDTH - 1;
+		u64 keys_offset = aligned_incr(&size, sizeof(K) * count, alignof(K));
+		u64 values_offset = aligned_incr(&size, sizeof(V) * count, alignof(V));
+
+		char* memory = (char*)allocator->allocate(size);
+		control = (u8*)memory;
+		keys = (K*)(memory + keys_offset);
+		values = (V*)(memory + values_offset);
+		capacity = count;
+
+		memset(control, HASH_EMPTY, count + HASH_GROUP_WIDTH - 1);
+	}
+
+	void destruct_slots() {
+		for (uint i = 0; i < capacity; i++) {
+			if (!is_full(i)) continue;
+			keys[i].~K();
+			values[i].~V();
+		}
+	}
+
+	void free_data() {
+		destruct_slots();
+		if (allocator && control) allocator->deallocate(control);
+
+		control = nullptr;
+		keys = nullptr;
+		values = nullptr;
+		capacity = 0;
+		length = 0;
+		tombstones = 0;
+	}
+
+	//Dropping the tombstones is enough if that leaves a quarter of the table free before the next grow
+	void grow() {
+		if (capacity == 0) rehash(MIN_CAPACITY);
+		else if (length * 8 <= capacity * 5) rehash(capacity);
+		else rehash(capacity * 2);
+	}
+
+	void rehash(uint new_capacity) {
+		u8* old_control = control;
+		K* old_keys = keys;
+		V* old_values = values;
+		uint old_capacity = capacity;
+
+		alloc_slots(new_capacity);
+		hash_wrap_mask wrap{ new_capacity - 1 };
+
+		for (uint i = 0; i < old_capacity; i++) {
+			if (!(old_control[i] & HASH_FULL)) continue;
+
+			u64 hash = hash_key(old_keys[i]);
+			uint slot = hash_table_find_free(control, capacity, wrap, hash);
+
+			hash_set_control(control, capacity, slot, hash_control(hash));
+			memcpy((void*)(keys + slot), old_keys + i, sizeof(K));
+			memcpy((void*)(values + slot), old_values + i, sizeof(V));
+		}
+
+		tombstones = 0;
+		if (old_control) allocator->deallocate(old_control);
+	}
+};
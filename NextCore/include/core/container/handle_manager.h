@@ -1,93 +1,196 @@
 #pragma once
 
-#include "core/container/array.h"
+#include "core/container/vector.h"
+#include "core/memory/allocator.h"
 #include "engine/handle.h"
+#include <new>
 
 constexpr unsigned int INVALID_SLOT = 0;
 
-template<typename T, typename H, int MAX_HANDLES = 200, int RESERVED_HANDLES = 10>
+//Handles keep their single 32 bit id, so they can still be serialized as before.
+//The id packs the slot index + 1, a generation and whether the id was handed out for serialization.
+//Serialized and runtime ids come from separate slot spaces, so a saved id can be assigned again without
+//running into an object created at runtime.
+constexpr uint HANDLE_INDEX_BITS = 24;
+constexpr uint HANDLE_INDEX_MASK = (1u << HANDLE_INDEX_BITS) - 1;
+constexpr uint HANDLE_GENERATION_MASK = 0x7f;
+constexpr uint HANDLE_SERIALIZED_BIT = 1u << 31;
+constexpr uint HANDLE_PAGE_SIZE = 64;
+constexpr uint HANDLE_DEAD = ~0u;
+
+//Before ids had a generation, ids 101 to 200 were the ones handed out for serialization
+constexpr uint HANDLE_LEGACY_SERIALIZED_FIRST = 101;
+constexpr uint HANDLE_LEGACY_SERIALIZED_LAST = 200;
+
+//Whether the id was handed out for serialization, i.e. the object was imported rather than created at runtime
+inline bool is_serialized_handle(uint id) {
+	return (id & HANDLE_SERIALIZED_BIT) || (id >= HANDLE_LEGACY_SERIALIZED_FIRST && id <= HANDLE_LEGACY_SERIALIZED_LAST);
+}
+
+//Objects live in fixed size pages which never move, pointers returned by get stay valid until the handle is freed.
+//The handles of live objects are kept packed for iteration, index_to_handle(i) for i < handles.length.
+//ids up to RESERVED_HANDLES are never handed out, they can only be assigned explicitly.
+//This keeps ids saved before generations were added loadable.
+template<typename T, typename H, uint RESERVED_HANDLES = 200>
 struct HandleManager {
-	unsigned int generation_counter = 0;
-	
-	array<MAX_HANDLES, unsigned int> free_serialized_ids;
-	array<MAX_HANDLES, unsigned int > free_ids;
-	array<MAX_HANDLES, T> slots;
-	array<MAX_HANDLES, unsigned int> id_of_slots;
-	T* by_handle[MAX_HANDLES];
-
-	unsigned int handle_to_index(H handle) {
-		return handle.id - 1;
+	struct Page {
+		u8 generation[HANDLE_PAGE_SIZE];
+		uint dense[HANDLE_PAGE_SIZE]; //position in handles, HANDLE_DEAD if the slot is free
+		alignas(T) char objects[HANDLE_PAGE_SIZE * sizeof(T)];
+
+		T* object(uint slot) { return (T*)objects + slot; }
+	};
+
+	struct Space {
+		vector<Page*> pages;
+		vector<uint> free_indices;
+		uint next_unused = 0;
+	};
+
+	Allocator* allocator = &default_allocator;
+	Space runtime;
+	Space serialized;
+	vector<H> handles;
+
+	HandleManager() {
+		runtime.pages.allocator = allocator;
+		runtime.free_indices.allocator = allocator;
+		serialized.pages.allocator = allocator;
+		serialized.free_indices.allocator = allocator;
+		handles.allocator = allocator;
+
+		runtime.next_unused = RESERVED_HANDLES;
+	}
+
+	HandleManager(const HandleManager&) = delete;
+	void operator=(const HandleManager&) = delete;
+
+	~HandleManager() {
+		for (H handle : handles) get(handle)->~T();
+		free_pages(runtime);
+		free_pages(serialized);
+	}
+
+	static uint handle_to_index(H handle) { return (handle.id & HANDLE_INDEX_MASK) - 1; }
+	static uint handle_generation(H handle) { return (handle.id >> HANDLE_INDEX_BITS) & HANDLE_GENERATION_MASK; }
+
+	H index_to_handle(uint index) {
+		return handles[index];
+	}
+
+	T* get(H handle) {
+		if (handle.id == INVALID_HANDLE) return NULL;
+
+		Space& space = space_of(handle);
+		uint index = handle_to_index(handle);
+		uint page_index = index / HANDLE_PAGE_SIZE;
+		if (page_index >= space.pages.length) return NULL;
+
+		Page* page = space.pages[page_index];
+		uint slot = index % HANDLE_PAGE_SIZE;
+		if (page->dense[slot] == HANDLE_DEAD || page->generation[slot] != handle_generation(handle)) return NULL;
+
+		return page->object(slot);
 	}
 
 	H assign_handle(T&& obj, bool serialized = false) {
-		slots.append(std::move(obj));
-		
-		unsigned int handle = serialized ? free_serialized_ids.pop() : free_ids.pop();
+		Space& space = serialized ? this->serialized : runtime;
+
+		uint index;
+		do {
+			if (space.free_indices.length > 0) index = space.free_indices.pop();
+			else index = space.next_unused++;
+		} while (is_alive(space, index)); //may have been assigned explicitly since it was freed
+
+		assert(index < HANDLE_INDEX_MASK);
+		ensure_page(space, index);
 
-		id_of_slots.append(handle);
-		by_handle[handle- 1] = &slots[slots.length - 1];
-		return { handle };
+		H handle;
+		handle.id = make_id(index, space.pages[index / HANDLE_PAGE_SIZE]->generation[index % HANDLE_PAGE_SIZE], serialized);
+		construct(space, index, handle, std::move(obj));
+		return handle;
 	}
 
 	T* assign_handle(H handle, T&& obj) {
-		bool found = false;
+		assert(handle.id != INVALID_HANDLE);
 
-		for (int i = 0; i < free_serialized_ids.length; i++) {
-			if (free_serialized_ids[i] == handle.id) {
-				auto popped = free_serialized_ids.pop();
-				if (i != free_serialized_ids.length) free_serialized_ids[i] = popped; //poped is the element we are trying to delete
-				found = true;
-			}
+		Space& space = space_of(handle);
+		uint index = handle_to_index(handle);
+
+		//Indices skipped over become free, so automatic assignment can still use them
+		for (; space.next_unused < index; space.next_unused++) {
+			space.free_indices.append(space.next_unused);
 		}
-		
-		//assert(found); skybox material is not in the correct range
+		if (space.next_unused == index) space.next_unused++;
+
+		ensure_page(space, index);
+		assert(!is_alive(space, index));
+
+		space.pages[index / HANDLE_PAGE_SIZE]->generation[index % HANDLE_PAGE_SIZE] = handle_generation(handle);
+		return construct(space, index, handle, std::move(obj));
+	}
 
-		slots.append(std::move(obj));
+	void free(H handle) {
+		T* obj = get(handle);
+		if (!obj) return;
 
-		T* ptr = &slots[slots.length - 1];
+		Space& space = space_of(handle);
+		uint index = handle_to_index(handle);
+		Page* page = space.pages[index / HANDLE_PAGE_SIZE];
+		uint slot = index % HANDLE_PAGE_SIZE;
 
-		id_of_slots.append(handle.id);
-		by_handle[handle.id - 1] = ptr;
-		return ptr;
+		obj->~T();
+
+		uint dense = page->dense[slot];
+		H last = handles.pop();
+
+		if (dense != handles.length) {
+			handles[dense] = last;
+			Page* last_page = space_of(last).pages[handle_to_index(last) / HANDLE_PAGE_SIZE];
+			last_page->dense[handle_to_index(last) % HANDLE_PAGE_SIZE] = dense;
+		}
+
+		page->dense[slot] = HANDLE_DEAD;
+		page->generation[slot] = (page->generation[slot] + 1) & HANDLE_GENERATION_MASK; //stale handles no longer match
+		space.free_indices.append(index);
 	}
 
-	H index_to_handle(unsigned index) {
-		return { id_of_slots[index] };
+private:
+	Space& space_of(H handle) {
+		return handle.id & HANDLE_SERIALIZED_BIT ? serialized : runtime;
 	}
 
-	T* get(H handle) {
-		if (handle.id == INVALID_HANDLE || handle.id > MAX_HANDLES) return NULL;
-		return by_handle[handle.id - 1];
+	static uint make_id(uint index, uint generation, bool serialized) {
+		return (serialized ? HANDLE_SERIALIZED_BIT : 0) | generation << HANDLE_INDEX_BITS | (index + 1);
 	}
 
-	void free(H handle) { 
-		unsigned int index = handle_to_index(handle);
-		auto last_id = id_of_slots.pop();
+	bool is_alive(Space& space, uint index) {
+		uint page_index = index / HANDLE_PAGE_SIZE;
+		if (page_index >= space.pages.length) return false;
+		return space.pages[page_index]->dense[index % HANDLE_PAGE_SIZE] != HANDLE_DEAD;
+	}
 
-		if (index != slots.length) { //poped is the element we are trying to delete
-			slots[index].~T(); //todo not sure of this is a leak
-			new (&slots[index]) T(std::move(slots.pop())); //Move assign doesnt work on Material
-			by_handle[last_id - 1] = &slots[index];
-			id_of_slots[index] = last_id;
-		}
-		else {
-			slots.pop();
+	void ensure_page(Space& space, uint index) {
+		while (space.pages.length <= index / HANDLE_PAGE_SIZE) {
+			Page* page = (Page*)allocator->allocate(sizeof(Page));
+			for (uint i = 0; i < HANDLE_PAGE_SIZE; i++) {
+				page->generation[i] = 0;
+				page->dense[i] = HANDLE_DEAD;
+			}
+			space.pages.append(page);
 		}
-		by_handle[handle.id - 1] = NULL;
 	}
 
-	HandleManager() {
-		for (int i = 0; i < MAX_HANDLES; i++) {
-			by_handle[i] = NULL;
-		}
+	T* construct(Space& space, uint index, H handle, T&& obj) {
+		Page* page = space.pages[index / HANDLE_PAGE_SIZE];
+		uint slot = index % HANDLE_PAGE_SIZE;
 
-		for (int i = MAX_HANDLES; i > MAX_HANDLES - 100; i--) { //todo add more flexibility
-			free_serialized_ids.append(i);
-		}
+		page->dense[slot] = handles.length;
+		handles.append(handle);
+		return new (page->object(slot)) T(std::move(obj));
+	}
 
-		for (int i = MAX_HANDLES - 100; i > RESERVED_HANDLES; i--) {
-			free_ids.append(i);
-		}
+	void free_pages(Space& space) {
+		for (Page* page : space.pages) allocator->deallocate(page);
 	}
 };
-
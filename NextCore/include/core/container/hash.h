@@ -0,0 +1,52 @@
+#pragma once
+
+#include "core/core.h"
+#include <string.h>
+
+//Finalizer of murmur3, every input bit affects every output bit
+inline u64 hash_mix(u64 x) {
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdull;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ull;
+	x ^= x >> 33;
+	return x;
+}
+
+//MurmurHash64A, reads eight bytes at a time
+inline u64 hash_bytes(const void* data, u64 length) {
+	const u64 m = 0xc6a4a7935bd1e995ull;
+	const uint r = 47;
+
+	u64 hash = 0x8445d61a4e774912ull ^ (length * m);
+	const u8* bytes = (const u8*)data;
+
+	for (; length >= 8; bytes += 8, length -= 8) {
+		u64 k;
+		memcpy(&k, bytes, 8);
+
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+
+		hash ^= k;
+		hash *= m;
+	}
+
+	if (length > 0) {
+		u64 tail = 0;
+		memcpy(&tail, bytes, length);
+		hash ^= tail;
+		hash *= m;
+	}
+
+	hash ^= hash >> r;
+	hash *= m;
+	hash ^= hash >> r;
+	return hash;
+}
+
+inline u64 hash_func(void* ptr) { return hash_mix((u64)ptr); }
+inline u64 hash_func(uint value) { return hash_mix(value); }
+inline u64 hash_func(u64 value) { return hash_mix(value); }
+inline u64 hash_func(const char* str) { return hash_bytes(str, strlen(str)); }
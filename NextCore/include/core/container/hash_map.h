@@ -1,21 +1,15 @@
 #pragma once
 
 #include "core/core.h"
+#include "core/container/hash.h"
 #include <assert.h>
 
-using hash_meta = u64;
-
-inline uint hash_func(void* ptr) { return (u64)ptr >> 32; }
-inline uint hash_func(uint hash) { return hash; }
-inline uint hash_func(const char* str) {
-	int hash = 7;
-
-	while (*str++) {
-		hash = hash * 31 + *str;
-	}
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NE_HASH_SSE2
+#include <emmintrin.h>
+#endif
 
-	return hash;
-}
+using hash_meta = u64;
 
 template<typename K>
 struct hash_set_base {
@@ -169,35 +163,211 @@ struct hash_map_base : hash_set_base<K> {
 	}
 };
 
+//HASH TABLE
+//Every slot has a control byte, probing compares 16 of them at once before touching any key.
+//A full slot stores the top bit and 7 bits of the hash, so almost every mismatch is rejected by the control bytes alone.
+//The first bytes are mirrored past the end, so a group can be loaded at any slot without wrapping.
+//Zeroed control bytes are empty, a zero initialized table is a valid empty table.
+
+constexpr uint HASH_GROUP_WIDTH = 16;
+constexpr u8 HASH_EMPTY = 0x00;
+constexpr u8 HASH_DELETED = 0x01;
+constexpr u8 HASH_FULL = 0x80;
+
+//Hand written hash_func overloads mostly pack fields together, so every hash is mixed once more
+template<typename K>
+inline u64 hash_key(K& key) { return hash_mix(hash_func(key)); }
+
+inline u8 hash_control(u64 hash) { return HASH_FULL | (hash & 0x7f); }
+inline u64 hash_position(u64 hash) { return hash >> 7; }
+
+inline uint hash_bit_index(uint mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+//Number of leading zeros within a 16 bit group mask
+inline uint hash_leading_zeros(uint mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse(&index, mask);
+	return HASH_GROUP_WIDTH - 1 - index;
+#else
+	return __builtin_clz(mask) - (32 - HASH_GROUP_WIDTH);
+#endif
+}
+
+struct hash_group {
+#ifdef NE_HASH_SSE2
+	__m128i control;
+
+	hash_group(const u8* pos) : control(_mm_loadu_si128((const __m128i*)pos)) {}
+
+	uint match(u8 h2) const { return _mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8((char)h2))); }
+	uint match_empty() const { return _mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_setzero_si128())); }
+	uint match_free() const { return ~_mm_movemask_epi8(control) & 0xffff; } //empty or deleted
+#else
+	const u8* control;
+
+	hash_group(const u8* pos) : control(pos) {}
+
+	uint match(u8 h2) const {
+		uint mask = 0;
+		for (uint i = 0; i < HASH_GROUP_WIDTH; i++) mask |= (uint)(control[i] == h2) << i;
+		return mask;
+	}
+
+	uint match_empty() const { return match(HASH_EMPTY); }
+
+	uint match_free() const {
+		uint mask = 0;
+		for (uint i = 0; i < HASH_GROUP_WIDTH; i++) mask |= (uint)!(control[i] & HASH_FULL) << i;
+		return mask;
+	}
+#endif
+};
+
+//Fixed tables can have any capacity, resizable ones are a power of two and wrap with a mask
+template<uint N>
+struct hash_wrap_fixed {
+	uint operator()(u64 pos) const { return pos % N; }
+};
+
+struct hash_wrap_mask {
+	uint mask;
+	uint operator()(u64 pos) const { return pos & mask; }
+};
+
+inline void hash_set_control(u8* control, uint capacity, uint slot, u8 value) {
+	control[slot] = value;
+	for (uint mirror = slot; mirror < HASH_GROUP_WIDTH - 1; mirror += capacity) {
+		control[capacity + mirror] = value;
+	}
+}
+
+template<typename K, typename Wrap>
+int hash_table_find(const u8* control, const K* keys, uint capacity, Wrap wrap, u64 hash, const K& key) {
+	uint groups = (capacity + HASH_GROUP_WIDTH - 1) / HASH_GROUP_WIDTH;
+	u8 h2 = hash_control(hash);
+	uint pos = wrap(hash_position(hash));
+
+	for (uint probe = 0; probe < groups; probe++) {
+		hash_group group(control + pos);
+
+		for (uint mask = group.match(h2); mask; mask &= mask - 1) {
+			uint slot = wrap(pos + hash_bit_index(mask));
+			if (keys[slot] == key) return slot;
+		}
+
+		if (group.match_empty()) return -1;
+		pos = wrap(pos + HASH_GROUP_WIDTH);
+	}
+
+	return -1;
+}
+
+//First empty or deleted slot along the probe sequence of the hash, -1 if the table is full
+template<typename Wrap>
+int hash_table_find_free(const u8* control, uint capacity, Wrap wrap, u64 hash) {
+	uint groups = (capacity + HASH_GROUP_WIDTH - 1) / HASH_GROUP_WIDTH;
+	uint pos = wrap(hash_position(hash));
+
+	for (uint probe = 0; probe < groups; probe++) {
+		uint mask = hash_group(control + pos).match_free();
+		if (mask) return wrap(pos + hash_bit_index(mask));
+
+		pos = wrap(pos + HASH_GROUP_WIDTH);
+	}
+
+	return -1;
+}
+
+//Frees a slot, returns true if it had to become a tombstone.
+//If no 16 wide window containing the slot was ever completely full, no probe has gone past it and it can be empty again.
+template<typename Wrap>
+bool hash_table_erase(u8* control, uint capacity, Wrap wrap, uint slot) {
+	uint before = hash_group(control + wrap(slot + capacity * HASH_GROUP_WIDTH - HASH_GROUP_WIDTH)).match_empty();
+	uint after = hash_group(control + slot).match_empty();
+	bool was_never_full = before && after && hash_bit_index(after) + hash_leading_zeros(before) < HASH_GROUP_WIDTH;
+
+	hash_set_control(control, capacity, slot, was_never_full ? HASH_EMPTY : HASH_DELETED);
+	return !was_never_full;
+}
+
+template<typename K, typename V>
+struct hash_table_it {
+	const u8* control;
+	K* keys;
+	V* values;
+	uint length;
+	uint i;
+
+	void skip_empty() {
+		while (i < length && !(control[i] & HASH_FULL)) {
+			i++;
+		}
+	}
+
+	void operator++() {
+		i++;
+		skip_empty();
+	}
+
+	bool operator==(hash_table_it<K,V>& other) const {
+		return this->i == other.i;
+	}
+
+	bool operator!=(hash_table_it<K,V>& other) const {
+		return !(*this == other);
+	}
+
+	key_value<K,V> operator*() {
+		return { keys[i], values[i] };
+	}
+};
+
+//Slots never move, the index returned by add stays valid until the key is removed
 template <typename K, uint N>
 struct hash_set {
-	hash_meta meta[N] = {};
+	u8 control[N + HASH_GROUP_WIDTH - 1] = {};
 	K keys[N] = {};
 
 	uint capacity() { return N; }
 
 	void clear() {
-		for (uint i = 0; i < N; i++) {
-			meta[i] = {};
-			keys[i] = {};
-		}
-	}
-
-	bool matches(hash_meta hash, const K& key, uint probe_hash) const { 
-		return hash_set_base<K>::hash_set_base(N, meta, keys).matches(hash, key, probe_hash);
+		for (uint i = 0; i < N + HASH_GROUP_WIDTH - 1; i++) control[i] = HASH_EMPTY;
+		for (uint i = 0; i < N; i++) keys[i] = {};
 	}
 
 	void remove(const K& key) {
 		int i = index(key);
 		if (i == -1) return;
-		meta[i] = {};
+		hash_table_erase(control, N, hash_wrap_fixed<N>(), i);
 		keys[i] = {};
 	}
 
-	bool is_full(uint probe_hash) const { return meta[probe_hash] & 0x1; }
-	int add(K key) { return hash_set_base<K>(N, meta, keys).add(key); }
-	int index(K key) { return hash_set_base<K>(N, meta, keys).index(key); }
-	bool contains(K key) { return hash_set_base<K>(N, meta, keys).index(key) != -1; }
+	bool is_full(uint probe_hash) const { return control[probe_hash] & HASH_FULL; }
+
+	int add(K key) {
+		u64 hash = hash_key(key);
+		int i = hash_table_find(control, keys, N, hash_wrap_fixed<N>(), hash, key);
+		if (i != -1) return i; //Already exists
+
+		i = hash_table_find_free(control, N, hash_wrap_fixed<N>(), hash);
+		assert(i != -1);
+
+		hash_set_control(control, N, i, hash_control(hash));
+		keys[i] = key;
+		return i;
+	}
+
+	int index(K key) const { return hash_table_find(control, keys, N, hash_wrap_fixed<N>(), hash_key(key), key); }
+	bool contains(K key) const { return index(key) != -1; }
 };
 
 template <typename K, typename V, uint N>
@@ -207,9 +377,8 @@ struct hash_map : hash_set<K, N> {
 	uint capacity() { return N;}
 
 	void clear() {
+		hash_set<K, N>::clear();
 		for (uint i = 0; i < N; i++) {
-			this->meta[i] = {};
-			this->keys[i] = {};
 			this->values[i] = {};
 		}
 	}
@@ -221,9 +390,9 @@ struct hash_map : hash_set<K, N> {
 	}
 
 	void remove(const K& key) {
-		int i = index(key);
+		int i = this->index(key);
 		if (i == -1) return;
-		this->meta[i] = {};
+		hash_table_erase(this->control, N, hash_wrap_fixed<N>(), i);
 		this->keys[i] = {};
 		this->values[i] = {};
 	}
@@ -237,14 +406,14 @@ struct hash_map : hash_set<K, N> {
 	}
 
 
-	hash_map_it<K, V> begin() {
-		hash_map_it<K, V> it{ this->meta, this->keys, this->values, N, 0 };
+	hash_table_it<K, V> begin() {
+		hash_table_it<K, V> it{ this->control, this->keys, this->values, N, 0 };
 		it.skip_empty();
 		return it;
 	}
 
-	hash_map_it<K, V> end() {
-		return { this->meta, this->keys, values, N, N };
+	hash_table_it<K, V> end() {
+		return { this->control, this->keys, values, N, N };
 	}
 
 	V* get(K key) {
@@ -23,6 +23,14 @@ struct queue {
 		return (tail - head) % N;
 	}
 
+	bool empty() {
+		u64 tail = this->tail.load(std::memory_order_acquire);
+		uint tail_lap = tail >> 32;
+		uint index = tail & ((1ull << 32) - 1);
+
+		return laps[index].load(std::memory_order_acquire) != tail_lap;
+	}
+
 	bool enqueue(T&& element) {
 		u64 head = this->head.load(std::memory_order_relaxed);
 
@@ -44,7 +52,7 @@ struct queue {
 			}
 			else if ((int)head_lap - (int)e_lap > 0) {
 				//read has not completed yet or queue is full
-				return nullptr;
+				return false;
 			}
 			else {
 				//element was written before we got there, try again
@@ -83,7 +91,7 @@ struct queue {
 			}
 			else if ((int)tail_lap - (int)e_lap > 0) { 
 				//write has not completed yet or queue is empty
-				return nullptr;
+				return false;
 			}
 			else { 
 				//element was read before we got there, try again
@@ -1,68 +1,227 @@
 #pragma once
 
+#include "core/core.h"
 #include "core/memory/allocator.h"
 #include "core/memory/linear_allocator.h"
+#include "core/job_system/job.h"
+#include <string.h>
+#include <type_traits>
+#include <utility>
 
-//ripped from https://www.geeksforgeeks.org/radix-sort/
+//RADIX SORT
+//Stable LSD radix sort over 8 bit digits for uint and u64 keys, optionally carrying a value per key.
+//The histograms of every digit are counted in one read over the keys before the first scatter,
+//digits which are the same for every key are skipped, so small keys in a u64 only cost their own passes.
+//Values are moved with plain copies and should be trivially copyable.
+//Signed and floating point keys are mapped to unsigned keys of the same order with radix_key.
 
-template<typename T, typename F>
-long long getMax(T arr[], int n, F func)
-{
-	long long mx = func(arr[0]);
-	for (int i = 1; i < n; i++)
-		if (func(arr[i]) > mx)
-			mx = func(arr[i]);
-	return mx;
+constexpr uint RADIX_BITS = 8;
+constexpr uint RADIX_BUCKETS = 1 << RADIX_BITS;
+constexpr uint RADIX_PARALLEL_BLOCK = 32 * 1024; //keys per job of the parallel sort
+constexpr uint RADIX_MAX_BLOCKS = 64;
+
+//Flips the sign bit of positive numbers and every bit of negative ones
+inline uint radix_key(float value) {
+	uint bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits ^ ((0u - (bits >> 31)) | 0x80000000u);
 }
 
-template<typename T, typename F>
-void countSort(T arr[], int n, long long exp, F func) //todo allow different allocators
-{
-	unsigned int occupied = get_temporary_allocator().occupied;
-	T* output = (T*)get_temporary_allocator().allocate(sizeof(T) * n);
-	assert(output != NULL);
-
-	int i, count[10] = { 0 };
-
-	// Store count of occurrences in count[] 
-	for (i = 0; i < n; i++)
-		count[(func(arr[i]) / exp) % 10]++;
-
-	// Change count[i] so that count[i] now contains actual 
-	//  position of this digit in output[] 
-	for (i = 1; i < 10; i++)
-		count[i] += count[i - 1];
-
-	// Build the output array 
-	for (i = n - 1; i >= 0; i--)
-	{
-		auto key = func(arr[i]);
-		output[count[(key / exp) % 10] - 1] = arr[i]; 
-		count[(key / exp) % 10]--;
+inline u64 radix_key(double value) {
+	u64 bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits ^ ((0ull - (bits >> 63)) | 0x8000000000000000ull);
+}
+
+inline uint radix_key(int value) { return (uint)value ^ 0x80000000u; }
+inline u64 radix_key(i64 value) { return (u64)value ^ 0x8000000000000000ull; }
+
+template<typename K>
+inline uint radix_digit(K key, uint digit) {
+	return (key >> (digit * RADIX_BITS)) & (RADIX_BUCKETS - 1);
+}
+
+template<typename K>
+void radix_histograms(const K* keys, uint n, uint (*counts)[RADIX_BUCKETS]) {
+	for (uint i = 0; i < n; i++) {
+		K key = keys[i];
+		for (uint digit = 0; digit < sizeof(K); digit++) {
+			counts[digit][radix_digit(key, digit)]++;
+		}
+	}
+}
+
+//Every key has the same digit, the pass would not move anything
+inline bool radix_is_trivial(const uint* counts, uint n) {
+	for (uint i = 0; i < RADIX_BUCKETS; i++) {
+		if (counts[i] != 0) return counts[i] == n;
+	}
+	return true;
+}
+
+template<typename K, typename V>
+void radix_scatter(const K* keys, const V* values, K* keys_out, V* values_out, uint begin, uint end, uint digit, uint* offsets) {
+	for (uint i = begin; i < end; i++) {
+		K key = keys[i];
+		uint dst = offsets[radix_digit(key, digit)]++;
+		keys_out[dst] = key;
+		if (values) values_out[dst] = values[i];
 	}
+}
+
+//values may be null. Scratch memory comes from the temporary allocator.
+template<typename K, typename V>
+void radix_sort(K* keys, V* values, uint n) {
+	if (n <= 1) return;
+
+	LinearAllocator& temporary = get_temporary_allocator();
+	LinearRegion region(temporary);
+
+	K* keys_tmp = (K*)temporary.allocate(sizeof(K) * n);
+	V* values_tmp = values ? (V*)temporary.allocate(sizeof(V) * n) : nullptr;
+
+	uint counts[sizeof(K)][RADIX_BUCKETS] = {};
+	radix_histograms(keys, n, counts);
+
+	K* keys_in = keys;
+	V* values_in = values;
+
+	for (uint digit = 0; digit < sizeof(K); digit++) {
+		if (radix_is_trivial(counts[digit], n)) continue;
 
-	// Copy the output array to arr[], so that arr[] now 
-	// contains sorted numbers according to current digit 
-	for (i = 0; i < n; i++) {
-		arr[i] = output[i];
+		uint offsets[RADIX_BUCKETS];
+		uint sum = 0;
+		for (uint i = 0; i < RADIX_BUCKETS; i++) {
+			offsets[i] = sum;
+			sum += counts[digit][i];
+		}
+
+		radix_scatter(keys_in, values_in, keys_tmp, values_tmp, 0, n, digit, offsets);
+
+		std::swap(keys_in, keys_tmp);
+		std::swap(values_in, values_tmp);
 	}
 
-	get_temporary_allocator().occupied = occupied;
+	if (keys_in != keys) {
+		memcpy(keys, keys_in, sizeof(K) * n);
+		if (values) memcpy(values, values_in, sizeof(V) * n);
+	}
 }
 
-// The main function to that sorts arr[] of size n using  
-// Radix Sort 
+template<typename K>
+void radix_sort(K* keys, uint n) {
+	radix_sort(keys, (u8*)nullptr, n);
+}
+
+//Splits the keys into at most RADIX_MAX_BLOCKS blocks, every pass counts each block's digits
+//and scatters each block as its own job. A block's offsets for a bucket start after every earlier block's,
+//so the result is the same as the single threaded sort. Small arrays are sorted on the calling thread.
+//Blocks until the sort is complete, scratch memory comes from get_allocator.
+template<typename K, typename V>
+void parallel_radix_sort(K* keys, V* values, uint n) {
+	uint blocks = n / RADIX_PARALLEL_BLOCK;
+	if (blocks <= 1) {
+		radix_sort(keys, values, n);
+		return;
+	}
+
+	if (blocks > RADIX_MAX_BLOCKS) blocks = RADIX_MAX_BLOCKS;
+	uint block_size = (n + blocks - 1) / blocks;
+	blocks = (n + block_size - 1) / block_size;
+
+	using BlockCounts = uint[sizeof(K)][RADIX_BUCKETS];
+
+	Allocator& allocator = get_allocator();
+	K* keys_tmp = (K*)allocator.allocate(sizeof(K) * n);
+	V* values_tmp = values ? (V*)allocator.allocate(sizeof(V) * n) : nullptr;
+	BlockCounts* block_counts = (BlockCounts*)allocator.allocate(sizeof(BlockCounts) * blocks);
+	memset(block_counts, 0, sizeof(BlockCounts) * blocks);
+
+	K* keys_in = keys;
+	V* values_in = values;
+
+	auto block_end = [&](uint block) { return block + 1 < blocks ? (block + 1) * block_size : n; };
+
+	parallel_for(0, blocks, 1, [&](uint begin, uint end) {
+		for (uint block = begin; block < end; block++) {
+			radix_histograms(keys + block * block_size, block_end(block) - block * block_size, block_counts[block]);
+		}
+	});
+
+	uint totals[sizeof(K)][RADIX_BUCKETS] = {};
+	for (uint block = 0; block < blocks; block++) {
+		for (uint digit = 0; digit < sizeof(K); digit++) {
+			for (uint i = 0; i < RADIX_BUCKETS; i++) totals[digit][i] += block_counts[block][digit][i];
+		}
+	}
+
+	bool recount = false;
+
+	for (uint digit = 0; digit < sizeof(K); digit++) {
+		if (radix_is_trivial(totals[digit], n)) continue;
+
+		//The blocks now hold different keys than when they were first counted
+		if (recount) {
+			parallel_for(0, blocks, 1, [&](uint begin, uint end) {
+				for (uint block = begin; block < end; block++) {
+					uint* counts = block_counts[block][digit];
+					memset(counts, 0, sizeof(uint) * RADIX_BUCKETS);
+					for (uint i = block * block_size; i < block_end(block); i++) counts[radix_digit(keys_in[i], digit)]++;
+				}
+			});
+		}
+
+		//Turn the counts into offsets in place, bucket major then block
+		uint sum = 0;
+		for (uint i = 0; i < RADIX_BUCKETS; i++) {
+			for (uint block = 0; block < blocks; block++) {
+				uint count = block_counts[block][digit][i];
+				block_counts[block][digit][i] = sum;
+				sum += count;
+			}
+		}
+
+		parallel_for(0, blocks, 1, [&](uint begin, uint end) {
+			for (uint block = begin; block < end; block++) {
+				radix_scatter(keys_in, values_in, keys_tmp, values_tmp, block * block_size, block_end(block), digit, block_counts[block][digit]);
+			}
+		});
+
+		std::swap(keys_in, keys_tmp);
+		std::swap(values_in, values_tmp);
+		recount = true;
+	}
+
+	if (keys_in != keys) {
+		memcpy(keys, keys_in, sizeof(K) * n);
+		if (values) memcpy(values, values_in, sizeof(V) * n);
+	}
+
+	//After an odd number of passes the scratch pointers hold the caller's arrays
+	allocator.deallocate(keys_in == keys ? keys_tmp : keys_in);
+	if (values) allocator.deallocate(values_in == values ? values_tmp : values_in);
+	allocator.deallocate(block_counts);
+}
+
+template<typename K>
+void parallel_radix_sort(K* keys, uint n) {
+	parallel_radix_sort(keys, (u8*)nullptr, n);
+}
+
+//Sorts items by the uint or u64 key returned by key_of, the keys are computed once
 template<typename T, typename F>
-void radixsort(T arr[], int n, F f)
-{
-	if (n == 0) return;
-	// Find the maximum number to know number of digits 
-	long long m = getMax(arr, n, f);
-
-	// Do counting sort for every digit. Note that instead 
-	// of passing digit number, exp is passed. exp is 10^i 
-	// where i is current digit number 
-
-	for (long long exp = 1; m / exp > 0; exp *= 10)
-		countSort(arr, n, exp, f);
-}
\ No newline at end of file
+void radix_sort_by_key(T* items, uint n, F key_of) {
+	using K = std::decay_t<decltype(key_of(items[0]))>;
+
+	LinearRegion region(get_temporary_allocator());
+	K* keys = TEMPORARY_ARRAY(K, n);
+	for (uint i = 0; i < n; i++) keys[i] = key_of(items[i]);
+
+	radix_sort(keys, items, n);
+}
+
+//Keys returned by func must not be negative
+template<typename T, typename F>
+void radixsort(T arr[], int n, F func) {
+	radix_sort_by_key(arr, n, [&](T& item) { return (u64)func(item); });
+}
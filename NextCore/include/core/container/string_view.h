@@ -3,6 +3,7 @@
 #include <string.h>
 #include <assert.h>
 #include "core/core.h"
+#include "core/container/hash.h"
 
 inline char to_lower_case(char a) {
 	if ((a >= 65) && (a <= 90))
@@ -87,11 +88,7 @@ bool CORE_API string_to_uint(string_view str, unsigned int* number);
 bool CORE_API string_to_int(string_view str, int* number);
 
 
+//Same hash as the const char* overload, so either form of a string finds the same entry
 inline u64 hash_func(string_view str) {
-    u64 hash = 5381;
-
-    for (uint i = 0; i < str.length; i++)
-        hash = ((hash << 5) + hash) + str.data[i]; /* hash * 33 + c */
-
-    return hash;
+    return hash_bytes(str.data, str.length);
 }
@@ -18,6 +18,8 @@ struct vector {
 	T* data = NULL;
 
 	inline void reserve(uint count) {
+		static_assert(alignof(T) <= MAX_ALLOCATOR_ALIGNMENT, "vector storage is only aligned to MAX_ALLOCATOR_ALIGNMENT");
+
 		if (count > capacity) {
 			if (!allocator) allocator = &get_allocator();
 			T* data = (T*)allocator->allocate(sizeof(T) * count);
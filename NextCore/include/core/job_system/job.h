@@ -4,6 +4,8 @@
 #include "core/container/slice.h"
 #include "core/job_system/thread.h"
 #include <atomic>
+#include <type_traits>
+#include <utility>
 
 using JobFunc = void(*)(void*);
 
@@ -14,15 +16,24 @@ enum Priority {
 	PRIORITY_COUNT
 };
 
+//Stack a job needs at least, small 32kb stacks suit leaf jobs while deep recursion should ask for a large 1mb stack
+enum FiberStack : uint {
+	FIBER_STACK_SMALL,
+	FIBER_STACK_MEDIUM,
+	FIBER_STACK_LARGE,
+	FIBER_STACK_COUNT
+};
+
 struct JobDesc {
 	JobFunc func;
 	void* data;
+	FiberStack stack;
 
-	JobDesc() : func(nullptr), data(nullptr) {}
-	JobDesc(JobFunc func, void* data) : func(func), data(data) {}
+	JobDesc() : func(nullptr), data(nullptr), stack(FIBER_STACK_MEDIUM) {}
+	JobDesc(JobFunc func, void* data, FiberStack stack = FIBER_STACK_MEDIUM) : func(func), data(data), stack(stack) {}
 
 	template<typename T>
-	JobDesc(void(*func)(T&), T* data) : func((JobFunc)func), data(data) {}
+	JobDesc(void(*func)(T&), T* data, FiberStack stack = FIBER_STACK_MEDIUM) : func((JobFunc)func), data(data), stack(stack) {}
 };
 
 using atomic_counter = std::atomic<uint>;
@@ -35,7 +46,7 @@ struct WaitCondition {
 	CORE_API WaitCondition();
 };
 
-CORE_API void make_job_system(uint max_fibers, uint num_workers = hardware_thread_count());
+CORE_API void make_job_system(uint initial_fibers, uint num_workers = hardware_thread_count(), WorkerPlacement placement = WORKER_PLACEMENT_NONE);
 CORE_API void destroy_job_system();
 CORE_API void add_jobs(Priority, slice<JobDesc>, atomic_counter*);
 CORE_API void schedule_jobs_on(slice<uint>, slice<JobDesc>, atomic_counter*);
@@ -44,6 +55,27 @@ CORE_API void wait_for_counter(atomic_counter*, uint value);
 CORE_API void wait_for_jobs_on_thread(Priority, slice<JobDesc>);
 CORE_API void wait_for_counter_on_thread(atomic_counter*, uint value);
 
+//PARALLEL FOR
+//Splits [begin, end) lazily, a range is only halved while the worker's own queue has been drained by thieves,
+//otherwise it keeps running chunks of grain iterations itself. Blocks until every iteration has completed.
+using ParallelForFunc = void(*)(void* data, uint begin, uint end);
+
+CORE_API void parallel_for(Priority, uint begin, uint end, uint grain, ParallelForFunc, void* data);
+
+template<typename F>
+void parallel_for(Priority priority, uint begin, uint end, uint grain, F&& func) {
+	using Func = std::remove_reference_t<F>;
+
+	parallel_for(priority, begin, end, grain, [](void* data, uint begin, uint end) {
+		(*(Func*)data)(begin, end);
+	}, (void*)&func);
+}
+
+template<typename F>
+void parallel_for(uint begin, uint end, uint grain, F&& func) {
+	parallel_for(PRIORITY_HIGH, begin, end, grain, std::forward<F>(func));
+}
+
 //ENGINE_API void wait_for_counter_on_thread(atomic_counter*, uint value = 0);
 
 //#define JOB_ENTRY_POINT(name, type, variable) void name(void* ) 
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "core/job_system/job.h"
+#include "core/container/vector.h"
+
+//TASK GRAPH
+//Every task lists the tasks it depends on when it is added, so predecessors always have lower handles
+//and the graph can't contain cycles. A task is enqueued by whichever predecessor finishes last,
+//only the caller of wait_for_task_graph ever parks.
+
+using task_handle = uint;
+
+struct TaskNode {
+	JobFunc func;
+	void* data;
+	FiberStack stack;
+	struct TaskGraph* graph;
+	uint predecessor_offset;
+	uint predecessor_count;
+	uint successor_offset;
+	uint successor_count;
+};
+
+struct TaskGraph {
+	vector<TaskNode> nodes;
+	vector<task_handle> predecessors;
+	vector<task_handle> successors;
+	//Predecessors which have yet to finish. Atomics can't be moved by vector's memcpy growth,
+	//so the array is only reallocated by schedule_task_graph when the graph outgrew it.
+	atomic_counter* pending = nullptr;
+	uint pending_capacity = 0;
+	Priority priority = PRIORITY_HIGH;
+	atomic_counter counter = {};
+
+	TaskGraph() = default;
+	TaskGraph(const TaskGraph&) = delete;
+	~TaskGraph() { delete[] pending; }
+};
+
+CORE_API task_handle add_task(TaskGraph&, JobDesc, slice<task_handle> depends_on = {});
+CORE_API void schedule_task_graph(TaskGraph&, Priority);
+CORE_API void wait_for_task_graph(TaskGraph&);
+CORE_API void run_task_graph(TaskGraph&, Priority);
+CORE_API void clear_task_graph(TaskGraph&);
+
+template<typename T>
+task_handle add_task(TaskGraph& graph, void(*func)(T&), T* data, slice<task_handle> depends_on = {}) {
+	return add_task(graph, JobDesc(func, data), depends_on);
+}
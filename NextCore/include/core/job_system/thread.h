@@ -9,19 +9,32 @@ struct worker_handle {
 	uint id = 0;
 };
 
+enum WorkerPlacement {
+	WORKER_PLACEMENT_NONE, //leave scheduling to the OS
+	WORKER_PLACEMENT_LOGICAL_CORES, //pin one worker per hardware thread
+	WORKER_PLACEMENT_PHYSICAL_CORES //pin one worker per core, skipping SMT siblings
+};
+
 CORE_API uint get_worker_id();
+CORE_API bool is_worker_thread(); //false for threads the job system did not start, and the main thread before make_job_system
 CORE_API uint hardware_thread_count();
 CORE_API uint worker_thread_count();
 
-#ifdef __APPLE__
-#include <unistd.h>
+//Fills cpus in the order workers should be pinned, cpus sharing a NUMA node are adjacent
+CORE_API uint get_worker_cpus(WorkerPlacement, uint* cpus, uint max_cpus);
+CORE_API uint get_cpu_numa_node(uint cpu);
+CORE_API bool pin_thread_to_cpu(uint cpu);
+CORE_API void set_thread_name(const char*);
+
+#ifdef _WIN32
+#include <Windows.h>
 inline void thread_sleep(u64 time) {
-	usleep(time);
+	Sleep(time / 1000);
 }
 #else
-#include <Windows.h>
+#include <unistd.h>
 inline void thread_sleep(u64 time) {
-	Sleep(time / 1000);
+	usleep(time);
 }
 #endif
 
@@ -57,6 +57,11 @@ struct work_stealing_queue {
 		}
 	}
 
+	//Approximate, only used to decide whether an idle worker may park
+	inline bool empty() const {
+		return (int)top.load() >= bottom;
+	}
+
 	inline bool steal(T* result) {
 		uint top = this->top;
 
@@ -29,16 +29,24 @@ struct AABB {
 		this->min = glm::min(this->min, v);
 	}
 
-	inline AABB apply(const glm::mat4& matrix) {
-		AABB new_aabb;
-
-		glm::vec3 verts[8];
-		to_verts(verts);
-
-		for (int i = 0; i < 8; i++) {
-			glm::vec4 v = matrix * glm::vec4(verts[i], 1.0);
-			new_aabb.update(v);
+	//Arvo's method, the same box as transforming the 8 corners when the matrix is affine.
+	//See core/math/aabb_batch.h for transforming many boxes at once.
+	inline AABB apply(const glm::mat4& matrix) const {
+		glm::vec3 center = centroid();
+		glm::vec3 extent = max - center;
+
+		glm::vec3 new_center = glm::vec3(matrix[3]);
+		glm::vec3 new_extent(0.0f);
+
+		for (int i = 0; i < 3; i++) {
+			glm::vec3 column(matrix[i]);
+			new_center += column * center[i];
+			new_extent += glm::abs(column) * extent[i];
 		}
+
+		AABB new_aabb;
+		new_aabb.min = new_center - new_extent;
+		new_aabb.max = new_center + new_extent;
 		return new_aabb;
 	}
 
@@ -74,5 +82,6 @@ struct AABB {
 	inline glm::vec3 operator[](int i) const { return (&min)[i]; };
 	inline glm::vec3 centroid() const { return (min + max) / 2.0f; };
 	inline glm::vec3 size() const { return max - min; };
+	inline float surface_area() const { glm::vec3 d = max - min; return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x); };
 };
 
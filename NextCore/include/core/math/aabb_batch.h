@@ -0,0 +1,64 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/math/aabb.h"
+#include "core/memory/allocator.h"
+#include <glm/vec4.hpp>
+
+//AABB ARRAYS
+//Boxes stored as separate center and extent arrays, so the batch kernels work on 4 or 8 boxes per instruction.
+//Transforming uses Arvo's method, the center goes through the matrix and the extent through the absolute
+//values of its 3x3 part, which gives the same box as transforming all 8 corners of an affine box.
+//The kernels dispatch to AVX2, SSE4 or scalar code at runtime, see core/simd.h.
+
+struct AABBArrays {
+	float* center[3];
+	float* extent[3];
+};
+
+inline AABBArrays alloc_aabb_arrays(Allocator& allocator, uint count) {
+	AABBArrays arrays;
+	for (uint i = 0; i < 3; i++) {
+		arrays.center[i] = (float*)allocator.allocate(sizeof(float) * count);
+		arrays.extent[i] = (float*)allocator.allocate(sizeof(float) * count);
+	}
+	return arrays;
+}
+
+//The boxes from offset on, to run a kernel over part of the arrays
+inline AABBArrays offset_aabb_arrays(const AABBArrays& arrays, uint offset) {
+	AABBArrays result;
+	for (uint i = 0; i < 3; i++) {
+		result.center[i] = arrays.center[i] + offset;
+		result.extent[i] = arrays.extent[i] + offset;
+	}
+	return result;
+}
+
+inline void set_aabb(AABBArrays& arrays, uint i, const AABB& aabb) {
+	glm::vec3 center = aabb.centroid();
+	glm::vec3 extent = aabb.max - center;
+	for (uint j = 0; j < 3; j++) {
+		arrays.center[j][i] = center[j];
+		arrays.extent[j][i] = extent[j];
+	}
+}
+
+inline AABB get_aabb(const AABBArrays& arrays, uint i) {
+	glm::vec3 center(arrays.center[0][i], arrays.center[1][i], arrays.center[2][i]);
+	glm::vec3 extent(arrays.extent[0][i], arrays.extent[1][i], arrays.extent[2][i]);
+	AABB aabb;
+	aabb.min = center - extent;
+	aabb.max = center + extent;
+	return aabb;
+}
+
+//out may be the same arrays as local
+CORE_API void transform_aabbs(AABBArrays& out, const AABBArrays& local, const glm::mat4* model_m, uint count);
+
+//The same local box under every matrix, like an instanced mesh
+CORE_API void transform_aabbs(AABBArrays& out, const AABB& local, const glm::mat4* model_m, uint count);
+
+//Sets bit i of visible when box i is not entirely behind one of the planes, like frustum_test != OUTSIDE.
+//Planes point inwards, as extract_planes makes them. The (count + 63) / 64 words of visible are overwritten.
+CORE_API void frustum_cull_aabbs(u64* visible, const glm::vec4 planes[6], const AABBArrays& aabbs, uint count);
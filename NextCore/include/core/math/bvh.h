@@ -0,0 +1,110 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/math/aabb.h"
+#include "core/container/vector.h"
+#include "core/container/slice.h"
+
+//BOUNDING VOLUME HIERARCHY
+//Nodes are stored depth-first in one array, an inner node's first child directly follows it and its second
+//child follows the first child's subtree. Every inner node stores the index just past its subtree, so a query
+//is a single forward loop, stepping into a node that overlaps or skipping past the subtree of one that doesn't.
+//Leaves reference a range of indices, which lists the primitives in leaf order.
+
+constexpr uint BVH_MAX_BINS = 32;
+
+enum BVHSplit {
+	BVH_SPLIT_SAH, //binned surface area heuristic
+	BVH_SPLIT_MEDIAN, //object median along the longest axis of the centroids
+};
+
+struct BVHBuildSettings {
+	BVHSplit split = BVH_SPLIT_SAH;
+	uint bins = 16; //at most BVH_MAX_BINS
+	uint max_leaf_size = 8; //SAH can stop earlier when splitting isn't worth it
+	//Cost of visiting a node relative to testing one primitive. For frustum culling a node costs about as much
+	//as a box, but the skip branches and deeper trees made 4 cull fastest in MathBenchmark, 1 gives leaves of 1-2 boxes.
+	float traversal_cost = 4.0f;
+	uint parallel_threshold = 4096; //ranges with fewer primitives are built on the job that reached them
+};
+
+struct BVHNode {
+	AABB aabb;
+	uint offset; //first index of a leaf, the node after the subtree of an inner node
+	uint count; //primitives in a leaf, 0 for inner nodes
+};
+
+static_assert(sizeof(BVHNode) == 32, "two nodes per cache line");
+
+struct BVH {
+	vector<BVHNode> nodes;
+	vector<uint> indices;
+
+	BVH() {
+		nodes.allocator = &default_allocator;
+		indices.allocator = &default_allocator;
+	}
+};
+
+//Rebuilds bvh over the bounds, primitive i is bounds[i]. Splits the work into jobs once ranges
+//are large enough, call it from a job or a thread converted to a fiber.
+//The result only depends on the bounds and settings, not on how the jobs were scheduled.
+CORE_API void build_bvh(BVH& bvh, slice<AABB> bounds, const BVHBuildSettings& settings = {});
+
+inline bool is_leaf(const BVHNode& node) { return node.count > 0; }
+
+//Index of the next node when node i and its subtree are skipped
+inline uint bvh_skip(const BVHNode& node, uint i) { return is_leaf(node) ? i + 1 : node.offset; }
+
+//Recomputes the boxes of the inner nodes from their children, after the caller updated the leaf boxes.
+//Keeps the topology, so it's much cheaper than a rebuild but the tree gets worse the further primitives moved.
+CORE_API void refit_bvh(BVH& bvh);
+
+//TRAVERSAL
+struct BVHQueryStats {
+	uint nodes_tested = 0;
+	uint leaves_visited = 0;
+	uint primitives = 0; //in the visited leaves
+};
+
+//overlaps(const AABB&) decides if a node is visited, visit(const BVHNode&) is called for every visited leaf,
+//its primitives are indices[leaf.offset, leaf.offset + leaf.count)
+template<typename Overlaps, typename Visit>
+void query_bvh(const BVH& bvh, Overlaps&& overlaps, Visit&& visit, BVHQueryStats* stats = nullptr) {
+	const BVHNode* nodes = bvh.nodes.data;
+	uint node_count = bvh.nodes.length;
+
+	for (uint i = 0; i < node_count;) {
+		const BVHNode& node = nodes[i];
+		if (stats) stats->nodes_tested++;
+
+		if (!overlaps(node.aabb)) {
+			i = bvh_skip(node, i);
+			continue;
+		}
+
+		if (is_leaf(node)) {
+			if (stats) {
+				stats->leaves_visited++;
+				stats->primitives += node.count;
+			}
+			visit(node);
+		}
+
+		i++;
+	}
+}
+
+//STATISTICS
+//sah_cost is the expected cost of a query hitting a random point of the root's surface, in units of one
+//primitive test, lower means less work culling or ray casting
+struct BVHStats {
+	uint node_count = 0;
+	uint leaf_count = 0;
+	uint max_depth = 0;
+	uint max_leaf_size = 0;
+	float average_leaf_size = 0.0f;
+	float sah_cost = 0.0f;
+};
+
+CORE_API BVHStats bvh_stats(const BVH& bvh, float traversal_cost = 4.0f);
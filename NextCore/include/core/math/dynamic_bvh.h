@@ -0,0 +1,89 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/math/aabb.h"
+#include "core/container/vector.h"
+
+//DYNAMIC BOUNDING VOLUME HIERARCHY
+//A binary tree for objects that are added, removed and moved every frame, see core/math/bvh.h for static ones.
+//Leaves store the object's box grown by a margin and stretched along its last move, so small or steady moves
+//don't touch the tree at all. Leaves which moved out of their box are refit, updating their ancestors on the
+//way up, or reinserted when they moved too far.
+//Every node whose box changes tries a rotation, swapping a child with a grandchild when that shrinks the
+//surface area, and rebalance_dynamic_bvh keeps rotating a few nodes each frame to undo the refits' damage.
+
+constexpr uint DYNAMIC_BVH_NULL = ~0u;
+
+struct DynamicBVHNode {
+	AABB aabb; //fattened by the margin for leaves
+	uint parent; //DYNAMIC_BVH_NULL for the root, the next free node while on the free list
+	uint child[2]; //DYNAMIC_BVH_NULL for leaves
+	uint height; //0 for leaves
+	uint user; //the index given to insert_dynamic_bvh, for leaves
+};
+
+struct DynamicBVH {
+	vector<DynamicBVHNode> nodes;
+	uint root = DYNAMIC_BVH_NULL;
+	uint free_list = DYNAMIC_BVH_NULL;
+	uint leaf_count = 0;
+	uint rebalance_cursor = 0; //node rebalance_dynamic_bvh continues from
+	float margin = 0.1f; //leaves are this much larger than the boxes on every side
+
+	DynamicBVH() {
+		nodes.allocator = &default_allocator;
+	}
+};
+
+inline bool is_leaf(const DynamicBVHNode& node) { return node.child[0] == DYNAMIC_BVH_NULL; }
+
+//Returns the leaf, which identifies the object until it's removed
+CORE_API uint insert_dynamic_bvh(DynamicBVH& bvh, const AABB& aabb, uint user);
+CORE_API void remove_dynamic_bvh(DynamicBVH& bvh, uint leaf);
+
+//Returns false when aabb still fits the leaf and nothing was done
+CORE_API bool move_dynamic_bvh(DynamicBVH& bvh, uint leaf, const AABB& aabb);
+
+//Tries a rotation at the next count nodes of the array, continuing where the last call stopped
+CORE_API void rebalance_dynamic_bvh(DynamicBVH& bvh, uint count);
+
+CORE_API void clear_dynamic_bvh(DynamicBVH& bvh);
+
+//Sum of the inner nodes' surface areas relative to the root, lower is a tighter tree
+CORE_API float dynamic_bvh_area_ratio(const DynamicBVH& bvh);
+
+//overlaps(const AABB&) decides if a node is visited, visit(const DynamicBVHNode&) is called for every visited leaf.
+//Leaves are fattened, so visit usually tests the object's own box as well.
+template<typename Overlaps, typename Visit>
+void query_dynamic_bvh(const DynamicBVH& bvh, Overlaps&& overlaps, Visit&& visit) {
+	if (bvh.root == DYNAMIC_BVH_NULL) return;
+
+	//Both children of every node on the path are pushed, so the stack never holds more than height + 1 nodes
+	uint local_stack[64];
+	vector<uint> heap_stack;
+
+	uint* stack = local_stack;
+	uint height = bvh.nodes[bvh.root].height;
+	if (height + 1 > 64) {
+		heap_stack.allocator = &default_allocator;
+		heap_stack.resize(height + 1);
+		stack = heap_stack.data;
+	}
+
+	const DynamicBVHNode* nodes = bvh.nodes.data;
+	uint count = 0;
+	stack[count++] = bvh.root;
+
+	while (count > 0) {
+		const DynamicBVHNode& node = nodes[stack[--count]];
+		if (!overlaps(node.aabb)) continue;
+
+		if (is_leaf(node)) {
+			visit(node);
+		}
+		else {
+			stack[count++] = node.child[1];
+			stack[count++] = node.child[0];
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "core/core.h"
+#include <glm/mat4x4.hpp>
+#include <glm/mat4x3.hpp>
+
+//BATCHED MODEL MATRICES
+//Builds translate * scale * rotation matrices, the same as compute_model_matrix, from arrays of each component.
+//The kernels dispatch at runtime to AVX, 8 transforms per iteration, or SSE, 4 per iteration, see core/simd.h.
+//The remainder and other targets use the scalar lanes. Every path evaluates the same expressions in
+//model_matrix_lanes, so they agree up to rounding.
+//Rotations are expected to be normalized.
+
+struct TransformArrays {
+	const float* position[3];
+	const float* rotation[4]; //x, y, z, w
+	const float* scale[3];
+};
+
+struct f32x1 {
+	float v;
+
+	static f32x1 load(const float* ptr) { return { *ptr }; }
+	static f32x1 splat(float value) { return { value }; }
+};
+
+inline f32x1 operator+(f32x1 a, f32x1 b) { return { a.v + b.v }; }
+inline f32x1 operator-(f32x1 a, f32x1 b) { return { a.v - b.v }; }
+inline f32x1 operator*(f32x1 a, f32x1 b) { return { a.v * b.v }; }
+
+//Columns of the matrices in m, rows is 3 for 4x3 matrices and 4 for 4x4
+template<typename V, uint rows>
+inline void model_matrix_lanes(const TransformArrays& t, uint i, V* m) {
+	V x = V::load(t.rotation[0] + i);
+	V y = V::load(t.rotation[1] + i);
+	V z = V::load(t.rotation[2] + i);
+	V w = V::load(t.rotation[3] + i);
+
+	V one = V::splat(1.0f);
+	V two = V::splat(2.0f);
+
+	V xx = x * x, yy = y * y, zz = z * z;
+	V xy = x * y, xz = x * z, yz = y * z;
+	V wx = w * x, wy = w * y, wz = w * z;
+
+	V rotation[3][3] = {
+		{ one - two * (yy + zz), two * (xy + wz), two * (xz - wy) },
+		{ two * (xy - wz), one - two * (xx + zz), two * (yz + wx) },
+		{ two * (xz + wy), two * (yz - wx), one - two * (xx + yy) },
+	};
+
+	for (uint row = 0; row < 3; row++) {
+		V scale = V::load(t.scale[row] + i);
+		for (uint column = 0; column < 3; column++) m[column * rows + row] = scale * rotation[column][row];
+		m[3 * rows + row] = V::load(t.position[row] + i);
+	}
+
+	if constexpr (rows == 4) {
+		V zero = V::splat(0.0f);
+		for (uint column = 0; column < 3; column++) m[column * 4 + 3] = zero;
+		m[15] = one;
+	}
+}
+
+CORE_API void compute_model_matrices(glm::mat4* out, const TransformArrays& t, uint count);
+
+//4x3 drops the last row, which is always 0, 0, 0, 1
+CORE_API void compute_model_matrices(glm::mat4x3* out, const TransformArrays& t, uint count);
@@ -1,49 +1,31 @@
 #pragma once
 
 #include <cstddef>
+#include <new>
 #include "core/core.h"
 #include <string.h>
 #include <assert.h>
 
+//Every allocator returns memory aligned to at least this, types which need more have to ask
+//SlabAllocator for it explicitly or align by hand
+constexpr uint MAX_ALLOCATOR_ALIGNMENT = 16;
+
 struct CORE_API Allocator {
 	virtual void* allocate(std::size_t) { return NULL;  };
 	virtual void deallocate(void* ptr) {};
 };
 
-struct CORE_API BlockAllocator : Allocator {
-	static constexpr int block_size = 16000;
-	static constexpr int num_blocks = 20;
-
-	struct Block {
-		Block* next = NULL;
-		char data[block_size];
-		size_t offset = 0;
-		uint count = 0;
-	};
-	
-	Block blocks[num_blocks];
-
-	Block* free_block = NULL;
-
-	BlockAllocator(const BlockAllocator &) = delete;
-
-	void* allocate(std::size_t);
-	void deallocate(void* ptr);
-
-	void next_empty_block();
-
-	BlockAllocator();
-};
-
-struct CORE_API MallocAllocator : Allocator {
+//Size class slab allocator with a free list cache per thread, see allocator.cpp.
+//All instances share the same pools, memory may be freed from any thread.
+struct CORE_API SlabAllocator : Allocator {
 	void* allocate(std::size_t);
+	void* allocate(std::size_t, uint alignment);
 	void deallocate(void* ptr);
 };
 
-extern CORE_API BlockAllocator block_allocator;
-extern CORE_API MallocAllocator default_allocator;
+extern CORE_API SlabAllocator default_allocator;
 
-#define ALLOC(T, ...) new (default_allocator.allocate(sizeof(T)) T((__VA_ARGS__)
+#define ALLOC(T, ...) new (default_allocator.allocate(sizeof(T), alignof(T))) T(__VA_ARGS__)
 
 template<typename T>
 inline void FREE(T* ptr) {
@@ -52,7 +34,7 @@ inline void FREE(T* ptr) {
 	default_allocator.deallocate(ptr);
 }
 
-#define ALLOC_ARRAY(T, N) new (default_allocator.allocate(sizeof(T) * N)) T[N]
+#define ALLOC_ARRAY(T, N) new (default_allocator.allocate(sizeof(T) * N, alignof(T))) T[N]
 
 template<typename T>
 inline void FREE_ARRAY(T* ptr, std::size_t N) {
@@ -83,6 +65,7 @@ T* realloc_t(T* prev, u64 count) {
 
 template<typename T, typename Allocator>
 T* alloc_t(Allocator& allocator, uint num = 1) {
+	static_assert(alignof(T) <= MAX_ALLOCATOR_ALIGNMENT, "over aligned types need SlabAllocator::allocate with an alignment");
     return new (allocator.allocate(num * sizeof(T))) T();
 }
 
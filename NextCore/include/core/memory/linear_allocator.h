@@ -4,25 +4,37 @@
 #include "core/memory/allocator.h"
 #include <new>
 
+enum LinearAllocatorMode : u8 {
+	LINEAR_FIXED, //one allocation of max_size from parent
+	LINEAR_VIRTUAL, //max_size of address space is reserved, pages are committed as occupied grows
+	LINEAR_CHAINED, //fallback where address space can't be reserved, blocks from parent are chained
+};
+
+struct LinearBlock {
+	LinearBlock* prev;
+	LinearBlock* next;
+	u64 base; //offset of the block's first byte
+	u64 size;
+};
+
+//occupied is a plain offset in every mode, so it can still be saved and restored to free everything allocated since
 struct LinearAllocator : Allocator {
 	u64 occupied;
 	u64 max_size;
 
-	char* memory;
+	char* memory; //memory of the current block when chained
 	Allocator* parent;
 
+	LinearAllocatorMode mode = LINEAR_FIXED;
+	u64 floor = 0; //range of offsets which can be handed out without growing
+	u64 limit = 0;
+	u64 committed = 0; //bytes backed by memory
+	u64 peak = 0; //highest occupied since the owner last reset it
+	LinearBlock* block = nullptr;
+
 	LinearAllocator(const LinearAllocator&) = delete;
 	
-	inline void operator=(LinearAllocator&& allocator) {
-		occupied = allocator.occupied;
-		max_size = allocator.max_size;
-		memory = allocator.memory;
-		parent = allocator.parent;
-
-		allocator.occupied = 0;
-		allocator.max_size = 0;
-		allocator.memory = nullptr;
-	}
+	CORE_API void operator=(LinearAllocator&& allocator);
 
 	inline LinearAllocator() {
 		occupied = 0;
@@ -36,22 +48,25 @@ struct LinearAllocator : Allocator {
 		this->occupied = 0;
 		this->max_size = max_size;
 		this->memory = (char*)parent->allocate(max_size);
+		this->limit = max_size;
+		this->committed = max_size;
 	}
 
-	inline ~LinearAllocator() {
-		if (parent) parent->deallocate(memory);
-	}
+	//Growable allocators can reserve far more than will ever be used, e.g LinearAllocator(LINEAR_VIRTUAL, gb(4))
+	CORE_API LinearAllocator(LinearAllocatorMode mode, u64 max_size, Allocator* parent = &default_allocator);
+	CORE_API ~LinearAllocator();
 
 	inline void* allocate(size_t size) final {
-		u64 offset = aligned_incr(&occupied, size, 16);
-
-		if (occupied > max_size) {
-			throw "Temporary allocator out of memory";
-		}
+		u64 offset = align_offset(occupied, 16);
+		if (offset + size > limit || offset < floor) return allocate_slow(size);
 
-		return memory + offset;
+		occupied = offset + size;
+		if (occupied > peak) peak = occupied;
+		return memory + (offset - floor);
 	}
 
+	CORE_API void* allocate_slow(size_t size);
+
 	inline void reset(size_t occupied) {
 		this->occupied = occupied;
 	}
@@ -59,6 +74,9 @@ struct LinearAllocator : Allocator {
 	inline void clear() {
 		this->occupied = 0;
 	}
+
+	//Gives back memory above max(occupied, high_water), a fixed allocator keeps its memory
+	CORE_API void trim(u64 high_water);
 };
 
 struct LinearRegion {
@@ -83,5 +101,5 @@ CORE_API LinearAllocator& get_thread_local_permanent_allocator();
 #define TEMPORARY_ARRAY(name, num) new (get_temporary_allocator().allocate(sizeof(name) * num)) name[num]
 #define TEMPORARY_ZEROED_ARRAY(name, num) new (get_temporary_allocator().allocate(sizeof(name) * num)) name[num]()
 
-#define PERMANENT_ALLOC(name, ...) new (get_permanent_allocator().allocate(sizeof(name))) name(__VA_ARGS__)
-#define PERMANENT_ARRAY(name, num) new (get_permanent_allocator().allocate(sizeof(name) * num)) name[num]
+#define PERMANENT_ALLOC(name, ...) new (default_allocator.allocate(sizeof(name), alignof(name))) name(__VA_ARGS__)
+#define PERMANENT_ARRAY(name, num) new (default_allocator.allocate(sizeof(name) * num, alignof(name))) name[num]
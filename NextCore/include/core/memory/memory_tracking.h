@@ -0,0 +1,57 @@
+#pragma once
+
+#include "core/memory/allocator.h"
+#include "core/job_system/thread.h"
+
+//MEMORY TRACKING
+//Subsystems opt in by allocating through their tagged allocator, or by reporting the arenas they carve up
+//themselves with track_allocation. Nothing is recorded for untagged allocations.
+
+enum MemoryTag : u8 {
+	MEMORY_UNTAGGED,
+	MEMORY_ECS,
+	MEMORY_ASSETS,
+	MEMORY_RENDERER,
+	MEMORY_CFD,
+	MEMORY_UI,
+	MEMORY_TAG_COUNT
+};
+
+struct MemoryStats {
+	u64 allocated; //bytes currently held
+	u64 high_water;
+	u64 allocations; //allocations currently held
+	u64 budget; //0 if unbounded
+};
+
+struct TemporaryMemoryStats {
+	u64 last_frame_peak;
+	u64 high_water;
+};
+
+//Every allocation carries a small header with its size, so the parent needs no way of reporting it
+struct CORE_API TaggedAllocator : Allocator {
+	Allocator* parent;
+	MemoryTag tag;
+
+	TaggedAllocator(MemoryTag tag, Allocator* parent = &default_allocator);
+
+	void* allocate(std::size_t);
+	void deallocate(void* ptr);
+};
+
+CORE_API Allocator& get_tagged_allocator(MemoryTag);
+CORE_API const char* memory_tag_name(MemoryTag);
+
+CORE_API void track_allocation(MemoryTag, u64 size, u64 count = 1);
+CORE_API void track_deallocation(MemoryTag, u64 size, u64 count = 1);
+
+//Exceeding a budget is logged once and asserts in debug builds
+CORE_API void set_memory_budget(MemoryTag, u64 budget);
+CORE_API MemoryStats get_memory_stats(MemoryTag);
+
+//Called by each worker at the end of a frame, before its temporary allocator is cleared
+CORE_API void record_temporary_peak(u64 peak);
+CORE_API TemporaryMemoryStats get_temporary_memory_stats(uint worker);
+
+#define TAGGED_ALLOC(tag, name, ...) new (get_tagged_allocator(tag).allocate(sizeof(name))) name(__VA_ARGS__)
@@ -38,9 +38,44 @@ struct Frame {
 	vector<ProfileData> profiles;
 };
 
+const uint MAX_FRAME_SAMPLES = 1000;
+
+//Ring of the most recent frames, once full the oldest frame and its profile storage are reused
+struct FrameHistory {
+	Frame frames[MAX_FRAME_SAMPLES];
+	uint first = 0;
+	uint length = 0;
+
+	Frame& operator[](uint i) {
+		assert(i < length);
+		return frames[(first + i) % MAX_FRAME_SAMPLES];
+	}
+
+	Frame& last() {
+		return (*this)[length - 1];
+	}
+
+	void drop_oldest(uint count) {
+		assert(count <= length);
+		first = (first + count) % MAX_FRAME_SAMPLES;
+		length -= count;
+	}
+
+	Frame& push() {
+		if (length == MAX_FRAME_SAMPLES) drop_oldest(1);
+
+		Frame& frame = frames[(first + length++) % MAX_FRAME_SAMPLES];
+		frame.start_of_frame = 0.0;
+		frame.frame_duration = 0.0;
+		frame.frame_swap_duration = 0.0;
+		frame.profiles.clear();
+		return frame;
+	}
+};
+
 struct Profiler {
 	static bool CORE_API paused;
-	static vector<Frame> CORE_API frames[MAX_THREADS];
+	static FrameHistory CORE_API frames[MAX_THREADS];
 	static int CORE_API profile_depth[MAX_THREADS];
 	static uint CORE_API frame_sample_count;
 
@@ -5,15 +5,41 @@
 #include "core/container/string_buffer.h"
 #include "core/container/sstring.h"
 #include "core/container/array.h"
+#include "core/memory/linear_allocator.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+//Without an allocator the buffer is fixed size, otherwise data comes from the allocator and doubles when full.
+//Growth extends the buffer in place when nothing else was allocated from the allocator in between,
+//so a LINEAR_VIRTUAL allocator owned by the buffer only commits what is written.
 struct SerializerBuffer {
 	char* data;
 	uint index = 0;
 	uint capacity;
+	LinearAllocator* allocator = nullptr;
 };
 
+inline void grow_serializer_buffer(SerializerBuffer& buffer, u64 size) {
+	assert(buffer.allocator);
+
+	u64 capacity = buffer.capacity == 0 ? kb(4) : (u64)buffer.capacity * 2;
+	if (capacity < buffer.index + size) capacity = buffer.index + size;
+	capacity = align_offset(capacity, 16);
+	assert(capacity < (1ull << 32));
+
+	char* tail = (char*)buffer.allocator->allocate(capacity - buffer.capacity);
+	if (!buffer.data) {
+		buffer.data = tail;
+	}
+	else if (tail != buffer.data + buffer.capacity) {
+		char* data = (char*)buffer.allocator->allocate(capacity);
+		memcpy(data, buffer.data, buffer.index);
+		buffer.data = data;
+	}
+
+	buffer.capacity = capacity;
+}
+
 struct DeserializerBuffer {
 	char* data;
 	uint index;
@@ -21,6 +47,7 @@ struct DeserializerBuffer {
 };
  
 inline void write_n_to_buffer(SerializerBuffer& buffer, void* ptr, u64 size) {
+	if (buffer.index + size > buffer.capacity && buffer.allocator) grow_serializer_buffer(buffer, size);
 	assert(buffer.index + size <= buffer.capacity);
 	memcpy(buffer.data + buffer.index, ptr, size);
 	buffer.index += size;
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "core/core.h"
+
+//SIMD DISPATCH
+//Kernels with several instruction set paths pick one at runtime, so the engine can be built for the baseline
+//x64 target and still use AVX2 where the cpu and os support it.
+
+enum SimdLevel {
+	SIMD_SCALAR,
+	SIMD_SSE2, //always there on x64
+	SIMD_SSE4, //SSE4.1
+	SIMD_AVX2, //AVX2 and FMA
+};
+
+//Highest level supported by the cpu and enabled by the os
+CORE_API SimdLevel detect_simd_level();
+
+//Level used by the dispatching kernels, detected on first use
+CORE_API SimdLevel simd_level();
+
+//Lowers the level kernels dispatch to, for benchmarks and comparing paths. Can't go above the detected level.
+CORE_API void set_simd_level(SimdLevel level);
+
+CORE_API const char* simd_level_name(SimdLevel level);
+
+//Functions using intrinsics above the baseline need to be compiled for that target on gcc and clang.
+//MSVC accepts any intrinsic without it.
+#if defined(__GNUC__) || defined(__clang__)
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SIMD_TARGET(isa)
+#endif
+
+//Kernels built from helpers shared between targets inline all of them, a helper compiled for the baseline
+//target would pass the vectors with a different calling convention than the kernel
+#if defined(__GNUC__) || defined(__clang__)
+#define SIMD_FLATTEN __attribute__((flatten))
+#else
+#define SIMD_FLATTEN
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define NE_SIMD_X86
+#endif
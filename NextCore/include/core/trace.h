@@ -0,0 +1,48 @@
+#pragma once
+
+#include "core/core.h"
+
+//TIMELINE TRACING
+//Every worker appends to its own fixed size ring of events, the oldest events are overwritten once it is full.
+//Only the owning worker writes to a ring, so recording is a plain store followed by a release of the head.
+//Events remember the fiber they were recorded on, as a job parked in wait_for_counter lets other jobs begin
+//and end on the same worker before it continues.
+//Threads which are not job workers have no ring, events recorded on them are dropped.
+//Set NE_TRACE_FILE to capture a trace headlessly, it is written when the job system is destroyed.
+
+enum TraceEventType : u16 {
+	TRACE_SCOPE_BEGIN,
+	TRACE_SCOPE_END,
+	TRACE_JOB_BEGIN,
+	TRACE_JOB_END,
+	TRACE_JOB_ENQUEUE,
+	TRACE_JOB_STEAL,
+	TRACE_FIBER_SWITCH,
+	TRACE_WORKER_SLEEP,
+	TRACE_WORKER_WAKE,
+};
+
+struct TraceEvent {
+	u64 time; //nanoseconds
+	const char* name;
+	const void* fiber;
+	TraceEventType type;
+	uint arg;
+};
+
+const uint TRACE_BUFFER_SIZE = 1 << 15;
+
+CORE_API void make_trace_buffers(uint num_workers);
+CORE_API void destroy_trace_buffers();
+
+CORE_API void begin_tracing();
+CORE_API void end_tracing();
+CORE_API bool is_tracing();
+
+CORE_API void trace_event(TraceEventType, const char* name = nullptr, uint arg = 0);
+
+//Tracing is paused while exporting, and the export waits for workers to finish the event they are recording,
+//so it may be called while jobs run. Spans are matched per fiber and written as complete events on their worker,
+//spans which partially overlap one of another fiber are written as async events instead.
+//Spans still open at the time of the export are left out.
+CORE_API bool export_chrome_trace(const char* path);
@@ -0,0 +1,56 @@
+#include "stdafx.h"
+#include "core/container/bitset.h"
+
+#ifdef NE_SIMD_X86
+#include <immintrin.h>
+
+//AVX2 KERNELS
+//Four words at a time, the bitset.h loops finish the remainder
+
+#define NE_BITS_BINARY_OP_AVX2(name, avx2_op, scalar_op) \
+SIMD_TARGET("avx2") \
+void name(u64* dst, const u64* src, uint words) { \
+	uint i = 0; \
+	for (; i + 4 <= words; i += 4) { \
+		__m256i a = _mm256_loadu_si256((const __m256i*)(dst + i)); \
+		__m256i b = _mm256_loadu_si256((const __m256i*)(src + i)); \
+		_mm256_storeu_si256((__m256i*)(dst + i), avx2_op); \
+	} \
+	for (; i < words; i++) dst[i] = scalar_op; \
+}
+
+NE_BITS_BINARY_OP_AVX2(bits_or_avx2, _mm256_or_si256(a, b), dst[i] | src[i])
+NE_BITS_BINARY_OP_AVX2(bits_and_avx2, _mm256_and_si256(a, b), dst[i] & src[i])
+NE_BITS_BINARY_OP_AVX2(bits_xor_avx2, _mm256_xor_si256(a, b), dst[i] ^ src[i])
+NE_BITS_BINARY_OP_AVX2(bits_andnot_avx2, _mm256_andnot_si256(b, a), dst[i] & ~src[i])
+
+#undef NE_BITS_BINARY_OP_AVX2
+
+//Looks up the popcount of each nibble and sums the bytes of every word with sad,
+//popcnt is used for the remainder as every AVX2 cpu has it
+SIMD_TARGET("avx2,popcnt")
+uint bits_count_avx2(const u64* words, uint count) {
+	const __m256i lookup = _mm256_setr_epi8(
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+	);
+	const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+
+	__m256i total = _mm256_setzero_si256();
+	uint i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(words + i));
+		__m256i low = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low_nibble));
+		__m256i high = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibble));
+		total = _mm256_add_epi64(total, _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256()));
+	}
+
+	u64 lanes[4];
+	_mm256_storeu_si256((__m256i*)lanes, total);
+
+	u64 result = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	for (; i < count; i++) result += count_bits(words[i]);
+	return (uint)result;
+}
+#endif
@@ -5,44 +5,95 @@
 #include "core/job_system/work_stealing_queue.h"
 #include "core/container/queue.h"
 #include "core/container/array.h"
+#include "core/container/vector.h"
+#include "core/container/bitset.h"
+#include "core/trace.h"
 
 #include <mutex>
 #include <thread>
+#include <condition_variable>
+#include <stdlib.h>
+
+#ifdef NE_PLATFORM_LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 thread_local worker_handle worker;
 
-constexpr uint MAX_FIBERS = 1000;
 constexpr uint MAX_JOBS = 10000;
+constexpr uint WORKER_SPIN_COUNT = 64; //idle iterations spent polling the queues before parking
+constexpr uint FIBER_POOL_CHUNK = 16; //fibers created at once when a pool runs dry
+
+const u64 fiber_stack_sizes[FIBER_STACK_COUNT] = {
+	kb(32),
+	kb(128),
+	mb(1)
+};
 
 struct Job {
 	JobFunc func;
 	void* data;
 	atomic_counter* counter;
+	FiberStack stack;
 };
 
 struct ParkedFiber {
 	Fiber* fiber;
 	atomic_counter* counter;
 	uint value;
+	FiberStack stack;
 };
 
 using JobQueue = work_stealing_queue<MAX_JOBS, Job>; //todo change order
-using FiberPool = array<MAX_FIBERS, Fiber*>;
-using WaitList = array<MAX_FIBERS, ParkedFiber>;
+using FiberPool = vector<Fiber*>;
+using WaitList = vector<ParkedFiber>;
+
+//Allocated by the worker itself once it is pinned, so the pages are first touched on its NUMA node
+struct alignas(64) WorkerQueues {
+	JobQueue queues[PRIORITY_COUNT] = {};
+	queue<Job, 10> private_queue;
+};
 
 //JOB SYSTEM DATA
 //note: no job stealing, fibers always remain on the same thread
 std::atomic<bool> workers_exit;
 array<MAX_THREADS, std::thread> workers;
-JobQueue queues[MAX_THREADS][PRIORITY_COUNT] = {};
-queue<Job, 10> private_queue[MAX_THREADS] = {};
+WorkerQueues* worker_queues[MAX_THREADS];
+
+//FIBERS
+//Pools grow in chunks and never hand out a fiber with a smaller stack than requested.
+//A job needing a larger stack than the running fiber is handed to a fresh fiber through pending_jobs,
+//the new fiber then keeps running the worker loop. Waiting yields to a fiber sized for the next job in the
+//worker's queues the same way, or to a small fiber which only runs the worker loop when they are empty.
+FiberPool fiber_pools[MAX_THREADS][FIBER_STACK_COUNT];
+FiberStack current_stack[MAX_THREADS]; //stack class of the fiber each worker is running
+Job pending_jobs[MAX_THREADS];
+WaitList wait_lists[MAX_THREADS]; //pools and wait lists use default_allocator, the scheduler can't depend on a fiber's context
+
+//PARKING
+//Every worker parks on its own futex word, a bit in sleeping_mask doubles as the count of parked workers.
+//Wakers claim the bit before signalling, so each parked worker is woken exactly once.
+enum WorkerState : uint {
+	WORKER_RUNNING,
+	WORKER_PARKED
+};
+
+struct alignas(64) WorkerParking {
+	std::atomic<uint> state;
+#ifndef NE_PLATFORM_LINUX
+	std::mutex mutex;
+	std::condition_variable cond;
+#endif
+};
 
-FiberPool fiber_pools[MAX_THREADS] = {};
-WaitList wait_lists[MAX_THREADS] = {};
+WorkerParking parking[MAX_THREADS] = {};
+std::atomic<u64> sleeping_mask;
+std::atomic<u64> waiting_mask; //workers with fibers in their wait list
+std::atomic<uint> wait_threshold[MAX_THREADS]; //largest value a parked fiber of the worker waits for
 
-std::mutex work_mutex;
-bool sleeping_workers;
-std::condition_variable work;
+static_assert(MAX_THREADS <= 64, "sleeping_mask stores one bit per worker");
 
 uint hardware_thread_count() {
 	return std::thread::hardware_concurrency();
@@ -57,29 +108,130 @@ uint get_worker_id() {
 	return worker.id - 1;
 }
 
-Fiber* alloc_fiber() {
-	FiberPool& pool = fiber_pools[get_worker_id()];
-	
-	if (pool.length == 0) {
-		printf("Run out of fibers!!\n");
-		abort();
+bool is_worker_thread() {
+	return worker.id != 0;
+}
+
+void run_fiber(void*);
+
+void grow_fiber_pool(uint worker, FiberStack stack, uint count) {
+	FiberPool& pool = fiber_pools[worker][stack];
+	for (uint i = 0; i < count; i++) {
+		pool.append(make_fiber(fiber_stack_sizes[stack], run_fiber));
 	}
+}
 
+Fiber* alloc_fiber(FiberStack stack) {
+	uint worker = get_worker_id();
+	FiberPool& pool = fiber_pools[worker][stack];
+	
+	if (pool.length == 0) grow_fiber_pool(worker, stack, FIBER_POOL_CHUNK);
 	return pool.pop();
 }
 
-void dealloc_fiber(Fiber* fiber) {
-	FiberPool& pool = fiber_pools[get_worker_id()];
+void dealloc_fiber(Fiber* fiber, FiberStack stack) {
+	FiberPool& pool = fiber_pools[get_worker_id()][stack];
 	pool.append(fiber);
 }
 
+void switch_to_fiber(Fiber* fiber, FiberStack stack) {
+	current_stack[get_worker_id()] = stack;
+	trace_event(TRACE_FIBER_SWITCH);
+	switch_to_fiber(fiber);
+}
 
-void resume_sleeping_workers() {
-    if (sleeping_workers) {
-        std::unique_lock lock(work_mutex);
-        sleeping_workers = false;
-        work.notify_all();
-    }
+
+inline uint count_trailing_zeros(u64 mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, mask);
+	return index;
+#else
+	return __builtin_ctzll(mask);
+#endif
+}
+
+void wait_on_state(WorkerParking& parking) {
+#ifdef NE_PLATFORM_LINUX
+	while (parking.state.load(std::memory_order_acquire) == WORKER_PARKED) {
+		syscall(SYS_futex, &parking.state, FUTEX_WAIT_PRIVATE, WORKER_PARKED, nullptr, nullptr, 0);
+	}
+#else
+	std::unique_lock lock(parking.mutex);
+	parking.cond.wait(lock, [&] { return parking.state.load(std::memory_order_acquire) != WORKER_PARKED; });
+#endif
+}
+
+void signal_state(WorkerParking& parking) {
+#ifdef NE_PLATFORM_LINUX
+	parking.state.store(WORKER_RUNNING, std::memory_order_release);
+	syscall(SYS_futex, &parking.state, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+	{
+		std::unique_lock lock(parking.mutex);
+		parking.state.store(WORKER_RUNNING, std::memory_order_release);
+	}
+	parking.cond.notify_one();
+#endif
+}
+
+//Returns false if the worker was not parked or another thread already claimed the wakeup
+bool unpark_worker(uint worker) {
+	u64 bit = 1ull << worker;
+	if (!(sleeping_mask.fetch_and(~bit) & bit)) return false;
+
+	signal_state(parking[worker]);
+	return true;
+}
+
+void wake_workers(uint count) {
+	while (count > 0) {
+		u64 mask = sleeping_mask.load();
+		if (mask == 0) return;
+
+		if (unpark_worker(count_trailing_zeros(mask))) count--;
+	}
+}
+
+void wake_all_workers() {
+	u64 mask = sleeping_mask.load();
+	while (mask) {
+		unpark_worker(count_trailing_zeros(mask));
+		mask &= mask - 1;
+	}
+}
+
+//Called after pushing jobs or decrementing a counter and before reading sleeping_mask,
+//pairs with the fence in park_worker so a worker can't go to sleep with the work unseen
+inline void publish_jobs() {
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+//Only wakes parked workers which have a fiber that could be waiting for this value
+void wake_waiting_workers(uint counter_value) {
+	publish_jobs();
+	u64 mask = sleeping_mask.load() & waiting_mask.load();
+	while (mask) {
+		uint worker = count_trailing_zeros(mask);
+		mask &= mask - 1;
+
+		if (counter_value <= wait_threshold[worker].load(std::memory_order_relaxed)) unpark_worker(worker);
+	}
+}
+
+void update_wait_threshold(uint worker) {
+	WaitList& wait_list = wait_lists[worker];
+
+	uint threshold = 0;
+	for (ParkedFiber& parked : wait_list) {
+		if (parked.value > threshold) threshold = parked.value;
+	}
+
+	wait_threshold[worker].store(threshold, std::memory_order_relaxed);
+
+	u64 bit = 1ull << worker;
+	if (wait_list.length > 0) waiting_mask.fetch_or(bit);
+	else waiting_mask.fetch_and(~bit);
 }
 
 
@@ -91,10 +243,12 @@ void execute(Job job) {
 
 	//printf("dequeued job #%i\n", counter++);
     assert(job.func);
+	trace_event(TRACE_JOB_BEGIN);
 	job.func(job.data);
+	trace_event(TRACE_JOB_END);
 	if (job.counter) {
-		int current = --(*job.counter);
-        resume_sleeping_workers();
+		uint current = --(*job.counter);
+		wake_waiting_workers(current);
 		/*if (current > 1000) {
 			printf("Unsigned overflow!! %u\n", current);
 			abort();
@@ -104,13 +258,36 @@ void execute(Job job) {
 	//printf("Running job on %i, cpu %i\n", get_worker_id(), GetCurrentProcessorNumber());
 }
 
+void run_job(uint worker, Job job) {
+	FiberStack stack = current_stack[worker];
+	if (job.stack <= stack) {
+		execute(job);
+		return;
+	}
+
+	//This fiber is returned to the pool, when it is handed out again it continues the worker loop
+	pending_jobs[worker] = job;
+	Fiber* fiber = alloc_fiber(job.stack);
+	dealloc_fiber(get_current_fiber(), stack);
+	switch_to_fiber(fiber, job.stack);
+}
+
+bool take_pending_job(uint worker, Job* job) {
+	if (!pending_jobs[worker].func) return false;
+
+	*job = pending_jobs[worker];
+	pending_jobs[worker] = {};
+	return true;
+}
+
 bool pop_job(uint worker, Job* job) {
 	assert(get_worker_id() == worker);
 
-	if (private_queue[worker].dequeue(job)) return true; //todo what priority level should this be
+	WorkerQueues& queues = *worker_queues[worker];
+	if (queues.private_queue.dequeue(job)) return true; //todo what priority level should this be
 
 	for (uint priority = 0; priority < PRIORITY_COUNT; priority++) {
-		if (queues[worker][priority].pop(job)) return true;
+		if (queues.queues[priority].pop(job)) return true;
 	}
 
 	return false;
@@ -118,28 +295,78 @@ bool pop_job(uint worker, Job* job) {
 
 bool steal_job(uint worker, Job* job) {
 	for (uint priority = 0; priority < PRIORITY_COUNT; priority++) {
-		if (queues[worker][priority].steal(job)) return true;
+		if (worker_queues[worker]->queues[priority].steal(job)) {
+			trace_event(TRACE_JOB_STEAL, nullptr, worker);
+			return true;
+		}
 	}
 
 	return false;
 }
 
-void run_fiber(void* fiber) {
+bool has_pending_work(uint worker) {
+	if (!worker_queues[worker]->private_queue.empty()) return true;
+
+	uint workers_len = workers.length;
+	for (uint i = 0; i < workers_len; i++) {
+		for (uint priority = 0; priority < PRIORITY_COUNT; priority++) {
+			if (!worker_queues[i]->queues[priority].empty()) return true;
+		}
+	}
+
+	for (ParkedFiber& parked : wait_lists[worker]) {
+		if (parked.counter->load() <= parked.value) return true;
+	}
+
+	return false;
+}
+
+void park_worker(uint worker) {
+	WorkerParking& parking = ::parking[worker];
+	u64 bit = 1ull << worker;
+
+	parking.state.store(WORKER_PARKED);
+	sleeping_mask.fetch_or(bit);
+
+	//Pairs with publish_jobs, either this worker sees the new work or the waker sees its bit.
+	//Without it the queue loads below could be ordered before the bit is visible and both sides miss each other.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	//Work may have been published before the waker could see our bit, check once more
+	if (workers_exit || has_pending_work(worker)) {
+		if (sleeping_mask.fetch_and(~bit) & bit) {
+			parking.state.store(WORKER_RUNNING);
+			return;
+		}
+		//a waker already claimed us, the signal is on its way
+	}
+
+	trace_event(TRACE_WORKER_SLEEP);
+	wait_on_state(parking);
+	trace_event(TRACE_WORKER_WAKE);
+}
+
+void run_fiber(void*) {
 	uint worker = get_worker_id();
 	WaitList& wait_list = wait_lists[worker];
 	Fiber* worker_fiber = get_current_fiber();
 
 	uint workers_len = workers.length;
-    uint sleep_cycles = 10;
+	uint spin_cycles = 0;
     
     uint steal_from = 0;
 
 	while (!workers_exit) {
 		Job job = {};
 
-		if (pop_job(worker, &job)) { //pop doesn't work reliably!
-            //printf("Executing job on %i\n", worker);
+		if (take_pending_job(worker, &job)) {
 			execute(job);
+			spin_cycles = 0;
+		}
+		else if (pop_job(worker, &job)) { //pop doesn't work reliably!
+            //printf("Executing job on %i\n", worker);
+			run_job(worker, job);
+			spin_cycles = 0;
 		}
 		else {
 			bool resumed = false;
@@ -147,11 +374,13 @@ void run_fiber(void* fiber) {
 			for (uint i = 0; i < wait_list.length; i++) {
 				uint counter = wait_list[i].counter->load(std::memory_order_relaxed);
 				if (counter <= wait_list[i].value) {
-					Fiber* fiber = wait_list[i].fiber;
+					ParkedFiber parked = wait_list[i];
 					wait_list.data[i] = wait_list.data[--wait_list.length];
+					update_wait_threshold(worker);
 					resumed = true;
-					dealloc_fiber(worker_fiber);
-					switch_to_fiber(fiber);
+					spin_cycles = 0;
+					dealloc_fiber(worker_fiber, current_stack[worker]);
+					switch_to_fiber(parked.fiber, parked.stack);
 					break;
 				}
 			}
@@ -164,18 +393,15 @@ void run_fiber(void* fiber) {
 				}
 
                 if (job.func) {
-                    execute(job);
+                    run_job(worker, job);
+                    spin_cycles = 0;
+                }
+                else if (spin_cycles++ < WORKER_SPIN_COUNT) {
+                    TASK_YIELD();
                 }
                 else {
-                    //if (sleep_cycles++ < 10) {
-                    //    thread_sleep(1);
-                    //} else {
-                        std::unique_lock lock{work_mutex};
-                        sleeping_workers = true;
-                        work.wait(lock);
-                        
-                        sleep_cycles = 0;
-                    //}
+                    park_worker(worker);
+                    spin_cycles = 0;
                 }
 			}
 		}
@@ -188,28 +414,40 @@ void wait_for_counter(atomic_counter* counter, uint value) {
 	
 	uint worker_id = get_worker_id();
 	WaitList& wait_list = wait_lists[worker_id];
-	FiberPool& fiber_pool = fiber_pools[worker_id];
 	Fiber* fiber = get_current_fiber(); //corrupts the stack??
+	FiberStack stack = current_stack[worker_id];
     
     //assert(worker_id == 0);
 
 	//todo what memory order should this be
 	Fiber* yield_to = nullptr;
+	FiberStack yield_stack = FIBER_STACK_SMALL;
 
 	for (uint i = 0; i < wait_list.length; i++) {
 		if (wait_list[i].counter->load(std::memory_order_relaxed) <= wait_list[i].value) {
 			yield_to = wait_list[i].fiber;
-			wait_list[i] = { fiber, counter, value };
+			yield_stack = wait_list[i].stack;
+			wait_list[i] = { fiber, counter, value, stack };
 			break;
 		}
 	}
 		
 	if (!yield_to) {
-		yield_to = fiber_pool.pop();
-		wait_list.append({fiber, counter, value});
+		//Hand the next job straight to a fiber with the stack it needs, a small fiber would
+		//only pop it and switch once more for the usual medium or large job
+		Job job;
+		if (pop_job(worker_id, &job)) {
+			pending_jobs[worker_id] = job;
+			yield_stack = job.stack;
+		}
+
+		yield_to = alloc_fiber(yield_stack);
+		wait_list.append({fiber, counter, value, stack});
 	}
 
-	switch_to_fiber(yield_to);
+	update_wait_threshold(worker_id);
+
+	switch_to_fiber(yield_to, yield_stack);
 }
 
 WaitCondition::WaitCondition() {
@@ -231,11 +469,52 @@ void wait_for_counter_on_thread(atomic_counter* counter, uint value) {
 }
 
 
+//PLACEMENT
+WorkerPlacement worker_placement;
+uint worker_cpus[MAX_THREADS];
+uint worker_cpu_count;
+uint fibers_per_worker;
+uint workers_starting; //set before any worker is spawned, workers.length is still growing while they start
+std::atomic<uint> workers_ready;
+
+//Pins the calling thread and allocates its queues and fiber stacks, which are then local to its NUMA node
+void init_worker(uint worker) {
+	if (worker_placement != WORKER_PLACEMENT_NONE && worker_cpu_count > 0) {
+		pin_thread_to_cpu(worker_cpus[worker % worker_cpu_count]);
+	}
+
+	if (worker != 0) {
+		char name[sizeof("NE Worker ") + 10]; //any uint fits, set_thread_name truncates to what the os allows
+		snprintf(name, sizeof(name), "NE Worker %u", worker);
+		set_thread_name(name);
+	}
+
+	worker_queues[worker] = new WorkerQueues();
+	wait_lists[worker].allocator = &default_allocator;
+	for (uint stack = 0; stack < FIBER_STACK_COUNT; stack++) {
+		fiber_pools[worker][stack].allocator = &default_allocator;
+	}
+
+	//Workers start out on their thread's own stack
+	current_stack[worker] = FIBER_STACK_LARGE;
+	grow_fiber_pool(worker, FIBER_STACK_SMALL, fibers_per_worker);
+	grow_fiber_pool(worker, FIBER_STACK_MEDIUM, fibers_per_worker);
+
+	workers_ready++;
+}
+
+void wait_for_workers_ready() {
+	while (workers_ready.load() < workers_starting) std::this_thread::yield();
+}
+
 void run_worker(uint worker) {
 	//printf("Starting worker %i\n", worker);
 
 	convert_thread_to_fiber();
     ::worker = { worker + 1 };
+
+	init_worker(worker);
+	wait_for_workers_ready(); //other queues may not exist yet
 	run_fiber(nullptr);
 }
 
@@ -246,25 +525,23 @@ void init_main_thread() {
     worker = { 1 };
 }
 
-void make_job_system(uint num_fibers, uint num_workers) {
+void make_job_system(uint num_fibers, uint num_workers, WorkerPlacement placement) {
 	assert(num_workers <= MAX_THREADS);
-	assert(num_fibers <= MAX_FIBERS);
 	assert(num_workers <= hardware_thread_count());
 
 	const uint main_thread = 0;
 
+	worker_placement = placement;
+	worker_cpu_count = placement != WORKER_PLACEMENT_NONE ? get_worker_cpus(placement, worker_cpus, MAX_THREADS) : 0;
+	fibers_per_worker = num_fibers;
+	workers_starting = num_workers;
+	workers_ready = 0;
+
+	make_trace_buffers(num_workers);
 	
 	for (uint worker = 0; worker < num_workers; worker++) {
-		for (uint i = 0; i < num_fibers; i++) {
-			fiber_pools[worker].append(make_fiber(kb(128), run_fiber));
-		}
-
         if (worker == main_thread) workers.append(std::thread());
-		else {
-			//std::thread thread(run_worker, worker);
-			//SetThreadAffinityMask(thread.native_handle(), (1 << worker));
-			workers.append(std::thread(run_worker, worker));
-		}
+		else workers.append(std::thread(run_worker, worker));
 	}
 
 	for (uint worker = 1; worker < num_workers; worker++) {
@@ -272,40 +549,52 @@ void make_job_system(uint num_fibers, uint num_workers) {
 	}
 
 	worker = { main_thread + 1 };
+	init_worker(main_thread);
+	wait_for_workers_ready();
+
     fls_context = make_FLS(nullptr);
+
+	if (getenv("NE_TRACE_FILE")) begin_tracing();
 }
 
 void destroy_job_system() {
+	if (const char* trace_file = getenv("NE_TRACE_FILE")) export_chrome_trace(trace_file);
+
     free_FLS(fls_context);
 
 	workers_exit = true;
+	wake_all_workers();
 
 	workers.clear();
+	destroy_trace_buffers();
 }
 
 void schedule_jobs_on(slice<uint> workers, slice<JobDesc> jobs, atomic_counter* counter) {
 	if (counter) *counter += jobs.length;
+	trace_event(TRACE_JOB_ENQUEUE, nullptr, jobs.length);
 
 	//assert(workers.length == jobs.length);
 
 	for (uint i = 0; i < jobs.length; i++) {
-		while (!private_queue[workers[i]].enqueue({
+		while (!worker_queues[workers[i]]->private_queue.enqueue({
 			jobs[i].func,
 			jobs[i].data,
-			counter
+			counter,
+			jobs[i].stack
         })) {
             thread_sleep(0);
         }
+
+		publish_jobs();
+		unpark_worker(workers[i]);
 	}
-    
-    resume_sleeping_workers();
 }
 
 void add_jobs(Priority priority, slice<JobDesc> jobs, atomic_counter* counter) {
 	if (counter) *counter += jobs.length;
+	trace_event(TRACE_JOB_ENQUEUE, nullptr, jobs.length);
 
 	uint worker = get_worker_id();
-	Fiber* fiber = get_current_fiber();
     
 	for (JobDesc& desc : jobs) { 
 		//Could we enqueue multiple jobs at a time?
@@ -314,14 +603,17 @@ void add_jobs(Priority priority, slice<JobDesc> jobs, atomic_counter* counter) {
 		
 		//printf("enqueued job #%i\n", counter++);
 
-		assert(queues[worker][priority].push({
+		bool pushed = worker_queues[worker]->queues[priority].push({
 			desc.func,
 			desc.data,
-			counter
-		}));
+			counter,
+			desc.stack
+		});
+		assert(pushed);
 	}
     
-    resume_sleeping_workers();
+	publish_jobs();
+    wake_workers(min(jobs.length, count_bits(sleeping_mask.load())));
 }
 
 void wait_for_jobs(Priority priority, slice<JobDesc> jobs) {
@@ -338,6 +630,69 @@ void wait_for_jobs(Priority priority, slice<JobDesc> jobs) {
 
 
 
+//PARALLEL FOR
+
+struct ParallelForJob {
+	ParallelForFunc func;
+	void* data;
+	Priority priority;
+	uint begin;
+	uint end;
+	uint grain;
+};
+
+//Halving a 32 bit range can happen at most 32 times
+constexpr uint MAX_PARALLEL_FOR_SPLITS = 32;
+
+bool has_local_jobs(uint worker) {
+	for (uint priority = 0; priority < PRIORITY_COUNT; priority++) {
+		if (!worker_queues[worker]->queues[priority].empty()) return true;
+	}
+	return false;
+}
+
+void parallel_for_job(ParallelForJob& job) {
+	ParallelForJob splits[MAX_PARALLEL_FOR_SPLITS];
+	uint split_count = 0;
+	atomic_counter counter = {};
+
+	uint begin = job.begin;
+	uint end = job.end;
+
+	while (end - begin > job.grain) {
+		//The previous half is still sitting in our queue, nobody is hungry for more work
+		if (split_count > 0 && has_local_jobs(get_worker_id())) {
+			job.func(job.data, begin, begin + job.grain);
+			begin += job.grain;
+			continue;
+		}
+
+		uint mid = begin + (end - begin) / 2;
+
+		assert(split_count < MAX_PARALLEL_FOR_SPLITS);
+		ParallelForJob& split = splits[split_count++];
+		split = job;
+		split.begin = mid;
+		split.end = end;
+
+		JobDesc desc(parallel_for_job, &split);
+		add_jobs(job.priority, desc, &counter);
+		end = mid;
+	}
+
+	if (begin < end) job.func(job.data, begin, end);
+	if (split_count > 0) wait_for_counter(&counter, 0);
+}
+
+void parallel_for(Priority priority, uint begin, uint end, uint grain, ParallelForFunc func, void* data) {
+	if (begin >= end) return;
+	if (grain == 0) grain = 1;
+
+	ParallelForJob job = { func, data, priority, begin, end, grain };
+	parallel_for_job(job);
+}
+
+
 //CONTEXT
 
 #include "core/context.h"
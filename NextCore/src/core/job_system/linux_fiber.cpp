@@ -1,32 +1,63 @@
-#ifdef NE_PLATFORM_MACOSX
+#if defined(NE_PLATFORM_MACOSX) || defined(NE_PLATFORM_LINUX)
 #include "core/job_system/fiber.h"
 #include <stdlib.h>
+#include <stdio.h>
 
+#ifndef _XOPEN_SOURCE
 #define _XOPEN_SOURCE
+#endif
 #include <ucontext.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "core/memory/allocator.h"
 
-struct Fiber;
+//Stacks are mapped separately with a PROT_NONE guard page below them, so an overflow faults
+//instead of running into the neighbouring stack. Pages are only committed once touched.
+struct Fiber {
+	ucontext_t context;
+	char* mapping;
+	u64 mapping_size;
+};
+
 static thread_local Fiber* currently_executing_fiber = nullptr;
 
+static u64 page_size() {
+	static u64 size = sysconf(_SC_PAGESIZE);
+	return size;
+}
+
 Fiber* make_fiber(u64 stack_size, void(*func)(void*)) {
 	/* Create a context */
-    
-    u64 size = sizeof(ucontext_t);
-    u64 stack_offset = aligned_incr(&size, stack_size, 64);
-
-	char* memory = (char*)malloc(size);
-    
-    ucontext_t* ctx = (ucontext_t*)memory;
+	u64 guard_size = page_size();
+	stack_size = align_offset(stack_size, guard_size);
+
+	u64 mapping_size = guard_size + stack_size;
+	char* mapping = (char*)mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+	if (mapping == MAP_FAILED) {
+		fprintf(stderr, "Could not map fiber stack of %llu bytes\n", (unsigned long long)stack_size);
+		abort();
+	}
+
+	//Running without the guard would turn a stack overflow into silent corruption of the neighbouring mapping
+	if (mprotect(mapping, guard_size, PROT_NONE) != 0) {
+		perror("Could not protect fiber stack guard page");
+		abort();
+	}
+
+	Fiber* fiber = (Fiber*)malloc(sizeof(Fiber));
+	fiber->mapping = mapping;
+	fiber->mapping_size = mapping_size;
+
+    ucontext_t* ctx = &fiber->context;
     
 	getcontext(ctx);
-    ctx->uc_stack.ss_sp = memory + stack_offset;
+    ctx->uc_stack.ss_sp = mapping + guard_size;
 	ctx->uc_stack.ss_size = stack_size;
 	ctx->uc_link = 0;
 	makecontext(ctx, (void(*)())func, 0);
 
-	return (Fiber*)ctx;
+	return fiber;
 }
 
 Fiber* get_current_fiber() {
@@ -34,8 +65,10 @@ Fiber* get_current_fiber() {
 }
 
 Fiber* convert_thread_to_fiber() {
-	currently_executing_fiber = (Fiber*)malloc(sizeof(ucontext_t) * 5);
-	getcontext((ucontext_t*)currently_executing_fiber);
+	currently_executing_fiber = (Fiber*)malloc(sizeof(Fiber));
+	currently_executing_fiber->mapping = nullptr;
+	currently_executing_fiber->mapping_size = 0;
+	getcontext(&currently_executing_fiber->context);
 
 	return currently_executing_fiber;
 }
@@ -53,8 +86,7 @@ void switch_to_fiber(Fiber* fiber) {
 }
 
 void free_fiber(Fiber* fiber) {
-	ucontext_t* ctx = (ucontext_t*)fiber;
-    printf("Freeing fiber!!!\n");
+	if (fiber->mapping) munmap(fiber->mapping, fiber->mapping_size);
     free(fiber);
 }
 
@@ -0,0 +1,108 @@
+#include "stdafx.h"
+#include "core/job_system/task_graph.h"
+#include "core/container/tvector.h"
+
+task_handle add_task(TaskGraph& graph, JobDesc desc, slice<task_handle> depends_on) {
+	task_handle handle = graph.nodes.length;
+
+	TaskNode node = {};
+	node.func = desc.func;
+	node.data = desc.data;
+	node.stack = desc.stack;
+	node.graph = &graph;
+	node.predecessor_offset = graph.predecessors.length;
+	node.predecessor_count = depends_on.length;
+
+	for (task_handle predecessor : depends_on) {
+		assert(predecessor < handle);
+		graph.predecessors.append(predecessor);
+	}
+
+	graph.nodes.append(node);
+	return handle;
+}
+
+void run_task(TaskNode& node);
+
+void enqueue_task(TaskGraph& graph, TaskNode& node) {
+	JobDesc desc(run_task, &node, node.stack);
+	add_jobs(graph.priority, desc, &graph.counter);
+}
+
+void run_task(TaskNode& node) {
+	TaskGraph& graph = *node.graph;
+	node.func(node.data);
+
+	//The successor is added to the counter before this task is retired, so it never reaches 0 early
+	for (uint i = 0; i < node.successor_count; i++) {
+		task_handle successor = graph.successors[node.successor_offset + i];
+		if (--graph.pending[successor] == 0) enqueue_task(graph, graph.nodes[successor]);
+	}
+}
+
+void schedule_task_graph(TaskGraph& graph, Priority priority) {
+	assert(graph.counter.load() == 0);
+
+	uint node_count = graph.nodes.length;
+	graph.priority = priority;
+	if (graph.pending_capacity < node_count) {
+		delete[] graph.pending;
+		graph.pending = new atomic_counter[node_count];
+		graph.pending_capacity = node_count;
+	}
+
+	graph.successors.clear();
+	graph.successors.resize(graph.predecessors.length);
+
+	//Invert the predecessor lists into one successor array, counting sort by predecessor
+	for (TaskNode& node : graph.nodes) {
+		node.graph = &graph;
+		node.successor_count = 0;
+	}
+
+	for (task_handle predecessor : graph.predecessors) {
+		graph.nodes[predecessor].successor_count++;
+	}
+
+	uint offset = 0;
+	for (TaskNode& node : graph.nodes) {
+		node.successor_offset = offset;
+		offset += node.successor_count;
+		node.successor_count = 0;
+	}
+
+	for (task_handle handle = 0; handle < node_count; handle++) {
+		TaskNode& node = graph.nodes[handle];
+		graph.pending[handle] = node.predecessor_count;
+
+		for (uint i = 0; i < node.predecessor_count; i++) {
+			TaskNode& predecessor = graph.nodes[graph.predecessors[node.predecessor_offset + i]];
+			graph.successors[predecessor.successor_offset + predecessor.successor_count++] = handle;
+		}
+	}
+
+	//Every pending count has to be set before the first root can run
+	tvector<JobDesc> roots;
+	for (TaskNode& node : graph.nodes) {
+		if (node.predecessor_count == 0) roots.append(JobDesc(run_task, &node, node.stack));
+	}
+
+	add_jobs(priority, roots, &graph.counter);
+}
+
+void wait_for_task_graph(TaskGraph& graph) {
+	wait_for_counter(&graph.counter, 0);
+}
+
+void run_task_graph(TaskGraph& graph, Priority priority) {
+	schedule_task_graph(graph, priority);
+	wait_for_task_graph(graph);
+}
+
+void clear_task_graph(TaskGraph& graph) {
+	assert(graph.counter.load() == 0);
+
+	graph.nodes.clear();
+	graph.predecessors.clear();
+	graph.successors.clear();
+}
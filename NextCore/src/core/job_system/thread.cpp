@@ -0,0 +1,178 @@
+#include "stdafx.h"
+#include "core/job_system/thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef NE_PLATFORM_LINUX
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#include <string.h>
+#elif defined(NE_PLATFORM_MACOSX)
+#include <pthread.h>
+#endif
+
+#ifdef NE_PLATFORM_LINUX
+
+static bool read_first_uint(const char* path, uint* value) {
+	FILE* file = fopen(path, "r");
+	if (!file) return false;
+
+	bool found = fscanf(file, "%u", value) == 1;
+	fclose(file);
+	return found;
+}
+
+//The first cpu listed as a sibling stands in for the whole physical core
+static bool is_first_smt_sibling(uint cpu) {
+	char path[128];
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/thread_siblings_list", cpu);
+
+	uint first = cpu;
+	if (!read_first_uint(path, &first)) return true;
+	return first == cpu;
+}
+
+uint get_cpu_numa_node(uint cpu) {
+	char path[128];
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u", cpu);
+
+	DIR* dir = opendir(path);
+	if (!dir) return 0;
+
+	uint node = 0;
+	while (dirent* entry = readdir(dir)) {
+		if (strncmp(entry->d_name, "node", 4) == 0 && sscanf(entry->d_name + 4, "%u", &node) == 1) break;
+	}
+
+	closedir(dir);
+	return node;
+}
+
+uint get_worker_cpus(WorkerPlacement placement, uint* cpus, uint max_cpus) {
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return 0;
+
+	uint count = 0;
+	for (uint cpu = 0; cpu < CPU_SETSIZE && count < max_cpus; cpu++) {
+		if (!CPU_ISSET(cpu, &allowed)) continue;
+		if (placement == WORKER_PLACEMENT_PHYSICAL_CORES && !is_first_smt_sibling(cpu)) continue;
+
+		cpus[count++] = cpu;
+	}
+
+	//Neighbouring workers steal from each other first, keep them on the same node
+	uint nodes[MAX_THREADS];
+	for (uint i = 0; i < count; i++) nodes[i] = get_cpu_numa_node(cpus[i]);
+
+	for (uint i = 1; i < count; i++) {
+		uint cpu = cpus[i];
+		uint node = nodes[i];
+
+		uint j = i;
+		for (; j > 0 && nodes[j - 1] > node; j--) {
+			cpus[j] = cpus[j - 1];
+			nodes[j] = nodes[j - 1];
+		}
+
+		cpus[j] = cpu;
+		nodes[j] = node;
+	}
+
+	return count;
+}
+
+bool pin_thread_to_cpu(uint cpu) {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+void set_thread_name(const char* name) {
+	char truncated[16]; //linux limits names to 15 characters
+	snprintf(truncated, sizeof(truncated), "%s", name);
+	pthread_setname_np(pthread_self(), truncated);
+}
+
+#elif defined(NE_PLATFORM_WINDOWS)
+
+uint get_cpu_numa_node(uint cpu) {
+	PROCESSOR_NUMBER processor = {};
+	processor.Number = (BYTE)cpu;
+
+	USHORT node = 0;
+	if (!GetNumaProcessorNodeEx(&processor, &node)) return 0;
+	return node;
+}
+
+uint get_worker_cpus(WorkerPlacement placement, uint* cpus, uint max_cpus) {
+	uint count = 0;
+
+	if (placement == WORKER_PLACEMENT_PHYSICAL_CORES) {
+		DWORD length = 0;
+		GetLogicalProcessorInformation(nullptr, &length);
+
+		auto* info = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION*)malloc(length);
+		if (GetLogicalProcessorInformation(info, &length)) {
+			uint entries = length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);
+
+			for (uint i = 0; i < entries && count < max_cpus; i++) {
+				if (info[i].Relationship != RelationProcessorCore) continue;
+
+				unsigned long first_sibling;
+				_BitScanForward64(&first_sibling, info[i].ProcessorMask);
+				cpus[count++] = first_sibling;
+			}
+		}
+
+		free(info);
+		if (count > 0) return count;
+	}
+
+	for (uint cpu = 0; cpu < hardware_thread_count() && cpu < 64 && count < max_cpus; cpu++) {
+		cpus[count++] = cpu;
+	}
+
+	return count;
+}
+
+bool pin_thread_to_cpu(uint cpu) {
+	return SetThreadAffinityMask(GetCurrentThread(), 1ull << cpu) != 0;
+}
+
+void set_thread_name(const char* name) {
+	wchar_t wide[64];
+	mbstowcs(wide, name, 63);
+	wide[63] = 0;
+
+	SetThreadDescription(GetCurrentThread(), wide);
+}
+
+#else
+
+uint get_cpu_numa_node(uint cpu) {
+	return 0;
+}
+
+uint get_worker_cpus(WorkerPlacement placement, uint* cpus, uint max_cpus) {
+	uint count = 0;
+	for (uint cpu = 0; cpu < hardware_thread_count() && count < max_cpus; cpu++) {
+		cpus[count++] = cpu;
+	}
+
+	return count;
+}
+
+//macOS offers no way of binding a thread to a core
+bool pin_thread_to_cpu(uint cpu) {
+	return false;
+}
+
+void set_thread_name(const char* name) {
+	pthread_setname_np(name);
+}
+
+#endif
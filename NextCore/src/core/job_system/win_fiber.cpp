@@ -7,7 +7,8 @@ struct Fiber;
 
 //FIBER API is closely modelled after the Windows API and translates to direct function calls
 Fiber* make_fiber(u64 stack_size, void(*func)(void*)) {
-	return (Fiber*)CreateFiber(stack_size, func, nullptr);
+	//Only reserve the stack, pages are committed on demand below the guard page windows maintains
+	return (Fiber*)CreateFiberEx(0, stack_size, FIBER_FLAG_FLOAT_SWITCH, func, nullptr);
 }
 
 Fiber* get_current_fiber() {
@@ -0,0 +1,272 @@
+#include "stdafx.h"
+#include "core/math/aabb_batch.h"
+#include "core/simd.h"
+#include <math.h>
+#include <string.h>
+
+#ifdef NE_SIMD_X86
+#include <immintrin.h>
+#endif
+
+//Every path reads a box before writing it, so out can alias local.
+//With shared set, local holds a single box used for every matrix.
+//The SIMD paths return how many boxes they handled, the scalar path does the rest.
+
+//SCALAR
+template<bool shared>
+static void transform_aabbs_scalar(AABBArrays& out, const AABBArrays& local, const glm::mat4* model_m, uint begin, uint end) {
+	for (uint i = begin; i < end; i++) {
+		const glm::mat4& m = model_m[i];
+		uint j = shared ? 0 : i;
+
+		float center[3], extent[3];
+		for (uint k = 0; k < 3; k++) {
+			center[k] = local.center[k][j];
+			extent[k] = local.extent[k][j];
+		}
+
+		for (uint row = 0; row < 3; row++) {
+			out.center[row][i] = m[0][row] * center[0] + m[1][row] * center[1] + m[2][row] * center[2] + m[3][row];
+			out.extent[row][i] = fabsf(m[0][row]) * extent[0] + fabsf(m[1][row]) * extent[1] + fabsf(m[2][row]) * extent[2];
+		}
+	}
+}
+
+//Furthest point of the box along the normal, outside when it's still behind the plane
+static bool aabb_visible_scalar(const glm::vec4 planes[6], const AABBArrays& aabbs, uint i) {
+	for (uint p = 0; p < 6; p++) {
+		const glm::vec4& plane = planes[p];
+		float dist = plane.w;
+		for (uint k = 0; k < 3; k++) dist += plane[k] * aabbs.center[k][i] + fabsf(plane[k]) * aabbs.extent[k][i];
+		if (dist < 0.0f) return false;
+	}
+	return true;
+}
+
+static void frustum_cull_aabbs_scalar(u64* visible, const glm::vec4 planes[6], const AABBArrays& aabbs, uint begin, uint end) {
+	for (uint i = begin; i < end; i++) {
+		if (aabb_visible_scalar(planes, aabbs, i)) visible[i / 64] |= 1ull << (i % 64);
+	}
+}
+
+#ifdef NE_SIMD_X86
+static const float* matrix_column(const glm::mat4* model_m, uint column) {
+	return (const float*)model_m + column * 4;
+}
+
+//SSE4
+//rows[column][row] holds that element of 4 consecutive matrices
+SIMD_TARGET("sse4.1")
+static void load_matrix_rows_sse4(const glm::mat4* model_m, __m128 rows[4][3]) {
+	for (uint column = 0; column < 4; column++) {
+		__m128 a = _mm_loadu_ps(matrix_column(model_m + 0, column));
+		__m128 b = _mm_loadu_ps(matrix_column(model_m + 1, column));
+		__m128 c = _mm_loadu_ps(matrix_column(model_m + 2, column));
+		__m128 d = _mm_loadu_ps(matrix_column(model_m + 3, column));
+		_MM_TRANSPOSE4_PS(a, b, c, d);
+
+		rows[column][0] = a;
+		rows[column][1] = b;
+		rows[column][2] = c;
+	}
+}
+
+template<bool shared>
+SIMD_TARGET("sse4.1")
+static uint transform_aabbs_sse4(AABBArrays& out, const AABBArrays& local, const glm::mat4* model_m, uint count) {
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	uint i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 rows[4][3];
+		load_matrix_rows_sse4(model_m + i, rows);
+
+		__m128 center[3], extent[3];
+		for (uint k = 0; k < 3; k++) {
+			center[k] = shared ? _mm_set1_ps(local.center[k][0]) : _mm_loadu_ps(local.center[k] + i);
+			extent[k] = shared ? _mm_set1_ps(local.extent[k][0]) : _mm_loadu_ps(local.extent[k] + i);
+		}
+
+		for (uint row = 0; row < 3; row++) {
+			__m128 c = rows[3][row];
+			__m128 e = _mm_setzero_ps();
+			for (uint k = 0; k < 3; k++) {
+				c = _mm_add_ps(c, _mm_mul_ps(rows[k][row], center[k]));
+				e = _mm_add_ps(e, _mm_mul_ps(_mm_andnot_ps(sign, rows[k][row]), extent[k]));
+			}
+
+			_mm_storeu_ps(out.center[row] + i, c);
+			_mm_storeu_ps(out.extent[row] + i, e);
+		}
+	}
+
+	return i;
+}
+
+SIMD_TARGET("sse4.1")
+static uint frustum_cull_aabbs_sse4(u64* visible, const glm::vec4 planes[6], const AABBArrays& aabbs, uint count) {
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	uint i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 center[3], extent[3];
+		for (uint k = 0; k < 3; k++) {
+			center[k] = _mm_loadu_ps(aabbs.center[k] + i);
+			extent[k] = _mm_loadu_ps(aabbs.extent[k] + i);
+		}
+
+		__m128 outside = _mm_setzero_ps();
+		for (uint p = 0; p < 6; p++) {
+			__m128 dist = _mm_set1_ps(planes[p].w);
+			for (uint k = 0; k < 3; k++) {
+				__m128 normal = _mm_set1_ps(planes[p][k]);
+				dist = _mm_add_ps(dist, _mm_mul_ps(normal, center[k]));
+				dist = _mm_add_ps(dist, _mm_mul_ps(_mm_andnot_ps(sign, normal), extent[k]));
+			}
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, _mm_setzero_ps()));
+		}
+
+		u64 mask = ~_mm_movemask_ps(outside) & 0xf;
+		visible[i / 64] |= mask << (i % 64);
+	}
+
+	return i;
+}
+
+//AVX2
+//Same as the SSE4 version with matrices 0-3 in the low half of each register and 4-7 in the high half
+SIMD_TARGET("avx2,fma")
+static void load_matrix_rows_avx2(const glm::mat4* model_m, __m256 rows[4][3]) {
+	for (uint column = 0; column < 4; column++) {
+		__m256 m[4];
+		for (uint k = 0; k < 4; k++) {
+			__m128 low = _mm_loadu_ps(matrix_column(model_m + k, column));
+			__m128 high = _mm_loadu_ps(matrix_column(model_m + k + 4, column));
+			m[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+		}
+
+		__m256 t0 = _mm256_unpacklo_ps(m[0], m[1]);
+		__m256 t1 = _mm256_unpackhi_ps(m[0], m[1]);
+		__m256 t2 = _mm256_unpacklo_ps(m[2], m[3]);
+		__m256 t3 = _mm256_unpackhi_ps(m[2], m[3]);
+
+		rows[column][0] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+		rows[column][1] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+		rows[column][2] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	}
+}
+
+template<bool shared>
+SIMD_TARGET("avx2,fma")
+static uint transform_aabbs_avx2(AABBArrays& out, const AABBArrays& local, const glm::mat4* model_m, uint count) {
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+	uint i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 rows[4][3];
+		load_matrix_rows_avx2(model_m + i, rows);
+
+		__m256 center[3], extent[3];
+		for (uint k = 0; k < 3; k++) {
+			center[k] = shared ? _mm256_set1_ps(local.center[k][0]) : _mm256_loadu_ps(local.center[k] + i);
+			extent[k] = shared ? _mm256_set1_ps(local.extent[k][0]) : _mm256_loadu_ps(local.extent[k] + i);
+		}
+
+		for (uint row = 0; row < 3; row++) {
+			__m256 c = rows[3][row];
+			__m256 e = _mm256_setzero_ps();
+			for (uint k = 0; k < 3; k++) {
+				c = _mm256_fmadd_ps(rows[k][row], center[k], c);
+				e = _mm256_fmadd_ps(_mm256_andnot_ps(sign, rows[k][row]), extent[k], e);
+			}
+
+			_mm256_storeu_ps(out.center[row] + i, c);
+			_mm256_storeu_ps(out.extent[row] + i, e);
+		}
+	}
+
+	return i;
+}
+
+SIMD_TARGET("avx2,fma")
+static uint frustum_cull_aabbs_avx2(u64* visible, const glm::vec4 planes[6], const AABBArrays& aabbs, uint count) {
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+
+	__m256 normal[6][3], abs_normal[6][3], offset[6];
+	for (uint p = 0; p < 6; p++) {
+		offset[p] = _mm256_set1_ps(planes[p].w);
+		for (uint k = 0; k < 3; k++) {
+			normal[p][k] = _mm256_set1_ps(planes[p][k]);
+			abs_normal[p][k] = _mm256_andnot_ps(sign, normal[p][k]);
+		}
+	}
+
+	uint i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 center[3], extent[3];
+		for (uint k = 0; k < 3; k++) {
+			center[k] = _mm256_loadu_ps(aabbs.center[k] + i);
+			extent[k] = _mm256_loadu_ps(aabbs.extent[k] + i);
+		}
+
+		__m256 outside = _mm256_setzero_ps();
+		for (uint p = 0; p < 6; p++) {
+			__m256 dist = offset[p];
+			for (uint k = 0; k < 3; k++) {
+				dist = _mm256_fmadd_ps(normal[p][k], center[k], dist);
+				dist = _mm256_fmadd_ps(abs_normal[p][k], extent[k], dist);
+			}
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(dist, _mm256_setzero_ps(), _CMP_LT_OQ));
+		}
+
+		u64 mask = ~_mm256_movemask_ps(outside) & 0xff;
+		visible[i / 64] |= mask << (i % 64);
+	}
+
+	return i;
+}
+#endif
+
+//DISPATCH
+template<bool shared>
+static void dispatch_transform_aabbs(AABBArrays& out, const AABBArrays& local, const glm::mat4* model_m, uint count) {
+	uint done = 0;
+
+#ifdef NE_SIMD_X86
+	switch (simd_level()) {
+	case SIMD_AVX2: done = transform_aabbs_avx2<shared>(out, local, model_m, count); break;
+	case SIMD_SSE4: done = transform_aabbs_sse4<shared>(out, local, model_m, count); break;
+	default: break;
+	}
+#endif
+
+	transform_aabbs_scalar<shared>(out, local, model_m, done, count);
+}
+
+void transform_aabbs(AABBArrays& out, const AABBArrays& local, const glm::mat4* model_m, uint count) {
+	dispatch_transform_aabbs<false>(out, local, model_m, count);
+}
+
+void transform_aabbs(AABBArrays& out, const AABB& local, const glm::mat4* model_m, uint count) {
+	float storage[6];
+	AABBArrays box = { { storage, storage + 1, storage + 2 }, { storage + 3, storage + 4, storage + 5 } };
+	set_aabb(box, 0, local);
+
+	dispatch_transform_aabbs<true>(out, box, model_m, count);
+}
+
+void frustum_cull_aabbs(u64* visible, const glm::vec4 planes[6], const AABBArrays& aabbs, uint count) {
+	memset(visible, 0, sizeof(u64) * ((count + 63) / 64));
+	uint done = 0;
+
+#ifdef NE_SIMD_X86
+	switch (simd_level()) {
+	case SIMD_AVX2: done = frustum_cull_aabbs_avx2(visible, planes, aabbs, count); break;
+	case SIMD_SSE4: done = frustum_cull_aabbs_sse4(visible, planes, aabbs, count); break;
+	default: break;
+	}
+#endif
+
+	frustum_cull_aabbs_scalar(visible, planes, aabbs, done, count);
+}
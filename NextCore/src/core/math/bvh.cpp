@@ -0,0 +1,435 @@
+#include "stdafx.h"
+#include "core/math/bvh.h"
+#include "core/job_system/job.h"
+#include <algorithm>
+#include <atomic>
+
+//The tree is first built with nodes in whatever order the jobs allocate them, children are always allocated
+//after their parent. It's then flattened depth-first. Ranges are partitioned in place in indices,
+//so the leaves of the flattened tree reference increasing ranges of it.
+
+struct BVHBuildNode {
+	AABB aabb;
+	uint begin;
+	uint end;
+	uint child[2]; //0 for leaves, the root is never a child
+};
+
+struct BVHBuildRange {
+	uint node;
+	uint begin;
+	uint end;
+	AABB aabb; //of the primitives
+	AABB centroids; //of their centroids
+};
+
+struct BVHBin {
+	AABB aabb;
+	uint count = 0;
+};
+
+struct BVHBuilder {
+	BVHBuildSettings settings;
+	const AABB* bounds;
+	glm::vec3* centroids;
+	uint* indices;
+	BVHBuildNode* nodes;
+	std::atomic<uint> node_count;
+};
+
+//Ranges larger than this are binned and bounded by several jobs, a chunk at a time.
+//Chunks are merged in order, so the result doesn't depend on the number of workers.
+constexpr uint BVH_CHUNK_SIZE = 16384;
+
+static uint chunk_count(uint begin, uint end) {
+	return (end - begin + BVH_CHUNK_SIZE - 1) / BVH_CHUNK_SIZE;
+}
+
+template<typename F>
+static void for_each_chunk(uint begin, uint end, F&& func) {
+	uint chunks = chunk_count(begin, end);
+
+	auto run = [&](uint first, uint last) {
+		for (uint chunk = first; chunk < last; chunk++) {
+			uint chunk_begin = begin + chunk * BVH_CHUNK_SIZE;
+			uint chunk_end = end - chunk_begin > BVH_CHUNK_SIZE ? chunk_begin + BVH_CHUNK_SIZE : end;
+			func(chunk, chunk_begin, chunk_end);
+		}
+	};
+
+	if (chunks > 1) parallel_for(0, chunks, 1, run);
+	else run(0, chunks);
+}
+
+static void chunk_bounds(const BVHBuilder& builder, uint begin, uint end, AABB& aabb, AABB& centroids) {
+	for (uint i = begin; i < end; i++) {
+		uint prim = builder.indices[i];
+		aabb.update_aabb(builder.bounds[prim]);
+		centroids.update(builder.centroids[prim]);
+	}
+}
+
+static void range_bounds(const BVHBuilder& builder, uint begin, uint end, AABB& aabb, AABB& centroids) {
+	aabb = AABB();
+	centroids = AABB();
+
+	//Most ranges are small, bound them without going through the job system or allocating
+	if (chunk_count(begin, end) <= 1) {
+		chunk_bounds(builder, begin, end, aabb, centroids);
+		return;
+	}
+
+	vector<AABB> partial;
+	partial.allocator = &default_allocator;
+	partial.resize(chunk_count(begin, end) * 2);
+
+	for_each_chunk(begin, end, [&](uint chunk, uint chunk_begin, uint chunk_end) {
+		chunk_bounds(builder, chunk_begin, chunk_end, partial[chunk * 2], partial[chunk * 2 + 1]);
+	});
+
+	for (uint i = 0; i < partial.length; i += 2) {
+		aabb.update_aabb(partial[i]);
+		centroids.update_aabb(partial[i + 1]);
+	}
+}
+
+//SPLITTING
+struct BVHBinning {
+	uint bins;
+	float min[3];
+	float scale[3]; //0 when the centroids don't spread along the axis
+
+	uint bin(float centroid, uint axis) const {
+		int bin = (int)((centroid - min[axis]) * scale[axis]);
+		return bin < 0 ? 0 : (bin >= (int)bins ? bins - 1 : bin);
+	}
+};
+
+static void bin_primitives(const BVHBuilder& builder, const BVHBinning& binning, uint begin, uint end, BVHBin* bins) {
+	for (uint i = begin; i < end; i++) {
+		uint prim = builder.indices[i];
+		glm::vec3 centroid = builder.centroids[prim];
+
+		for (uint axis = 0; axis < 3; axis++) {
+			if (binning.scale[axis] == 0.0f) continue;
+
+			BVHBin& bin = bins[axis * BVH_MAX_BINS + binning.bin(centroid[axis], axis)];
+			bin.aabb.update_aabb(builder.bounds[prim]);
+			bin.count++;
+		}
+	}
+}
+
+//Returns the first index of the right side, or 0 when the range should be a leaf
+static uint sah_partition(BVHBuilder& builder, const BVHBuildRange& range) {
+	const BVHBuildSettings& settings = builder.settings;
+	uint count = range.end - range.begin;
+
+	BVHBinning binning;
+	binning.bins = settings.bins < 2 ? 2 : (settings.bins > BVH_MAX_BINS ? BVH_MAX_BINS : settings.bins);
+
+	bool spread = false;
+	for (uint axis = 0; axis < 3; axis++) {
+		float extent = range.centroids.max[axis] - range.centroids.min[axis];
+		binning.min[axis] = range.centroids.min[axis];
+		binning.scale[axis] = extent > 0.0f ? binning.bins / extent : 0.0f;
+		spread |= extent > 0.0f;
+	}
+
+	//Every centroid is in the same place, binning can't separate them
+	if (!spread) {
+		if (count <= settings.max_leaf_size) return 0;
+		return range.begin + count / 2;
+	}
+
+	BVHBin bins[3 * BVH_MAX_BINS];
+
+	if (chunk_count(range.begin, range.end) <= 1) {
+		bin_primitives(builder, binning, range.begin, range.end, bins);
+	}
+	else {
+		vector<BVHBin> partial;
+		partial.allocator = &default_allocator;
+		partial.resize(chunk_count(range.begin, range.end) * 3 * BVH_MAX_BINS);
+
+		for_each_chunk(range.begin, range.end, [&](uint chunk, uint chunk_begin, uint chunk_end) {
+			bin_primitives(builder, binning, chunk_begin, chunk_end, partial.data + chunk * 3 * BVH_MAX_BINS);
+		});
+
+		for (uint i = 0; i < partial.length; i++) {
+			BVHBin& bin = bins[i % (3 * BVH_MAX_BINS)];
+			bin.aabb.update_aabb(partial[i].aabb);
+			bin.count += partial[i].count;
+		}
+	}
+
+	//Sweep from both sides, splitting before bin i puts bins [0, i) on the left
+	float best_cost = FLT_MAX;
+	uint best_axis = 0;
+	uint best_bin = 0;
+
+	for (uint axis = 0; axis < 3; axis++) {
+		if (binning.scale[axis] == 0.0f) continue;
+
+		BVHBin* axis_bins = bins + axis * BVH_MAX_BINS;
+		float left_area[BVH_MAX_BINS];
+		uint left_count[BVH_MAX_BINS];
+
+		AABB left;
+		uint left_total = 0;
+		for (uint i = 0; i < binning.bins - 1; i++) {
+			left.update_aabb(axis_bins[i].aabb);
+			left_total += axis_bins[i].count;
+			left_area[i] = left_total > 0 ? left.surface_area() : 0.0f;
+			left_count[i] = left_total;
+		}
+
+		AABB right;
+		uint right_total = 0;
+		for (uint i = binning.bins - 1; i > 0; i--) {
+			right.update_aabb(axis_bins[i].aabb);
+			right_total += axis_bins[i].count;
+			if (left_count[i - 1] == 0 || right_total == 0) continue;
+
+			float cost = left_area[i - 1] * left_count[i - 1] + right.surface_area() * right_total;
+			if (cost < best_cost) {
+				best_cost = cost;
+				best_axis = axis;
+				best_bin = i;
+			}
+		}
+	}
+
+	float area = range.aabb.surface_area();
+	float split_cost = settings.traversal_cost + (area > 0.0f ? best_cost / area : 0.0f);
+	if (count <= settings.max_leaf_size && count <= split_cost) return 0;
+
+	//Only possible if every centroid fell in one bin through rounding
+	if (best_bin == 0) return range.begin + count / 2;
+
+	uint* mid = std::partition(builder.indices + range.begin, builder.indices + range.end, [&](uint prim) {
+		return binning.bin(builder.centroids[prim][best_axis], best_axis) < best_bin;
+	});
+
+	return (uint)(mid - builder.indices);
+}
+
+static uint median_partition(BVHBuilder& builder, const BVHBuildRange& range) {
+	uint count = range.end - range.begin;
+	if (count <= builder.settings.max_leaf_size) return 0;
+
+	glm::vec3 extent = range.centroids.size();
+	uint axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+	uint* first = builder.indices + range.begin;
+	uint* mid = first + count / 2;
+	std::nth_element(first, mid, builder.indices + range.end, [&](uint a, uint b) {
+		return builder.centroids[a][axis] < builder.centroids[b][axis];
+	});
+
+	return range.begin + count / 2;
+}
+
+//Fills in the node of range, returns false when it's a leaf
+static bool split_range(BVHBuilder& builder, const BVHBuildRange& range, BVHBuildRange children[2]) {
+	BVHBuildNode& node = builder.nodes[range.node];
+	node.aabb = range.aabb;
+	node.begin = range.begin;
+	node.end = range.end;
+	node.child[0] = 0;
+	node.child[1] = 0;
+
+	if (range.end - range.begin <= 1) return false;
+
+	uint mid = builder.settings.split == BVH_SPLIT_SAH ? sah_partition(builder, range) : median_partition(builder, range);
+	if (mid == 0) return false;
+
+	uint child = builder.node_count.fetch_add(2);
+	node.child[0] = child;
+	node.child[1] = child + 1;
+
+	children[0] = { child, range.begin, mid };
+	children[1] = { child + 1, mid, range.end };
+
+	for (uint i = 0; i < 2; i++) {
+		range_bounds(builder, children[i].begin, children[i].end, children[i].aabb, children[i].centroids);
+	}
+
+	return true;
+}
+
+//BUILD JOBS
+struct BVHBuildJob {
+	BVHBuilder* builder;
+	BVHBuildRange range;
+};
+
+//Small ranges are built without any more jobs, depth first with an explicit stack as SAH trees can get deep.
+//Binning a range may still wait on a parallel_for, so the stack can't live in the thread's temporary allocator.
+static void build_serial(BVHBuilder& builder, const BVHBuildRange& root) {
+	vector<BVHBuildRange> stack;
+	stack.allocator = &default_allocator;
+	stack.append(root);
+
+	while (stack.length > 0) {
+		BVHBuildRange range = stack.pop();
+		BVHBuildRange children[2];
+
+		if (split_range(builder, range, children)) {
+			stack.append(children[1]);
+			stack.append(children[0]);
+		}
+	}
+}
+
+static void build_job(BVHBuildJob& job) {
+	BVHBuilder& builder = *job.builder;
+
+	if (job.range.end - job.range.begin < builder.settings.parallel_threshold) {
+		build_serial(builder, job.range);
+		return;
+	}
+
+	BVHBuildRange children[2];
+	if (!split_range(builder, job.range, children)) return;
+
+	BVHBuildJob jobs[2] = { { &builder, children[0] }, { &builder, children[1] } };
+	JobDesc desc[2] = { { build_job, jobs }, { build_job, jobs + 1 } };
+	wait_for_jobs(PRIORITY_HIGH, { desc, 2 });
+}
+
+//Runs after waiting on the build jobs, which may have resumed this fiber on another worker,
+//so scratch memory comes from the default allocator rather than a thread's temporary allocator
+static void flatten(BVH& bvh, const BVHBuildNode* build_nodes, uint count) {
+	//Children come after their parent, so going backwards sizes every subtree before its parent needs it
+	vector<uint> subtree;
+	subtree.allocator = &default_allocator;
+	subtree.resize(count);
+
+	for (uint i = count; i-- > 0;) {
+		const BVHBuildNode& node = build_nodes[i];
+		subtree[i] = node.child[0] ? 1 + subtree[node.child[0]] + subtree[node.child[1]] : 1;
+	}
+
+	bvh.nodes.clear();
+	bvh.nodes.resize(count);
+
+	vector<uint> stack;
+	stack.allocator = &default_allocator;
+	stack.append(0);
+
+	uint index = 0;
+	while (stack.length > 0) {
+		uint build_index = stack.pop();
+		const BVHBuildNode& node = build_nodes[build_index];
+		BVHNode& flat = bvh.nodes[index];
+		flat.aabb = node.aabb;
+
+		if (node.child[0]) {
+			flat.offset = index + subtree[build_index];
+			flat.count = 0;
+			stack.append(node.child[1]);
+			stack.append(node.child[0]);
+		}
+		else {
+			flat.offset = node.begin;
+			flat.count = node.end - node.begin;
+		}
+
+		index++;
+	}
+}
+
+void build_bvh(BVH& bvh, slice<AABB> bounds, const BVHBuildSettings& settings) {
+	uint count = bounds.length;
+
+	bvh.nodes.clear();
+	bvh.indices.clear();
+	if (count == 0) return;
+
+	bvh.indices.resize(count);
+
+	vector<glm::vec3> centroids;
+	vector<BVHBuildNode> build_nodes;
+	centroids.allocator = &default_allocator;
+	build_nodes.allocator = &default_allocator;
+	centroids.resize(count);
+	build_nodes.resize(2 * count - 1); //every leaf holds at least one primitive
+
+	BVHBuilder builder;
+	builder.settings = settings;
+	builder.bounds = bounds.data;
+	builder.centroids = centroids.data;
+	builder.indices = bvh.indices.data;
+	builder.nodes = build_nodes.data;
+	builder.node_count = 1;
+
+	parallel_for(0, count, BVH_CHUNK_SIZE, [&](uint begin, uint end) {
+		for (uint i = begin; i < end; i++) {
+			builder.indices[i] = i;
+			builder.centroids[i] = bounds[i].centroid();
+		}
+	});
+
+	BVHBuildJob root = { &builder, { 0, 0, count } };
+	range_bounds(builder, 0, count, root.range.aabb, root.range.centroids);
+	build_job(root);
+
+	flatten(bvh, build_nodes.data, builder.node_count);
+}
+
+//REFITTING
+//Children are stored after their parent, so walking backwards visits both children before the parent
+void refit_bvh(BVH& bvh) {
+	BVHNode* nodes = bvh.nodes.data;
+
+	for (uint i = bvh.nodes.length; i-- > 0;) {
+		BVHNode& node = nodes[i];
+		if (is_leaf(node)) continue;
+
+		uint left = i + 1;
+		uint right = bvh_skip(nodes[left], left);
+
+		node.aabb = nodes[left].aabb;
+		node.aabb.update_aabb(nodes[right].aabb);
+	}
+}
+
+//STATISTICS
+BVHStats bvh_stats(const BVH& bvh, float traversal_cost) {
+	BVHStats stats;
+	stats.node_count = bvh.nodes.length;
+	if (stats.node_count == 0) return stats;
+
+	//Ends of the inner nodes containing the current node
+	vector<uint> open;
+	open.allocator = &default_allocator;
+
+	float root_area = bvh.nodes[0].aabb.surface_area();
+	float inv_root_area = root_area > 0.0f ? 1.0f / root_area : 0.0f;
+	uint primitives = 0;
+
+	for (uint i = 0; i < bvh.nodes.length; i++) {
+		const BVHNode& node = bvh.nodes[i];
+		while (open.length > 0 && open.last() <= i) open.pop();
+
+		uint depth = open.length;
+		if (depth > stats.max_depth) stats.max_depth = depth;
+
+		float area = node.aabb.surface_area() * inv_root_area;
+		stats.sah_cost += traversal_cost * area;
+
+		if (is_leaf(node)) {
+			stats.leaf_count++;
+			primitives += node.count;
+			if (node.count > stats.max_leaf_size) stats.max_leaf_size = node.count;
+			stats.sah_cost += node.count * area;
+		}
+		else {
+			open.append(node.offset);
+		}
+	}
+
+	stats.average_leaf_size = (float)primitives / stats.leaf_count;
+	return stats;
+}
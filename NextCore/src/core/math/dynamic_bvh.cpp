@@ -0,0 +1,312 @@
+#include "stdafx.h"
+#include "core/math/dynamic_bvh.h"
+
+//Nodes on the free list have this height, so rebalancing can skip them
+constexpr uint FREE_NODE_HEIGHT = DYNAMIC_BVH_NULL;
+
+//How many times the last move a leaf is stretched ahead
+constexpr float DYNAMIC_BVH_DISPLACEMENT_SCALE = 2.0f;
+
+static AABB merge(const AABB& a, const AABB& b) {
+	AABB aabb = a;
+	aabb.update_aabb(b);
+	return aabb;
+}
+
+static uint alloc_node(DynamicBVH& bvh) {
+	uint index = bvh.free_list;
+
+	if (index == DYNAMIC_BVH_NULL) {
+		index = bvh.nodes.length;
+		bvh.nodes.append({});
+	}
+	else {
+		bvh.free_list = bvh.nodes[index].parent;
+	}
+
+	DynamicBVHNode& node = bvh.nodes[index];
+	node.parent = DYNAMIC_BVH_NULL;
+	node.child[0] = DYNAMIC_BVH_NULL;
+	node.child[1] = DYNAMIC_BVH_NULL;
+	node.height = 0;
+	node.user = 0;
+	return index;
+}
+
+static void free_node(DynamicBVH& bvh, uint index) {
+	DynamicBVHNode& node = bvh.nodes[index];
+	node.parent = bvh.free_list;
+	node.height = FREE_NODE_HEIGHT;
+	bvh.free_list = index;
+}
+
+static uint child_height(const DynamicBVHNode* nodes, const DynamicBVHNode& node) {
+	uint a = nodes[node.child[0]].height;
+	uint b = nodes[node.child[1]].height;
+	return 1 + (a > b ? a : b);
+}
+
+//ROTATIONS
+//Swaps child x of a with grandchild y, the child of a's other child z, which is then refit
+static void swap_with_grandchild(DynamicBVHNode* nodes, uint a, uint x, uint z, uint y) {
+	DynamicBVHNode& node_a = nodes[a];
+	DynamicBVHNode& node_z = nodes[z];
+
+	node_a.child[node_a.child[0] == x ? 0 : 1] = y;
+	node_z.child[node_z.child[0] == y ? 0 : 1] = x;
+	nodes[y].parent = a;
+	nodes[x].parent = z;
+
+	node_z.aabb = merge(nodes[node_z.child[0]].aabb, nodes[node_z.child[1]].aabb);
+	node_z.height = child_height(nodes, node_z);
+	node_a.height = child_height(nodes, node_a);
+}
+
+//Only the box of the child that gets a new child changes, a's box still holds the same leaves.
+//Returns true when it rotated.
+static bool rotate(DynamicBVH& bvh, uint a) {
+	DynamicBVHNode* nodes = bvh.nodes.data;
+	const DynamicBVHNode& node = nodes[a];
+	if (node.height < 2) return false;
+
+	uint b = node.child[0];
+	uint c = node.child[1];
+
+	//Change in surface area of the child that would be rebuilt, for each of the 4 swaps
+	float best_cost = 0.0f;
+	uint x = 0, z = 0, y = 0;
+
+	auto consider = [&](uint child, uint other) {
+		const DynamicBVHNode& node_other = nodes[other];
+		if (is_leaf(node_other)) return;
+
+		float area = node_other.aabb.surface_area();
+		for (uint i = 0; i < 2; i++) {
+			uint grandchild = node_other.child[i];
+			uint kept = node_other.child[1 - i];
+			float cost = merge(nodes[child].aabb, nodes[kept].aabb).surface_area() - area;
+
+			if (cost < best_cost) {
+				best_cost = cost;
+				x = child;
+				z = other;
+				y = grandchild;
+			}
+		}
+	};
+
+	consider(b, c);
+	consider(c, b);
+
+	if (best_cost >= 0.0f) return false;
+
+	swap_with_grandchild(nodes, a, x, z, y);
+	return true;
+}
+
+//Recomputes the boxes and heights from index up to the root, rotating every node on the way.
+//Stops at the first node that stays the same, as nothing above it changes either.
+static void refit(DynamicBVH& bvh, uint index) {
+	DynamicBVHNode* nodes = bvh.nodes.data;
+
+	while (index != DYNAMIC_BVH_NULL) {
+		DynamicBVHNode& node = nodes[index];
+
+		AABB aabb = merge(nodes[node.child[0]].aabb, nodes[node.child[1]].aabb);
+		uint height = child_height(nodes, node);
+		if (aabb == node.aabb && height == node.height) return;
+
+		node.aabb = aabb;
+		node.height = height;
+		rotate(bvh, index);
+
+		index = node.parent;
+	}
+}
+
+//Rotating keeps the boxes of the ancestors, but their heights may change
+static void fix_heights(DynamicBVH& bvh, uint index) {
+	DynamicBVHNode* nodes = bvh.nodes.data;
+
+	while (index != DYNAMIC_BVH_NULL) {
+		DynamicBVHNode& node = nodes[index];
+		uint height = child_height(nodes, node);
+		if (height == node.height) return;
+
+		node.height = height;
+		index = node.parent;
+	}
+}
+
+//INSERTION AND REMOVAL
+//Walks down to the node where adding a parent over it and the leaf costs the least surface area.
+//Going into a child costs the area the leaf adds to every node above it, which only grows going down.
+static uint find_sibling(const DynamicBVH& bvh, const AABB& aabb) {
+	const DynamicBVHNode* nodes = bvh.nodes.data;
+	uint index = bvh.root;
+
+	while (!is_leaf(nodes[index])) {
+		const DynamicBVHNode& node = nodes[index];
+
+		float area = node.aabb.surface_area();
+		float combined_area = merge(node.aabb, aabb).surface_area();
+
+		float cost = 2.0f * combined_area;
+		float inheritance = 2.0f * (combined_area - area);
+
+		float child_cost[2];
+		for (uint i = 0; i < 2; i++) {
+			const DynamicBVHNode& child = nodes[node.child[i]];
+			float merged_area = merge(child.aabb, aabb).surface_area();
+			child_cost[i] = inheritance + (is_leaf(child) ? merged_area : merged_area - child.aabb.surface_area());
+		}
+
+		if (cost < child_cost[0] && cost < child_cost[1]) break;
+		index = child_cost[0] < child_cost[1] ? node.child[0] : node.child[1];
+	}
+
+	return index;
+}
+
+static void insert_leaf(DynamicBVH& bvh, uint leaf) {
+	if (bvh.root == DYNAMIC_BVH_NULL) {
+		bvh.root = leaf;
+		bvh.nodes[leaf].parent = DYNAMIC_BVH_NULL;
+		return;
+	}
+
+	uint sibling = find_sibling(bvh, bvh.nodes[leaf].aabb);
+	uint parent = alloc_node(bvh); //may move the nodes
+	DynamicBVHNode* nodes = bvh.nodes.data;
+
+	uint old_parent = nodes[sibling].parent;
+	nodes[parent].parent = old_parent;
+	nodes[parent].child[0] = sibling;
+	nodes[parent].child[1] = leaf;
+	nodes[sibling].parent = parent;
+	nodes[leaf].parent = parent;
+
+	if (old_parent == DYNAMIC_BVH_NULL) {
+		bvh.root = parent;
+	}
+	else {
+		DynamicBVHNode& node = nodes[old_parent];
+		node.child[node.child[0] == sibling ? 0 : 1] = parent;
+	}
+
+	refit(bvh, parent);
+}
+
+static void remove_leaf(DynamicBVH& bvh, uint leaf) {
+	DynamicBVHNode* nodes = bvh.nodes.data;
+
+	if (leaf == bvh.root) {
+		bvh.root = DYNAMIC_BVH_NULL;
+		return;
+	}
+
+	uint parent = nodes[leaf].parent;
+	uint grandparent = nodes[parent].parent;
+	uint sibling = nodes[parent].child[0] == leaf ? nodes[parent].child[1] : nodes[parent].child[0];
+
+	nodes[sibling].parent = grandparent;
+	free_node(bvh, parent);
+
+	if (grandparent == DYNAMIC_BVH_NULL) {
+		bvh.root = sibling;
+		return;
+	}
+
+	DynamicBVHNode& node = nodes[grandparent];
+	node.child[node.child[0] == parent ? 0 : 1] = sibling;
+	refit(bvh, grandparent);
+}
+
+//Also stretched along the displacement, so an object moving at a steady speed stays inside its leaf for a few frames
+static AABB fatten(const AABB& aabb, float margin, glm::vec3 displacement = glm::vec3(0.0f)) {
+	AABB fat;
+	fat.min = aabb.min - glm::vec3(margin);
+	fat.max = aabb.max + glm::vec3(margin);
+
+	for (uint i = 0; i < 3; i++) {
+		float stretch = DYNAMIC_BVH_DISPLACEMENT_SCALE * displacement[i];
+		if (stretch < 0.0f) fat.min[i] += stretch;
+		else fat.max[i] += stretch;
+	}
+
+	return fat;
+}
+
+uint insert_dynamic_bvh(DynamicBVH& bvh, const AABB& aabb, uint user) {
+	uint leaf = alloc_node(bvh);
+	bvh.nodes[leaf].aabb = fatten(aabb, bvh.margin);
+	bvh.nodes[leaf].user = user;
+	bvh.leaf_count++;
+
+	insert_leaf(bvh, leaf);
+	return leaf;
+}
+
+void remove_dynamic_bvh(DynamicBVH& bvh, uint leaf) {
+	remove_leaf(bvh, leaf);
+	free_node(bvh, leaf);
+	bvh.leaf_count--;
+}
+
+//A leaf which still overlaps its old box is refit in place, which only grows and rotates its ancestors.
+//One that jumped further would stretch every ancestor up to the root, so it's reinserted instead.
+bool move_dynamic_bvh(DynamicBVH& bvh, uint leaf, const AABB& aabb) {
+	DynamicBVHNode& node = bvh.nodes[leaf];
+	if (aabb.inside(node.aabb)) return false;
+
+	bool nearby = aabb.intersects(node.aabb);
+	node.aabb = fatten(aabb, bvh.margin, aabb.centroid() - node.aabb.centroid());
+
+	if (nearby) {
+		refit(bvh, node.parent);
+	}
+	else {
+		remove_leaf(bvh, leaf);
+		insert_leaf(bvh, leaf);
+	}
+
+	return true;
+}
+
+void rebalance_dynamic_bvh(DynamicBVH& bvh, uint count) {
+	uint node_count = bvh.nodes.length;
+	if (node_count == 0) return;
+	if (count > node_count) count = node_count;
+
+	for (uint i = 0; i < count; i++) {
+		uint index = bvh.rebalance_cursor++ % node_count;
+		const DynamicBVHNode& node = bvh.nodes[index];
+		if (node.height == FREE_NODE_HEIGHT) continue;
+
+		if (rotate(bvh, index)) fix_heights(bvh, node.parent);
+	}
+
+	bvh.rebalance_cursor %= node_count;
+}
+
+void clear_dynamic_bvh(DynamicBVH& bvh) {
+	bvh.nodes.clear();
+	bvh.root = DYNAMIC_BVH_NULL;
+	bvh.free_list = DYNAMIC_BVH_NULL;
+	bvh.leaf_count = 0;
+	bvh.rebalance_cursor = 0;
+}
+
+float dynamic_bvh_area_ratio(const DynamicBVH& bvh) {
+	if (bvh.root == DYNAMIC_BVH_NULL) return 0.0f;
+
+	float root_area = bvh.nodes[bvh.root].aabb.surface_area();
+	if (root_area <= 0.0f) return 0.0f;
+
+	float area = 0.0f;
+	for (const DynamicBVHNode& node : bvh.nodes) {
+		if (node.height != FREE_NODE_HEIGHT && !is_leaf(node)) area += node.aabb.surface_area();
+	}
+
+	return area / root_area;
+}
@@ -0,0 +1,136 @@
+#include "stdafx.h"
+#include "core/math/model_matrices.h"
+#include "core/simd.h"
+
+#ifdef NE_SIMD_X86
+#include <immintrin.h>
+#endif
+
+//The SIMD paths start at transform i and return where they stopped, the scalar path does the rest.
+
+//SCALAR
+template<uint rows>
+SIMD_FLATTEN
+static void compute_model_matrices_scalar(float* out, const TransformArrays& t, uint begin, uint end) {
+	constexpr uint floats = rows * 4;
+
+	for (uint i = begin; i < end; i++) {
+		f32x1 m[floats];
+		model_matrix_lanes<f32x1, rows>(t, i, m);
+		for (uint j = 0; j < floats; j++) out[i * floats + j] = m[j].v;
+	}
+}
+
+#ifdef NE_SIMD_X86
+//SSE
+struct f32x4 {
+	__m128 v;
+
+	SIMD_TARGET("sse2") static f32x4 load(const float* ptr) { return { _mm_loadu_ps(ptr) }; }
+	SIMD_TARGET("sse2") static f32x4 splat(float value) { return { _mm_set1_ps(value) }; }
+};
+
+SIMD_TARGET("sse2") inline f32x4 operator+(f32x4 a, f32x4 b) { return { _mm_add_ps(a.v, b.v) }; }
+SIMD_TARGET("sse2") inline f32x4 operator-(f32x4 a, f32x4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+SIMD_TARGET("sse2") inline f32x4 operator*(f32x4 a, f32x4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+
+//m holds one float of every matrix per lane, transposing groups of 4 gives 4 consecutive floats of each matrix
+SIMD_TARGET("sse2")
+static void store_matrix_lanes(float* out, uint floats, const f32x4* m) {
+	for (uint i = 0; i < floats; i += 4) {
+		__m128 a = m[i].v, b = m[i + 1].v, c = m[i + 2].v, d = m[i + 3].v;
+		_MM_TRANSPOSE4_PS(a, b, c, d);
+		_mm_storeu_ps(out + i, a);
+		_mm_storeu_ps(out + floats + i, b);
+		_mm_storeu_ps(out + floats * 2 + i, c);
+		_mm_storeu_ps(out + floats * 3 + i, d);
+	}
+}
+
+template<uint rows>
+SIMD_TARGET("sse2") SIMD_FLATTEN
+static uint compute_model_matrices_sse(float* out, const TransformArrays& t, uint i, uint count) {
+	constexpr uint floats = rows * 4;
+
+	for (; i + 4 <= count; i += 4) {
+		f32x4 m[floats];
+		model_matrix_lanes<f32x4, rows>(t, i, m);
+		store_matrix_lanes(out + i * floats, floats, m);
+	}
+
+	return i;
+}
+
+//AVX
+struct f32x8 {
+	__m256 v;
+
+	SIMD_TARGET("avx") static f32x8 load(const float* ptr) { return { _mm256_loadu_ps(ptr) }; }
+	SIMD_TARGET("avx") static f32x8 splat(float value) { return { _mm256_set1_ps(value) }; }
+};
+
+SIMD_TARGET("avx") inline f32x8 operator+(f32x8 a, f32x8 b) { return { _mm256_add_ps(a.v, b.v) }; }
+SIMD_TARGET("avx") inline f32x8 operator-(f32x8 a, f32x8 b) { return { _mm256_sub_ps(a.v, b.v) }; }
+SIMD_TARGET("avx") inline f32x8 operator*(f32x8 a, f32x8 b) { return { _mm256_mul_ps(a.v, b.v) }; }
+
+//Transposes within each 128 bit half, the low half holds matrices 0-3 and the high half 4-7
+SIMD_TARGET("avx")
+static void store_matrix_lanes(float* out, uint floats, const f32x8* m) {
+	for (uint i = 0; i < floats; i += 4) {
+		__m256 t0 = _mm256_unpacklo_ps(m[i].v, m[i + 1].v);
+		__m256 t1 = _mm256_unpackhi_ps(m[i].v, m[i + 1].v);
+		__m256 t2 = _mm256_unpacklo_ps(m[i + 2].v, m[i + 3].v);
+		__m256 t3 = _mm256_unpackhi_ps(m[i + 2].v, m[i + 3].v);
+
+		__m256 r[4] = {
+			_mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)),
+			_mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)),
+			_mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)),
+			_mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)),
+		};
+
+		for (uint j = 0; j < 4; j++) {
+			_mm_storeu_ps(out + floats * j + i, _mm256_castps256_ps128(r[j]));
+			_mm_storeu_ps(out + floats * (j + 4) + i, _mm256_extractf128_ps(r[j], 1));
+		}
+	}
+}
+
+template<uint rows>
+SIMD_TARGET("avx") SIMD_FLATTEN
+static uint compute_model_matrices_avx(float* out, const TransformArrays& t, uint i, uint count) {
+	constexpr uint floats = rows * 4;
+
+	for (; i + 8 <= count; i += 8) {
+		f32x8 m[floats];
+		model_matrix_lanes<f32x8, rows>(t, i, m);
+		store_matrix_lanes(out + i * floats, floats, m);
+	}
+
+	return i;
+}
+#endif
+
+//DISPATCH
+//The AVX kernel runs at the AVX2 level, which implies AVX, and leaves fewer than 8 transforms to the SSE kernel.
+//The SSE kernel only needs SSE2, so it runs at every level from SIMD_SSE2 up.
+template<uint rows>
+static void dispatch_model_matrices(float* out, const TransformArrays& t, uint count) {
+	uint done = 0;
+
+#ifdef NE_SIMD_X86
+	SimdLevel level = simd_level();
+	if (level >= SIMD_AVX2) done = compute_model_matrices_avx<rows>(out, t, 0, count);
+	if (level >= SIMD_SSE2) done = compute_model_matrices_sse<rows>(out, t, done, count);
+#endif
+
+	compute_model_matrices_scalar<rows>(out, t, done, count);
+}
+
+void compute_model_matrices(glm::mat4* out, const TransformArrays& t, uint count) {
+	dispatch_model_matrices<4>((float*)out, t, count);
+}
+
+void compute_model_matrices(glm::mat4x3* out, const TransformArrays& t, uint count) {
+	dispatch_model_matrices<3>((float*)out, t, count);
+}
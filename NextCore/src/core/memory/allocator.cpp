@@ -3,76 +3,273 @@
 #include "core/memory/linear_allocator.h"
 #include "core/io/logger.h"
 #include <stdlib.h>
+#include <atomic>
+#include <mutex>
 
-void* BlockAllocator::allocate(std::size_t size) {
-	auto free_block = this->free_block;
-	while (free_block) {
-		if (free_block->offset + size < block_size) {
-			auto ptr = free_block->data + free_block->offset;
-			free_block->offset += size;
-			free_block->count++;
+#ifdef NE_PLATFORM_WINDOWS
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
 
-			return ptr;
-		}
+//SLAB ALLOCATOR
+//Small allocations are rounded up to one of the size classes and carved out of 64kb spans.
+//Every thread keeps a free list per class and trades blocks with the central pool a batch at a time,
+//so the pool lock is only taken once per batch. The class of every span is kept in a page map,
+//which makes free O(1) without a header on each block. Larger allocations go to malloc behind a small header.
+//Spans are aligned to their size, so a block is aligned to the largest power of two dividing its size.
+//That is at least 16 for every class, larger alignments pick the first class which is a multiple of them.
 
-		free_block = free_block->next;
-	}
+constexpr uint SLAB_SPAN_SHIFT = 16;
+constexpr u64 SLAB_SPAN_SIZE = 1ull << SLAB_SPAN_SHIFT;
+constexpr uint SLAB_MAX_SIZE = kb(8);
+constexpr uint SLAB_CLASS_COUNT = 32; //16 byte steps up to 128, then 4 classes per power of two
+constexpr uint SLAB_LARGE = SLAB_CLASS_COUNT;
+constexpr uint SLAB_LARGE_HEADER = MAX_ALLOCATOR_ALIGNMENT; //holds the pointer returned by malloc
+constexpr uint SLAB_PAGE_MAP_BITS = 16; //two levels of 16 bits cover a 48 bit address space
+
+struct SlabBlock {
+	SlabBlock* next;
+};
+
+struct SlabThreadCache {
+	SlabBlock* free_list[SLAB_CLASS_COUNT];
+	uint count[SLAB_CLASS_COUNT];
+	bool exited;
+
+	~SlabThreadCache();
+};
+
+struct alignas(64) SlabPool {
+	std::mutex mutex;
+	SlabBlock* free_list;
+	char* carve; //remainder of the newest span which has yet to be handed out
+	char* carve_end;
+};
+
+static SlabPool slab_pools[SLAB_CLASS_COUNT];
+static std::atomic<u8*> slab_page_map[1 << SLAB_PAGE_MAP_BITS]; //span -> size class + 1, 0 if it is not a span
+static thread_local SlabThreadCache slab_cache;
+
+static uint floor_log2(u64 value) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return index;
+#else
+	return 63 - __builtin_clzll(value);
+#endif
+}
+
+static uint slab_size_class(u64 size) {
+	if (size <= 128) return size == 0 ? 0 : (uint)(size - 1) / 16;
+
+	uint shift = floor_log2(size - 1) - 2;
+	return 8 + (shift - 5) * 4 + (uint)((size - 1) >> shift) - 4;
+}
+
+static uint slab_block_size(uint size_class) {
+	if (size_class < 8) return (size_class + 1) * 16;
+
+	uint octave = (size_class - 8) / 4;
+	uint step = (size_class - 8) % 4;
+	return (5 + step) << (octave + 5);
+}
 
+//Aim for batches of 16kb, but always move at least a few blocks
+static uint slab_batch_size(uint size_class) {
+	uint count = kb(16) / slab_block_size(size_class);
+	return count < 4 ? 4 : count > 64 ? 64 : count;
+}
+
+static void slab_out_of_memory() {
 	log("Out of memory for default allocator");
 	exit(1);
 }
 
+static uint slab_class_of(void* ptr) {
+	u64 span = (u64)ptr >> SLAB_SPAN_SHIFT;
+	u8* leaf = slab_page_map[span >> SLAB_PAGE_MAP_BITS].load(std::memory_order_acquire);
+	if (!leaf) return SLAB_LARGE;
 
-void BlockAllocator::deallocate(void* ptr) {
-	if (ptr == NULL) return;
+	u8 entry = leaf[span & ((1 << SLAB_PAGE_MAP_BITS) - 1)];
+	return entry == 0 ? SLAB_LARGE : entry - 1;
+}
 
-	for (int i = 0; i < num_blocks; i++) {
-		if (&blocks[i].data <= ptr && ptr < &blocks[i].data + blocks[i].count) {
-			blocks[i].count -= 1;
-			if (blocks[i].count == 0) {
-				blocks[i].offset = 0;
+static void register_slab_span(char* memory, uint size_class) {
+	u64 span = (u64)memory >> SLAB_SPAN_SHIFT;
+	assert((span >> SLAB_PAGE_MAP_BITS) < (1 << SLAB_PAGE_MAP_BITS));
 
-				blocks[i].next = free_block;
-				free_block = &blocks[i];
-			}
+	std::atomic<u8*>& root = slab_page_map[span >> SLAB_PAGE_MAP_BITS];
+	u8* leaf = root.load(std::memory_order_acquire);
+	if (!leaf) {
+		u8* new_leaf = (u8*)calloc(1 << SLAB_PAGE_MAP_BITS, 1);
+		if (!new_leaf) slab_out_of_memory();
 
-			break;
-		}
+		if (root.compare_exchange_strong(leaf, new_leaf, std::memory_order_acq_rel)) leaf = new_leaf;
+		else free(new_leaf);
 	}
+
+	leaf[span & ((1 << SLAB_PAGE_MAP_BITS) - 1)] = size_class + 1;
 }
 
-void BlockAllocator::next_empty_block() {
-	for (int i = 0; i < num_blocks; i++) {
-		if (blocks[i].count == 0) {
-			blocks[i].next = free_block;
-			free_block = &blocks[i];
+//Spans have to be aligned to their size, so every span maps to a single page map entry.
+//They are never given back to the system, freed blocks stay in their size class.
+static char* map_slab_span() {
+#ifdef NE_PLATFORM_WINDOWS
+	//The allocation granularity on windows is 64kb, so spans come out aligned
+	return (char*)VirtualAlloc(nullptr, SLAB_SPAN_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	u64 size = SLAB_SPAN_SIZE * 2;
+	char* mapping = (char*)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+	if (mapping == MAP_FAILED) return nullptr;
+
+	char* span = (char*)align_offset((u64)mapping, SLAB_SPAN_SIZE);
+	char* span_end = span + SLAB_SPAN_SIZE;
+	if (span > mapping) munmap(mapping, span - mapping);
+	munmap(span_end, mapping + size - span_end);
+
+	return span;
+#endif
+}
+
+static SlabBlock* fetch_slab_batch(uint size_class, uint* count) {
+	SlabPool& pool = slab_pools[size_class];
+	uint block_size = slab_block_size(size_class);
+	uint batch = slab_batch_size(size_class);
+
+	std::lock_guard<std::mutex> lock(pool.mutex);
+
+	SlabBlock* head = nullptr;
+	uint fetched = 0;
+
+	for (; fetched < batch && pool.free_list; fetched++) {
+		SlabBlock* block = pool.free_list;
+		pool.free_list = block->next;
+		block->next = head;
+		head = block;
+	}
+
+	//Spans are carved lazily, so pages of a new span are only touched once they are handed out
+	for (; fetched < batch; fetched++) {
+		if ((u64)(pool.carve_end - pool.carve) < block_size) {
+			char* span = map_slab_span();
+			if (!span) slab_out_of_memory();
+
+			register_slab_span(span, size_class);
+			pool.carve = span;
+			pool.carve_end = span + SLAB_SPAN_SIZE;
 		}
+
+		SlabBlock* block = (SlabBlock*)pool.carve;
+		pool.carve += block_size;
+		block->next = head;
+		head = block;
 	}
 
-	log("No empty block left");
+	*count = fetched;
+	return head;
+}
+
+static void return_slab_blocks(uint size_class, SlabBlock* head, SlabBlock* tail) {
+	SlabPool& pool = slab_pools[size_class];
+
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	tail->next = pool.free_list;
+	pool.free_list = head;
 }
 
-BlockAllocator::BlockAllocator() {
-	for (int i = 0; i < num_blocks - 1; i++) {
-		blocks[i].next = &blocks[i + 1];
+//Blocks cached by an exiting thread go back to the pools, frees from later thread_local destructors bypass the cache
+SlabThreadCache::~SlabThreadCache() {
+	for (uint size_class = 0; size_class < SLAB_CLASS_COUNT; size_class++) {
+		SlabBlock* head = free_list[size_class];
+		if (!head) continue;
+
+		SlabBlock* tail = head;
+		while (tail->next) tail = tail->next;
+		return_slab_blocks(size_class, head, tail);
+
+		free_list[size_class] = nullptr;
+		count[size_class] = 0;
 	}
 
-	free_block = &blocks[0];
+	exited = true;
+}
+
+static void* allocate_large(std::size_t size, uint alignment) {
+	char* memory = (char*)malloc(size + SLAB_LARGE_HEADER + alignment - MAX_ALLOCATOR_ALIGNMENT);
+	if (!memory) slab_out_of_memory();
+
+	char* ptr = (char*)align_offset((u64)memory + SLAB_LARGE_HEADER, alignment);
+	((char**)ptr)[-1] = memory;
+	return ptr;
+}
+
+static void* allocate_from_class(uint size_class) {
+	SlabThreadCache& cache = slab_cache;
+
+	SlabBlock* block = cache.free_list[size_class];
+	if (!block) block = fetch_slab_batch(size_class, &cache.count[size_class]);
+
+	cache.free_list[size_class] = block->next;
+	cache.count[size_class]--;
+	return block;
+}
+
+void* SlabAllocator::allocate(std::size_t size) {
+	if (size > SLAB_MAX_SIZE) return allocate_large(size, MAX_ALLOCATOR_ALIGNMENT);
+	return allocate_from_class(slab_size_class(size));
 }
 
-//MALLOC ALLOCATOR WRAPPER
-void* MallocAllocator::allocate(std::size_t size) {
-	return new char[size];
+void* SlabAllocator::allocate(std::size_t size, uint alignment) {
+	assert(alignment && (alignment & (alignment - 1)) == 0);
+	if (alignment <= MAX_ALLOCATOR_ALIGNMENT) return allocate(size);
+
+	if (size <= SLAB_MAX_SIZE) {
+		for (uint size_class = slab_size_class(size); size_class < SLAB_CLASS_COUNT; size_class++) {
+			if (slab_block_size(size_class) % alignment == 0) return allocate_from_class(size_class);
+		}
+	}
+
+	return allocate_large(size, alignment);
 }
 
-void MallocAllocator::deallocate(void* ptr) {
-	delete[] ptr;
+void SlabAllocator::deallocate(void* ptr) {
+	if (ptr == NULL) return;
+
+	uint size_class = slab_class_of(ptr);
+	if (size_class == SLAB_LARGE) {
+		free(((char**)ptr)[-1]);
+		return;
+	}
+
+	SlabBlock* block = (SlabBlock*)ptr;
+	SlabThreadCache& cache = slab_cache;
+
+	if (cache.exited) {
+		return_slab_blocks(size_class, block, block);
+		return;
+	}
+
+	block->next = cache.free_list[size_class];
+	cache.free_list[size_class] = block;
+
+	//Keep up to two batches so alternating allocate and free never touches the pool
+	uint batch = slab_batch_size(size_class);
+	if (++cache.count[size_class] < 2 * batch) return;
+
+	SlabBlock* tail = block;
+	for (uint i = 1; i < batch; i++) tail = tail->next;
+
+	cache.free_list[size_class] = tail->next;
+	cache.count[size_class] -= batch;
+	return_slab_blocks(size_class, block, tail);
 }
 
 //GLOBAL Allocators
 #include "core/context.h"
 
-MallocAllocator default_allocator;
+SlabAllocator default_allocator;
 thread_local LinearAllocator temporary_allocator;
 thread_local LinearAllocator permanent_allocator;
 
@@ -0,0 +1,228 @@
+#include "stdafx.h"
+#include "core/memory/linear_allocator.h"
+
+#ifdef NE_PLATFORM_WINDOWS
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+constexpr u64 LINEAR_COMMIT_SIZE = kb(64); //pages are committed and released in steps of this size
+constexpr u64 LINEAR_FIRST_BLOCK_SIZE = mb(1);
+
+//VIRTUAL MEMORY
+static char* reserve_pages(u64 size) {
+#ifdef NE_PLATFORM_WINDOWS
+	return (char*)VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+	void* memory = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANON | MAP_NORESERVE, -1, 0);
+	return memory == MAP_FAILED ? nullptr : (char*)memory;
+#endif
+}
+
+static bool commit_pages(char* memory, u64 size) {
+#ifdef NE_PLATFORM_WINDOWS
+	return VirtualAlloc(memory, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+	return mprotect(memory, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+static void decommit_pages(char* memory, u64 size) {
+#ifdef NE_PLATFORM_WINDOWS
+	VirtualFree(memory, size, MEM_DECOMMIT);
+#else
+	madvise(memory, size, MADV_DONTNEED);
+	mprotect(memory, size, PROT_NONE);
+#endif
+}
+
+static void release_pages(char* memory, u64 size) {
+#ifdef NE_PLATFORM_WINDOWS
+	VirtualFree(memory, 0, MEM_RELEASE);
+#else
+	munmap(memory, size);
+#endif
+}
+
+LinearAllocator::LinearAllocator(LinearAllocatorMode mode, u64 max_size, Allocator* parent) {
+	this->occupied = 0;
+	this->max_size = max_size;
+	this->memory = nullptr;
+	this->parent = parent;
+	this->mode = mode;
+
+	if (mode == LINEAR_FIXED) {
+		memory = (char*)parent->allocate(max_size);
+		limit = max_size;
+		committed = max_size;
+	}
+	else if (mode == LINEAR_VIRTUAL) {
+		memory = reserve_pages(max_size);
+		if (!memory) this->mode = LINEAR_CHAINED;
+	}
+}
+
+static void free_blocks(Allocator* parent, LinearBlock* block) {
+	while (block) {
+		LinearBlock* next = block->next;
+		parent->deallocate(block);
+		block = next;
+	}
+}
+
+static void release(LinearAllocator& allocator) {
+	switch (allocator.mode) {
+	case LINEAR_FIXED:
+		if (allocator.parent) allocator.parent->deallocate(allocator.memory);
+		break;
+	case LINEAR_VIRTUAL:
+		if (allocator.memory) release_pages(allocator.memory, allocator.max_size);
+		break;
+	case LINEAR_CHAINED:
+		LinearBlock* first = allocator.block;
+		while (first && first->prev) first = first->prev;
+		free_blocks(allocator.parent, first);
+		break;
+	}
+}
+
+LinearAllocator::~LinearAllocator() {
+	release(*this);
+}
+
+void LinearAllocator::operator=(LinearAllocator&& allocator) {
+	release(*this);
+
+	occupied = allocator.occupied;
+	max_size = allocator.max_size;
+	memory = allocator.memory;
+	parent = allocator.parent;
+	mode = allocator.mode;
+	floor = allocator.floor;
+	limit = allocator.limit;
+	committed = allocator.committed;
+	peak = allocator.peak;
+	block = allocator.block;
+
+	allocator.occupied = 0;
+	allocator.max_size = 0;
+	allocator.memory = nullptr;
+	allocator.parent = nullptr;
+	allocator.mode = LINEAR_FIXED;
+	allocator.floor = 0;
+	allocator.limit = 0;
+	allocator.committed = 0;
+	allocator.peak = 0;
+	allocator.block = nullptr;
+}
+
+//CHAINED BLOCKS
+static void use_block(LinearAllocator& allocator, LinearBlock* block) {
+	allocator.block = block;
+	allocator.memory = (char*)(block + 1);
+	allocator.floor = block->base;
+	allocator.limit = block->base + block->size;
+}
+
+//occupied may have been moved back past the current block by a LinearRegion
+static void rewind_block(LinearAllocator& allocator, u64 offset) {
+	LinearBlock* block = allocator.block;
+	if (!block || offset >= block->base) return;
+
+	while (block->prev && offset < block->base) block = block->prev;
+	use_block(allocator, block);
+}
+
+static LinearBlock* push_block(LinearAllocator& allocator, LinearBlock* prev, u64 size) {
+	LinearBlock* block = (LinearBlock*)allocator.parent->allocate(sizeof(LinearBlock) + size);
+	block->prev = prev;
+	block->next = nullptr;
+	block->base = prev ? prev->base + prev->size : 0;
+	block->size = size;
+
+	if (prev) prev->next = block;
+	allocator.committed += size;
+	return block;
+}
+
+//Allocations never straddle two blocks, the rest of a block is skipped when the next one is needed
+static u64 next_block(LinearAllocator& allocator, u64 size) {
+	LinearBlock* block = allocator.block;
+	if (!block) {
+		block = push_block(allocator, nullptr, size > LINEAR_FIRST_BLOCK_SIZE ? size : LINEAR_FIRST_BLOCK_SIZE);
+		use_block(allocator, block);
+		return 0;
+	}
+
+	LinearBlock* next = block->next;
+	if (!next || next->size < size) {
+		for (LinearBlock* unused = next; unused; unused = unused->next) allocator.committed -= unused->size;
+		free_blocks(allocator.parent, next);
+		block->next = nullptr;
+
+		u64 block_size = block->size * 2;
+		next = push_block(allocator, block, size > block_size ? size : block_size);
+	}
+
+	use_block(allocator, next);
+	return next->base;
+}
+
+void* LinearAllocator::allocate_slow(size_t size) {
+	u64 offset = align_offset(occupied, 16);
+	if (offset + size > max_size) {
+		throw "Temporary allocator out of memory";
+	}
+
+	switch (mode) {
+	case LINEAR_FIXED:
+		limit = max_size;
+		break;
+
+	case LINEAR_VIRTUAL: {
+		u64 commit_to = align_offset(offset + size, LINEAR_COMMIT_SIZE);
+		if (commit_to > max_size) commit_to = max_size;
+
+		if (!commit_pages(memory + committed, commit_to - committed)) {
+			throw "Temporary allocator could not commit memory";
+		}
+
+		committed = commit_to;
+		limit = commit_to;
+		break;
+	}
+
+	case LINEAR_CHAINED:
+		rewind_block(*this, offset);
+		if (!block || offset + size > limit) offset = next_block(*this, size);
+		break;
+	}
+
+	occupied = offset + size;
+	if (occupied > peak) peak = occupied;
+	return memory + (offset - floor);
+}
+
+void LinearAllocator::trim(u64 high_water) {
+	u64 keep = occupied > high_water ? occupied : high_water;
+
+	if (mode == LINEAR_VIRTUAL) {
+		keep = align_offset(keep, LINEAR_COMMIT_SIZE);
+		if (keep >= committed) return;
+
+		decommit_pages(memory + keep, committed - keep);
+		committed = keep;
+		limit = keep;
+	}
+	else if (mode == LINEAR_CHAINED && block) {
+		rewind_block(*this, occupied);
+
+		LinearBlock* last = block;
+		while (last->next && last->next->base < keep) last = last->next;
+
+		for (LinearBlock* unused = last->next; unused; unused = unused->next) committed -= unused->size;
+		free_blocks(parent, last->next);
+		last->next = nullptr;
+	}
+}
@@ -0,0 +1,126 @@
+#include "stdafx.h"
+#include "core/memory/memory_tracking.h"
+#include <atomic>
+#include <stdio.h>
+
+constexpr uint TAGGED_HEADER_SIZE = 16; //keeps allocations 16 byte aligned
+
+struct alignas(64) TagCounters {
+	std::atomic<u64> allocated;
+	std::atomic<u64> high_water;
+	std::atomic<u64> allocations;
+	std::atomic<u64> budget;
+	std::atomic<bool> reported_over_budget;
+};
+
+struct alignas(64) TemporaryCounters {
+	std::atomic<u64> last_frame_peak;
+	std::atomic<u64> high_water;
+};
+
+static TagCounters tag_counters[MEMORY_TAG_COUNT];
+static TemporaryCounters temporary_counters[MAX_THREADS];
+
+static const char* memory_tag_names[MEMORY_TAG_COUNT] = {
+	"Untagged",
+	"ECS",
+	"Assets",
+	"Renderer",
+	"CFD",
+	"UI",
+};
+
+static TaggedAllocator tagged_allocators[MEMORY_TAG_COUNT] = {
+	{ MEMORY_UNTAGGED },
+	{ MEMORY_ECS },
+	{ MEMORY_ASSETS },
+	{ MEMORY_RENDERER },
+	{ MEMORY_CFD },
+	{ MEMORY_UI },
+};
+
+static void update_max(std::atomic<u64>& value, u64 candidate) {
+	u64 current = value.load(std::memory_order_relaxed);
+	while (candidate > current && !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed)) {}
+}
+
+void track_allocation(MemoryTag tag, u64 size, u64 count) {
+	TagCounters& counters = tag_counters[tag];
+	u64 allocated = counters.allocated.fetch_add(size, std::memory_order_relaxed) + size;
+	counters.allocations.fetch_add(count, std::memory_order_relaxed);
+	update_max(counters.high_water, allocated);
+
+	u64 budget = counters.budget.load(std::memory_order_relaxed);
+	if (budget != 0 && allocated > budget) {
+		if (!counters.reported_over_budget.exchange(true)) {
+			fprintf(stderr, "%s is over its memory budget, %llu of %llu bytes\n", memory_tag_names[tag],
+				(unsigned long long)allocated, (unsigned long long)budget);
+		}
+		assert(!"Memory budget exceeded");
+	}
+}
+
+void track_deallocation(MemoryTag tag, u64 size, u64 count) {
+	TagCounters& counters = tag_counters[tag];
+	counters.allocated.fetch_sub(size, std::memory_order_relaxed);
+	counters.allocations.fetch_sub(count, std::memory_order_relaxed);
+}
+
+void set_memory_budget(MemoryTag tag, u64 budget) {
+	tag_counters[tag].budget = budget;
+	tag_counters[tag].reported_over_budget = false;
+}
+
+MemoryStats get_memory_stats(MemoryTag tag) {
+	TagCounters& counters = tag_counters[tag];
+
+	MemoryStats stats;
+	stats.allocated = counters.allocated.load(std::memory_order_relaxed);
+	stats.high_water = counters.high_water.load(std::memory_order_relaxed);
+	stats.allocations = counters.allocations.load(std::memory_order_relaxed);
+	stats.budget = counters.budget.load(std::memory_order_relaxed);
+	return stats;
+}
+
+const char* memory_tag_name(MemoryTag tag) {
+	return memory_tag_names[tag];
+}
+
+void record_temporary_peak(u64 peak) {
+	TemporaryCounters& counters = temporary_counters[get_worker_id()];
+	counters.last_frame_peak.store(peak, std::memory_order_relaxed);
+	update_max(counters.high_water, peak);
+}
+
+TemporaryMemoryStats get_temporary_memory_stats(uint worker) {
+	assert(worker < MAX_THREADS);
+	TemporaryCounters& counters = temporary_counters[worker];
+
+	TemporaryMemoryStats stats;
+	stats.last_frame_peak = counters.last_frame_peak.load(std::memory_order_relaxed);
+	stats.high_water = counters.high_water.load(std::memory_order_relaxed);
+	return stats;
+}
+
+//TAGGED ALLOCATOR
+TaggedAllocator::TaggedAllocator(MemoryTag tag, Allocator* parent) : parent(parent), tag(tag) {}
+
+void* TaggedAllocator::allocate(std::size_t size) {
+	u64* header = (u64*)parent->allocate(size + TAGGED_HEADER_SIZE);
+	*header = size;
+
+	track_allocation(tag, size);
+	return (char*)header + TAGGED_HEADER_SIZE;
+}
+
+void TaggedAllocator::deallocate(void* ptr) {
+	if (ptr == NULL) return;
+
+	u64* header = (u64*)((char*)ptr - TAGGED_HEADER_SIZE);
+	track_deallocation(tag, *header);
+	parent->deallocate(header);
+}
+
+Allocator& get_tagged_allocator(MemoryTag tag) {
+	return tagged_allocators[tag];
+}
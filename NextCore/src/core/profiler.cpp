@@ -3,9 +3,10 @@
 #include "core/io/logger.h"
 #include "core/time.h"
 #include "core/job_system/job.h"
+#include "core/trace.h"
 
 //Profiler
-vector<Frame> Profiler::frames[MAX_THREADS];
+FrameHistory Profiler::frames[MAX_THREADS];
 int Profiler::profile_depth[MAX_THREADS];
 bool Profiler::paused = false;
 uint Profiler::frame_sample_count = 500;
@@ -21,13 +22,14 @@ void Profiler::begin_profile() {
 
 void Profiler::record_profile(const Profile& profile) {
 	uint worker_id = get_worker_id();
-	if (worker_id != 0) return; //temporary
-	
 	if (paused) return;
 
 	if (profile_depth[worker_id] == 0) throw "Bad record!";
 	profile_depth[worker_id]--;
 
+	//Only threads calling begin_frame keep a frame history, the trace covers every worker
+	if (frames[worker_id].length == 0) return;
+
 	Frame& frame = get_current_frame();
 
 	ProfileData data;
@@ -44,7 +46,7 @@ void Profiler::record_profile(const Profile& profile) {
 void set_sample_count(uint& count) {
 	uint worker = get_worker_id(); //dangerous
 
-	if (count < Profiler::frames[worker].length) Profiler::frames[worker].shift(Profiler::frames[worker].length - count);
+	if (count < Profiler::frames[worker].length) Profiler::frames[worker].drop_oldest(Profiler::frames[worker].length - count);
 }
 
 /*
@@ -69,10 +71,11 @@ uint worker_threads = worker_thread_count();
 */
 
 void Profiler::set_frame_sample_count(uint count) {
-	uint worker_threads = worker_thread_count();
 	uint worker = get_worker_id();
 
-	if (count < frames[worker].length) frames[worker].shift(frames[worker].length - count);
+	if (count > MAX_FRAME_SAMPLES) count = MAX_FRAME_SAMPLES;
+	if (count < frames[worker].length) frames[worker].drop_oldest(frames[worker].length - count);
+	frame_sample_count = count;
 }
 
 /*
@@ -111,13 +114,11 @@ void Profiler::begin_frame() {
 		frame.frame_swap_duration = duration;
 	}
 
-	Frame frame;
-	frame.start_of_frame = current_time;
-
 	if (frames[worker].length >= frame_sample_count)
-		frames[worker].shift(1);
+		frames[worker].drop_oldest(frames[worker].length - frame_sample_count + 1);
 
-	frames[worker].append(std::move(frame));
+	Frame& frame = frames[worker].push();
+	frame.start_of_frame = current_time;
 
 	profile_depth[worker] = 0;
 }
@@ -137,12 +138,14 @@ Profile::Profile(const char* name) {
 	this->ended = false;
 
 	Profiler::begin_profile();
+	trace_event(TRACE_SCOPE_BEGIN, name);
 };
 
 void Profile::end() {
 	this->ended = true;
 	this->end_time = Time::now();
 
+	trace_event(TRACE_SCOPE_END, name);
 	Profiler::record_profile(*this);
 }
 
@@ -11,7 +11,7 @@
 
 using namespace refl;
 
-LinearAllocator reflection_allocator(mb(10));
+LinearAllocator reflection_allocator(LINEAR_VIRTUAL, gb(1));
 
 #define RESOLVE_PRIMITIVE_TYPE(typ, enum_name) Type* get_##typ##_type() { \
 	static Type type{Type::enum_name, sizeof(typ) };\
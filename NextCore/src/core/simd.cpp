@@ -0,0 +1,82 @@
+#include "stdafx.h"
+#include "core/simd.h"
+#include <atomic>
+
+#ifdef NE_SIMD_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+
+static void cpuid(int regs[4], int leaf) {
+	__cpuidex(regs, leaf, 0);
+}
+
+static u64 xgetbv() {
+	return _xgetbv(0);
+}
+#else
+#include <cpuid.h>
+
+static void cpuid(int regs[4], int leaf) {
+	__cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+}
+
+static u64 xgetbv() {
+	uint low, high;
+	__asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+	return ((u64)high << 32) | low;
+}
+#endif
+#endif
+
+SimdLevel detect_simd_level() {
+#ifdef NE_SIMD_X86
+	int regs[4];
+	cpuid(regs, 0);
+	int max_leaf = regs[0];
+
+	cpuid(regs, 1);
+	bool sse2 = regs[3] & (1 << 26);
+	bool sse4 = regs[2] & (1 << 19);
+	bool fma = regs[2] & (1 << 12);
+	bool osxsave = regs[2] & (1 << 27);
+	bool avx = regs[2] & (1 << 28);
+
+	if (!sse4) return sse2 ? SIMD_SSE2 : SIMD_SCALAR;
+
+	//The os has to save the ymm registers on context switches
+	bool ymm_enabled = osxsave && (xgetbv() & 6) == 6;
+	if (!avx || !fma || !ymm_enabled || max_leaf < 7) return SIMD_SSE4;
+
+	cpuid(regs, 7);
+	bool avx2 = regs[1] & (1 << 5);
+	return avx2 ? SIMD_AVX2 : SIMD_SSE4;
+#else
+	return SIMD_SCALAR;
+#endif
+}
+
+static std::atomic<int> current_level = -1;
+
+SimdLevel simd_level() {
+	int level = current_level.load(std::memory_order_relaxed);
+	if (level == -1) {
+		level = detect_simd_level();
+		current_level.store(level, std::memory_order_relaxed);
+	}
+	return (SimdLevel)level;
+}
+
+void set_simd_level(SimdLevel level) {
+	SimdLevel detected = detect_simd_level();
+	current_level.store(level < detected ? level : detected, std::memory_order_relaxed);
+}
+
+const char* simd_level_name(SimdLevel level) {
+	switch (level) {
+	case SIMD_SCALAR: return "scalar";
+	case SIMD_SSE2: return "sse2";
+	case SIMD_SSE4: return "sse4";
+	case SIMD_AVX2: return "avx2";
+	}
+	return "unknown";
+}
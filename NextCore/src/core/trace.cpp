@@ -0,0 +1,245 @@
+#include "stdafx.h"
+#include "core/trace.h"
+#include "core/job_system/thread.h"
+#include "core/job_system/fiber.h"
+#include "core/container/vector.h"
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+struct alignas(64) TraceBuffer {
+	std::atomic<u64> head;
+	std::atomic<bool> writing; //set while the worker records an event, see export_chrome_trace
+	TraceEvent* events;
+};
+
+static TraceBuffer trace_buffers[MAX_THREADS];
+static uint trace_worker_count;
+static std::atomic<bool> tracing;
+
+static u64 trace_time() {
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void make_trace_buffers(uint num_workers) {
+	assert(num_workers <= MAX_THREADS);
+
+	for (uint i = 0; i < num_workers; i++) {
+		trace_buffers[i].head = 0;
+		trace_buffers[i].events = (TraceEvent*)calloc(TRACE_BUFFER_SIZE, sizeof(TraceEvent));
+	}
+
+	trace_worker_count = num_workers;
+}
+
+void destroy_trace_buffers() {
+	tracing = false;
+
+	for (uint i = 0; i < trace_worker_count; i++) {
+		free(trace_buffers[i].events);
+		trace_buffers[i].events = nullptr;
+	}
+
+	trace_worker_count = 0;
+}
+
+void begin_tracing() {
+	for (uint i = 0; i < trace_worker_count; i++) {
+		trace_buffers[i].head.store(0, std::memory_order_relaxed);
+	}
+
+	tracing.store(true, std::memory_order_release);
+}
+
+void end_tracing() {
+	tracing.store(false, std::memory_order_release);
+}
+
+bool is_tracing() {
+	return tracing.load(std::memory_order_relaxed);
+}
+
+void trace_event(TraceEventType type, const char* name, uint arg) {
+	if (!tracing.load(std::memory_order_relaxed)) return;
+
+	//Events from editor or IO threads, or from the main thread before it joins the job system, have no buffer and are dropped
+	if (!is_worker_thread()) return;
+	uint worker = get_worker_id();
+	if (worker >= trace_worker_count) return;
+
+	TraceBuffer& buffer = trace_buffers[worker];
+
+	//Checked again after announcing the write, either the export sees the flag or we see tracing was turned off
+	buffer.writing.store(true);
+	if (tracing.load()) {
+		u64 head = buffer.head.load(std::memory_order_relaxed);
+
+		buffer.events[head % TRACE_BUFFER_SIZE] = { trace_time(), name, get_current_fiber(), type, arg };
+		buffer.head.store(head + 1, std::memory_order_release);
+	}
+	buffer.writing.store(false, std::memory_order_release);
+}
+
+//EXPORT
+
+static void write_json_string(FILE* file, const char* str) {
+	fputc('"', file);
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\') fputc('\\', file);
+		if ((unsigned char)*str >= 0x20) fputc(*str, file);
+	}
+	fputc('"', file);
+}
+
+static bool is_span_begin(TraceEventType type) {
+	return type == TRACE_SCOPE_BEGIN || type == TRACE_JOB_BEGIN || type == TRACE_WORKER_SLEEP;
+}
+
+static bool is_span_end(TraceEventType type) {
+	return type == TRACE_SCOPE_END || type == TRACE_JOB_END || type == TRACE_WORKER_WAKE;
+}
+
+static TraceEventType span_begin_type(TraceEventType end) {
+	switch (end) {
+	case TRACE_SCOPE_END: return TRACE_SCOPE_BEGIN;
+	case TRACE_JOB_END: return TRACE_JOB_BEGIN;
+	default: return TRACE_WORKER_SLEEP;
+	}
+}
+
+static const char* span_name(const TraceEvent& begin) {
+	switch (begin.type) {
+	case TRACE_JOB_BEGIN: return "Job";
+	case TRACE_WORKER_SLEEP: return "Parked";
+	default: return begin.name ? begin.name : "";
+	}
+}
+
+bool export_chrome_trace(const char* path) {
+	bool was_tracing = tracing.exchange(false);
+
+	//A worker may have seen tracing just before it was turned off
+	for (uint worker = 0; worker < trace_worker_count; worker++) {
+		while (trace_buffers[worker].writing.load()) thread_sleep(0);
+	}
+
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		fprintf(stderr, "Could not open trace file %s\n", path);
+		if (was_tracing) tracing = true;
+		return false;
+	}
+
+	u64 start_time = UINT64_MAX;
+	for (uint worker = 0; worker < trace_worker_count; worker++) {
+		TraceBuffer& buffer = trace_buffers[worker];
+		u64 head = buffer.head.load(std::memory_order_acquire);
+		if (head == 0) continue;
+
+		u64 first = head > TRACE_BUFFER_SIZE ? head - TRACE_BUFFER_SIZE : 0;
+		u64 time = buffer.events[first % TRACE_BUFFER_SIZE].time;
+		if (time < start_time) start_time = time;
+	}
+
+	fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+	vector<const TraceEvent*> open;
+	open.allocator = &default_allocator;
+	u64 async_id = 0;
+
+	bool first_event = true;
+	auto begin_event = [&]() {
+		if (!first_event) fprintf(file, ",\n");
+		first_event = false;
+	};
+
+	for (uint worker = 0; worker < trace_worker_count; worker++) {
+		begin_event();
+		fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}",
+			worker, worker == 0 ? "Main" : "Worker", worker);
+
+		TraceBuffer& buffer = trace_buffers[worker];
+		u64 head = buffer.head.load(std::memory_order_acquire);
+		u64 first = head > TRACE_BUFFER_SIZE ? head - TRACE_BUFFER_SIZE : 0;
+
+		//Spans which have begun on this worker in the order they began. A fiber's spans nest,
+		//but a parked job's span stays open while jobs on other fibers run on the worker.
+		open.clear();
+
+		for (u64 i = first; i < head; i++) {
+			const TraceEvent& event = buffer.events[i % TRACE_BUFFER_SIZE];
+
+			if (is_span_begin(event.type)) {
+				open.append(&event);
+				continue;
+			}
+
+			if (is_span_end(event.type)) {
+				TraceEventType begin_type = span_begin_type(event.type);
+
+				int found = -1;
+				for (int k = (int)open.length - 1; k >= 0; k--) {
+					if (open[k]->fiber == event.fiber && open[k]->type == begin_type) {
+						found = k;
+						break;
+					}
+				}
+
+				//The ring overwrote the begin
+				if (found == -1) continue;
+
+				const TraceEvent& begin = *open[found];
+				double ts = (begin.time - start_time) / 1000.0;
+				double end_ts = (event.time - start_time) / 1000.0;
+
+				//Every span that began later has ended, so it nests inside the spans still open
+				if (found == (int)open.length - 1) {
+					begin_event();
+					fprintf(file, "{\"name\":");
+					write_json_string(file, span_name(begin));
+					fprintf(file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}", ts, end_ts - ts, worker);
+				}
+				else {
+					u64 id = async_id++;
+
+					begin_event();
+					fprintf(file, "{\"name\":");
+					write_json_string(file, span_name(begin));
+					fprintf(file, ",\"cat\":\"fiber\",\"ph\":\"b\",\"id\":%llu,\"ts\":%.3f,\"pid\":0,\"tid\":%u}", (unsigned long long)id, ts, worker);
+
+					begin_event();
+					fprintf(file, "{\"name\":");
+					write_json_string(file, span_name(begin));
+					fprintf(file, ",\"cat\":\"fiber\",\"ph\":\"e\",\"id\":%llu,\"ts\":%.3f,\"pid\":0,\"tid\":%u}", (unsigned long long)id, end_ts, worker);
+				}
+
+				for (uint k = found; k + 1 < open.length; k++) open[k] = open[k + 1];
+				open.length--;
+				continue;
+			}
+
+			const char* name = nullptr;
+			switch (event.type) {
+			case TRACE_JOB_ENQUEUE: name = "Enqueue"; break;
+			case TRACE_JOB_STEAL: name = "Steal"; break;
+			default: name = "Fiber switch"; break;
+			}
+
+			begin_event();
+			fprintf(file, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":0,\"tid\":%u", name, (event.time - start_time) / 1000.0, worker);
+
+			if (event.type == TRACE_JOB_ENQUEUE) fprintf(file, ",\"args\":{\"count\":%u}", event.arg);
+			else if (event.type == TRACE_JOB_STEAL) fprintf(file, ",\"args\":{\"victim\":%u}", event.arg);
+
+			fprintf(file, "}");
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+
+	if (was_tracing) tracing = true;
+	return true;
+}
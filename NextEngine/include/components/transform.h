@@ -2,7 +2,10 @@
 
 #include <glm/vec3.hpp>
 #include <glm/gtc/quaternion.hpp>
+#include <glm/mat4x4.hpp>
+#include <limits.h>
 #include "ecs/id.h"
+#include "core/container/vector.h"
 
 COMP
 struct Transform {
@@ -27,6 +30,46 @@ struct LocalTransform {
 struct World;
 struct UpdateCtx;
 
+//TRANSFORM HIERARCHY
+//Entities with a LocalTransform are children of LocalTransform::owner. They are kept sorted by depth, so
+//each level only reads the level above it and is propagated in parallel. The buckets are only rebuilt
+//when an owner changes or children are added or removed.
+//Subtrees are skipped unless their LocalTransform or the Transform of the root differs from the last update,
+//a child Transform written elsewhere is still overwritten by the next update.
+constexpr uint NO_TRANSFORM_NODE = UINT_MAX;
+
+struct TransformNode {
+	ID id;
+	ID owner;
+	uint parent; //index of the owner in nodes, NO_TRANSFORM_NODE when it is a root, itself when cut out of an owner cycle
+};
+
+struct TransformHierarchy {
+	vector<TransformNode> nodes; //ordered by depth
+	vector<uint> levels; //first node of each depth, with the node count at the end
+	vector<uint> node_of; //index in nodes by entity_index
+
+	//Parallel to nodes
+	vector<Transform> transforms; //written to the Transform components, children read their owner from here
+	vector<bool> changed; //updated in the last propagation
+
+	//Inputs of the last propagation, writes are only tracked per block so values are compared to find what changed
+	vector<LocalTransform> locals;
+	vector<Transform> owners; //only for roots
+
+	const World* world = nullptr;
+	uint world_epoch = 0;
+	EntityQuery query;
+	uint version = 0; //World::change_version of the last update
+
+	ENGINE_API TransformHierarchy();
+
+	ENGINE_API void update(World&, UpdateCtx&);
+	ENGINE_API void rebuild(World&, EntityQuery);
+	ENGINE_API void propagate(World&, bool all);
+};
+
+//Updates a hierarchy owned by the engine, one is kept for every world it's called with
 ENGINE_API void update_local_transforms(World&, UpdateCtx&);
 
 ENGINE_API void calc_global_transform(World& world, ID id);
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "ecs/ecs.h"
+#include "core/container/vector.h"
+#include "core/job_system/thread.h"
+#include <new>
+#include <utility>
+
+//COMMAND BUFFERS
+//Jobs can't make structural changes to the world while other jobs are iterating it, instead they record
+//creates, destroys and component adds and removes into a command buffer which is played back later.
+//Entities made by a buffer get a pending id with PENDING_ID_BIT set, which later commands in the same buffer can use.
+//Pending ids are only meaningful to the buffer that returned them.
+//Component values are stored in chunks which never move, so components don't need to be trivially relocatable.
+
+//Values that don't fit a chunk with their alignment padding get an allocation of their own
+constexpr u64 COMMAND_PAYLOAD_CHUNK_SIZE = kb(16);
+
+constexpr ID PENDING_ID_BIT = 1u << 31;
+static_assert((PENDING_ID_BIT >> ENTITY_INDEX_BITS & ENTITY_GENERATION_MASK) == 0, "pending ids can't overlap the generation");
+
+enum EntityCommandType : u8 {
+	MAKE_ENTITY_COMMAND,
+	FREE_ENTITY_COMMAND,
+	ADD_COMPONENT_COMMAND,
+	REMOVE_COMPONENT_COMMAND
+};
+
+//Type erased functions of the component a command carries
+struct EntityCommandOps {
+	void(*move_construct)(void* dst, void* src); //destructs src
+	void(*destruct)(void* ptr);
+};
+
+template<typename T>
+EntityCommandOps* entity_command_ops() {
+	static EntityCommandOps ops = {
+		[](void* dst, void* src) { new (dst) T(std::move(*(T*)src)); ((T*)src)->~T(); },
+		[](void* ptr) { ((T*)ptr)->~T(); }
+	};
+	return &ops;
+}
+
+struct EntityCommand {
+	EntityCommandType type;
+	uint component;
+	ID id;
+	uint sort_key;
+	Archetype arch; //archetype made entities start with
+	Archetype assigned; //components of a made entity an add command has constructed during playback
+	void* payload; //the component value
+	EntityCommandOps* ops;
+};
+
+struct EntityCommandBuffer {
+	vector<EntityCommand> commands;
+	vector<u8*> chunks; //chunks past chunk_count are kept for reuse
+	vector<u8*> large_payloads;
+	uint chunk_count = 0;
+	u64 chunk_used = 0; //bytes used in the last chunk in use
+	vector<uint> made; //command index of each pending id
+	vector<ID> made_ids; //filled in during playback
+
+	//Commands are played back ordered by sort key, commands with the same key keep the order they were recorded in.
+	//Using the id of the entity or chunk being processed as the key makes playback deterministic no matter
+	//which thread processed it.
+	uint sort_key = 0;
+
+	EntityCommandBuffer() {
+		commands.allocator = &default_allocator;
+		chunks.allocator = &default_allocator;
+		large_payloads.allocator = &default_allocator;
+		made.allocator = &default_allocator;
+		made_ids.allocator = &default_allocator;
+	}
+
+	ENGINE_API ~EntityCommandBuffer();
+
+	EntityCommandBuffer(const EntityCommandBuffer&) = delete;
+	void operator=(const EntityCommandBuffer&) = delete;
+
+	ID make(EntityFlags flags = 0) {
+		ID id = PENDING_ID_BIT | made.length;
+		made.append(commands.length);
+
+		EntityCommand command = {};
+		command.type = MAKE_ENTITY_COMMAND;
+		command.id = id;
+		command.arch = to_archetype<>(flags);
+		push(command);
+		return id;
+	}
+
+	//Same as World::make<Args...>, set the values with add afterwards
+	template<typename... Args>
+	ID make(EntityFlags flags = 0) {
+		ID id = make(flags);
+		(add<Args>(id), ...);
+		return id;
+	}
+
+	void free(ID id) {
+		EntityCommand command = {};
+		command.type = FREE_ENTITY_COMMAND;
+		command.id = id;
+		push(command);
+	}
+
+	//Replaces the component if the entity already has one
+	template<typename T>
+	void add(ID id, T&& value) {
+		using Component = std::decay_t<T>;
+
+		void* payload = alloc_payload(sizeof(Component), alignof(Component));
+		new (payload) Component(std::forward<T>(value));
+
+		EntityCommand command = {};
+		command.type = ADD_COMPONENT_COMMAND;
+		command.component = component_id<Component>();
+		command.id = id;
+		command.payload = payload;
+		command.ops = entity_command_ops<Component>();
+		push(command);
+	}
+
+	template<typename T>
+	void add(ID id) {
+		add(id, T());
+	}
+
+	template<typename T>
+	void remove(ID id) {
+		EntityCommand command = {};
+		command.type = REMOVE_COMPONENT_COMMAND;
+		command.component = component_id<T>();
+		command.id = id;
+		command.ops = entity_command_ops<T>();
+		push(command);
+	}
+
+	bool empty() const { return commands.length == 0; }
+
+	//Destructs the payloads of commands which were never played back
+	ENGINE_API void clear();
+
+	//Rewinds the chunks and frees the large payloads, every value must have been moved out or destructed
+	ENGINE_API void release_payloads();
+
+private:
+	ENGINE_API void* alloc_payload(u64 size, uint alignment);
+
+	void push(EntityCommand& command) {
+		command.sort_key = sort_key;
+		commands.append(command);
+	}
+};
+
+//One buffer per worker thread, a job records into the buffer of the thread it is running on.
+//A job must not keep the buffer across a wait, since it may resume on another thread.
+struct EntityCommandBuffers {
+	EntityCommandBuffer buffers[MAX_THREADS];
+
+	EntityCommandBuffer& local() { return buffers[get_worker_id()]; }
+};
+
+//Sync points, runs the commands then clears the buffers.
+//Made entities are created first, those with the same archetype together, a block at a time.
+//The remaining commands then run in sort key order, commands on entities that were freed are skipped.
+ENGINE_API void playback(World& world, slice<EntityCommandBuffer*> buffers);
+ENGINE_API void playback(World& world, EntityCommandBuffers& buffers);
+ENGINE_API void playback(World& world, EntityCommandBuffer& buffer);
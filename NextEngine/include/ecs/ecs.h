@@ -9,15 +9,147 @@
 #include "core/container/tvector.h"
 #include "core/container/array.h"
 #include "core/container/slice.h"
+#include "core/container/vector.h"
+#include "core/memory/memory_tracking.h"
+#include "core/job_system/job.h"
+#include <type_traits>
 
 COMP
 struct Entity {
 	ID id;
 };
 
-struct BlockHeader {
+//Blocks are aligned to MAX_COLUMN_ALIGNMENT, so the component data after the header is too
+struct alignas(MAX_COLUMN_ALIGNMENT) BlockHeader {
 	BlockHeader* next;
 	EntityFlags flags;
+	uint versions[MAX_COMPONENTS]; //World::change_version each component was last written at
+	uint block_size; //in bytes including the header
+};
+
+//ENTITY TABLE
+//Maps the index of an id to the block and row the entity lives in. Slots are kept in pages which are only
+//allocated once an index in them is handed out, so memory grows with the number of entities instead of a fixed maximum.
+//Freeing an entity bumps the generation of its slot, so ids kept around afterwards no longer find anything.
+//A slot whose generation would wrap is retired instead of reused, and only handed out again once every index is taken.
+struct EntitySlot {
+	BlockHeader* block; //null while the entity has no components
+	uint store; //index in World::arches
+	uint row;
+	u16 generation;
+};
+
+struct EntityPage {
+	EntitySlot slots[ENTITY_PAGE_SIZE];
+};
+
+struct EntityTable {
+	vector<EntityPage*> pages;
+	vector<uint> free_indices;
+	vector<uint> retired_indices;
+	uint next_index = 1;
+
+	EntityTable() {
+		pages.allocator = &default_allocator;
+		free_indices.allocator = &default_allocator;
+		retired_indices.allocator = &default_allocator;
+	}
+
+	EntityTable(const EntityTable&) = delete;
+
+	~EntityTable() {
+		clear();
+	}
+
+	EntityTable& operator=(const EntityTable& other) {
+		clear();
+		for (EntityPage* page : other.pages) {
+			EntityPage* copy = (EntityPage*)default_allocator.allocate(sizeof(EntityPage));
+			memcpy(copy, page, sizeof(EntityPage));
+			pages.append(copy);
+		}
+		free_indices = other.free_indices;
+		retired_indices = other.retired_indices;
+		next_index = other.next_index;
+		return *this;
+	}
+
+	void clear() {
+		for (EntityPage* page : pages) default_allocator.deallocate(page);
+		pages.clear();
+		free_indices.clear();
+		retired_indices.clear();
+		next_index = 1;
+	}
+
+	EntitySlot& operator[](uint index) {
+		return pages[index / ENTITY_PAGE_SIZE]->slots[index % ENTITY_PAGE_SIZE];
+	}
+
+	//Slot of the entity, null if the id was freed or never handed out
+	EntitySlot* find(ID id) const {
+		uint index = entity_index(id);
+		if (index / ENTITY_PAGE_SIZE >= pages.length) return nullptr;
+
+		EntitySlot* slot = pages[index / ENTITY_PAGE_SIZE]->slots + index % ENTITY_PAGE_SIZE;
+		if (!slot->block || slot->generation != entity_generation(id)) return nullptr;
+		return slot;
+	}
+
+	ID make_id() {
+		uint index;
+		if (free_indices.length > 0) index = free_indices.pop();
+		else if (next_index <= ENTITY_INDEX_MASK || retired_indices.length == 0) index = next_index++;
+		else index = retired_indices.pop(); //every index is taken, stale ids of retired slots can alias again
+		assert(index <= ENTITY_INDEX_MASK);
+		ensure_page(index);
+
+		EntitySlot& slot = (*this)[index];
+		slot.block = nullptr;
+		return slot.generation << ENTITY_INDEX_BITS | index;
+	}
+
+	//Takes the slot of an id handed out before, such as one loaded with a scene
+	void claim_id(ID id) {
+		uint index = entity_index(id);
+		ensure_page(index);
+		if (next_index <= index) next_index = index + 1;
+
+		(*this)[index].generation = entity_generation(id);
+	}
+
+	void free_id(ID id) {
+		uint index = entity_index(id);
+		EntitySlot& slot = (*this)[index];
+		slot.block = nullptr;
+		slot.generation = (slot.generation + 1) & ENTITY_GENERATION_MASK;
+		if (slot.generation == 0) retired_indices.append(index);
+		else free_indices.append(index);
+	}
+
+	//The ids that will be handed out again, with the generation they will have
+	tvector<ID> free_ids() {
+		tvector<ID> ids;
+		ids.reserve(free_indices.length);
+		for (uint index : free_indices) ids.append((*this)[index].generation << ENTITY_INDEX_BITS | index);
+		return ids;
+	}
+
+	void load_free_ids(slice<ID> ids) {
+		free_indices.clear();
+		for (ID id : ids) {
+			claim_id(id);
+			free_indices.append(entity_index(id));
+		}
+	}
+
+	void ensure_page(uint index) {
+		while (pages.length <= index / ENTITY_PAGE_SIZE) {
+			EntityPage* page = (EntityPage*)default_allocator.allocate(sizeof(EntityPage));
+			memset(page, 0, sizeof(EntityPage));
+			pages.append(page);
+		}
+	}
 };
 
 REFL
@@ -29,33 +161,80 @@ struct ArchetypeStore {
 	uint max_per_block;
 	uint entity_count_last_block;
 	REFL_FALSE BlockHeader* blocks;
+	REFL_FALSE uint block_size;
+
+	//Archetype graph, the edges are filled in the first time an entity takes them.
+	//Moving along an edge only copies the components the entity keeps, listed in components.
+	REFL_FALSE uint component_count;
+	REFL_FALSE u8 components[64]; //ascending ids
+	REFL_FALSE uint add_edges[64]; //index + 1 in World::arches after adding the component, 0 if unknown
+	REFL_FALSE uint remove_edges[64];
 };
 
 //todo reflection parser isn't able to find constant's yet, offsets should [MAX_COMPONENTS]
 
+//CHANGE TRACKING
+//Every block stores the version each of its components was last written at. Iterating components that
+//aren't const counts as writing them, as does adding entities to a block.
+struct ChangeTracking {
+	Archetype changed = 0; //skip blocks where none of these were written after since
+	uint since = 0;
+	Archetype written = 0;
+	uint version = 0;
+};
+
+//A single block of an archetype store, each component is an array of count elements starting at its offset
+struct Chunk {
+	ArchetypeStore* store;
+	BlockHeader* block;
+	uint count;
+};
+
 struct ComponentPtr {
 	uint component_id;
 	void* data;
 };
 
+//Components may be declared const to only read them, they have the same id
+template<typename T>
+uint component_id() {
+	return type_id<std::remove_const_t<T>>();
+}
+
 template<typename... T>
 Archetype to_archetype(EntityFlags flags = 0) {
-	return ((1ull | flags) | ... | (1ull << type_id<T>()));
+	return ((1ull | flags) | ... | (1ull << component_id<T>()));
+}
+
+//Components which aren't const may be written
+template<typename... T>
+Archetype write_archetype() {
+	return (0ull | ... | (std::is_const_v<T> ? 0ull : 1ull << component_id<T>()));
+}
+
+inline bool query_matches(EntityQuery query, Archetype arch) {
+	return (arch & query.all) == query.all && (query.some == 0 || (arch & query.some) != 0) && (arch & query.none) == 0;
 }
 
 template<typename... Args>
 EntityQuery EntityQuery::with_all(EntityFlags flags) {
-	return { (all | to_archetype<Args...>(flags)) & (~1ull), some, none };
+	return { (all | to_archetype<Args...>(flags)) & (~1ull), some, none, changed };
 }
 
 template<typename... Args>
 EntityQuery EntityQuery::with_none(EntityFlags flags) {
-	return { all, some, none | (to_archetype<Args...>(flags) & ~1ull) };
+	return { all, some, none | (to_archetype<Args...>(flags) & ~1ull), changed };
 }
 
 template<typename... Args>
 EntityQuery EntityQuery::with_some(EntityFlags flags) {
-	return { all, some | (to_archetype<Args...>(flags) & ~1ull), none };
+	return { all, some | (to_archetype<Args...>(flags) & ~1ull), none, changed };
+}
+
+template<typename... Args>
+EntityQuery EntityQuery::with_changed() {
+	Archetype arch = to_archetype<Args...>() & ~1ull;
+	return { all | arch, some, none, changed | arch };
 }
 
 template<typename T>
@@ -120,16 +299,20 @@ struct RegisterComponent {
     refl::Type* type;
     ComponentLifetimeFunc funcs;
 	ComponentKind kind;
+	uint alignment; //alignof the component, columns are aligned to at least COLUMN_ALIGNMENT
 };
 
 struct World {
-	Archetype id_to_arch[MAX_ENTITIES] = {};
-	void* id_to_ptr[MAX_COMPONENTS][MAX_ENTITIES] = {};
-	uint dirty_components[MAX_COMPONENTS][MAX_ENTITIES / 16];
+	EntityTable entities;
 	hash_map<Archetype, ArchetypeStore, ARCHETYPE_HASH> arches;
+	array<ARCHETYPE_HASH, uint> archetype_indices; //indices into arches in creation order
+	uint epoch = 0; //incremented when arches is replaced, invalidating cached queries
+	uint change_version = 1;
+	uint removals = 0; //counts entities leaving a store, destroyed or moved to another archetype, which changed filters can miss
 
 	refl::Struct* component_type[MAX_COMPONENTS] = {};
 	u64 component_size[MAX_COMPONENTS] = {};
+	uint component_alignment[MAX_COMPONENTS] = {}; //alignof the component, 0 if unknown
 	ComponentLifetimeFunc component_lifetime_funcs[MAX_COMPONENTS] = {};
 	ComponentKind component_kind[MAX_COMPONENTS] = {};
 	Archetype system_component_mask = 0;
@@ -138,21 +321,24 @@ struct World {
 	u64 world_memory_offset = 0;
 	u64 world_memory_size;
 
-	BlockHeader* block_free_list = NULL;
+	BlockHeader* block_free_list[BLOCK_SIZE_CLASSES] = {};
 
-	array<MAX_ENTITIES, ID> free_ids;
+	World(u64 memory) : world_memory(alloc_world_memory(memory)), world_memory_size(memory) {}
 
-	World(u64 memory) : world_memory(new u8[memory]), world_memory_size(memory) {
-		for (int i = MAX_ENTITIES - 1; i > 0; i--) {
-			free_ids.append(i);
-		}
+	//Blocks are cut from the start of world memory in multiples of BLOCK_SIZE, so aligning it aligns every block
+	static u8* alloc_world_memory(u64 memory) {
+		u8* data = new u8[memory + MAX_COLUMN_ALIGNMENT];
+		return data + (align_offset((u64)data, MAX_COLUMN_ALIGNMENT) - (u64)data);
 	}
-    
+
     ENGINE_API void register_components(slice<struct RegisterComponent> components);
     ENGINE_API ID clone(ID id);
 
 	void clear() {
+		track_deallocation(MEMORY_ECS, world_memory_offset, world_memory_offset / BLOCK_SIZE);
 		world_memory_offset = 0;
+		entities.clear();
+		removals++;
 	}
 
 	refl::Struct* get_type_for(ComponentPtr ptr) {
@@ -162,46 +348,62 @@ struct World {
 	World(const World& world) = delete;
     ENGINE_API World& operator=(const World& from);
 
-	BlockHeader* alloc_block() {
+	static uint block_size_class(uint block_size) {
+		uint size_class = 0;
+		while ((BLOCK_SIZE << size_class) < block_size) size_class++;
+		assert(size_class < BLOCK_SIZE_CLASSES && (BLOCK_SIZE << size_class) == block_size);
+		return size_class;
+	}
+
+	BlockHeader* alloc_block(uint block_size = BLOCK_SIZE) {
+		assert(world_memory_offset + block_size <= world_memory_size);
 		BlockHeader* block = (BlockHeader*)(world_memory + world_memory_offset);
 		block->next = nullptr;
-		world_memory_offset += BLOCK_SIZE;
+		block->block_size = block_size;
+		init_block_versions(block);
+		world_memory_offset += block_size;
+		track_allocation(MEMORY_ECS, block_size);
 		return block;
 	}
 
-	void prealloc_blocks(uint n) {
+	//New blocks count as written
+	void init_block_versions(BlockHeader* block) {
+		for (uint i = 0; i < MAX_COMPONENTS; i++) block->versions[i] = change_version;
+	}
+
+	void prealloc_blocks(uint n, uint block_size = BLOCK_SIZE) {
 		for (uint i = 0; i < n; i++) {
-			//todo allocate large blocks
-			BlockHeader* block = alloc_block();
-			block->next = block_free_list;
-			block_free_list = block;
+			release_block(alloc_block(block_size));
 		}
 	}
 
 
-	BlockHeader* get_block() {
-		BlockHeader* block = block_free_list;
+	BlockHeader* get_block(uint block_size = BLOCK_SIZE) {
+		BlockHeader*& free_list = block_free_list[block_size_class(block_size)];
+		BlockHeader* block = free_list;
         if (block) {
             assert(block != block->next);
-            block_free_list = block->next;
+            free_list = block->next;
         }
-		else block = alloc_block();
+		else block = alloc_block(block_size);
 
 		block->next = NULL;
+		init_block_versions(block);
 		return block;
 	}
 
 	void release_block(BlockHeader* header) {
-		header->next = block_free_list;
-		block_free_list = header;
+		BlockHeader*& free_list = block_free_list[block_size_class(header->block_size)];
+		header->next = free_list;
+		free_list = header;
 	}
 
-	uint make_id() {
-		return free_ids.pop();
+	ID make_id() {
+		return entities.make_id();
 	}
 
 	void add_block(ArchetypeStore& store) {
-		BlockHeader* block = get_block();
+		BlockHeader* block = get_block(store.block_size);
         assert(store.blocks != block);
 		block->next = store.blocks;
 
@@ -211,28 +413,16 @@ struct World {
 	}
 
 	ArchetypeStore& make_archetype(Archetype arch) {
+		bool is_new = arches.index(arch) == -1;
+
 		ArchetypeStore& store = arches[arch];
 		store = {};
 
-		add_block(store);
+		if (is_new) archetype_indices.append(store_index(store));
 
-		u64 combined_size = 0;
-		for (uint i = 0; i < MAX_COMPONENTS; i++) {
-			if (arch & (1ull << i)) combined_size += component_size[i];
-		}
-
-		u64 max_entities_per_block = (BLOCK_SIZE - sizeof(BlockHeader)) / combined_size;
-		store.max_per_block = max_entities_per_block;
-
-		//SOA layout, todo handle alignment!
-		u64 offset = 0;
-
-		for (uint i = 0; i < MAX_COMPONENTS; i++) { //note: offset of Entity(component_id: 0) is always 0
-			if (has_component(arch, i)) {
-				store.offsets[i] = offset;
-				offset += component_size[i] * max_entities_per_block;
-			}
-		}
+		init_archetype_components(store, arch);
+		layout_store(store, default_block_size(store));
+		add_block(store);
 
 		/*
 		uint dirty_bits = max_entities_per_block;
@@ -247,6 +437,111 @@ struct World {
 		return store;
 	}
 
+	//BLOCK LAYOUT
+	//Each component is a column of max_per_block elements, starting at a multiple of its column alignment.
+	//The capacity is rounded down to BLOCK_CAPACITY_MULTIPLE if at least that many entities fit.
+	uint column_alignment(uint component) const {
+		uint alignment = max(component_alignment[component], COLUMN_ALIGNMENT);
+		assert(alignment <= MAX_COLUMN_ALIGNMENT);
+		return alignment;
+	}
+
+	uint block_capacity(const ArchetypeStore& store, uint block_size) const {
+		u64 combined_size = 0;
+		u64 padding = 0;
+		for (uint i = 0; i < store.component_count; i++) {
+			combined_size += component_size[store.components[i]];
+			padding += column_alignment(store.components[i]) - 1;
+		}
+
+		u64 available = block_size - sizeof(BlockHeader);
+		u64 capacity = available > padding ? (available - padding) / combined_size : 0;
+		if (capacity >= BLOCK_CAPACITY_MULTIPLE) capacity -= capacity % BLOCK_CAPACITY_MULTIPLE;
+		return capacity;
+	}
+
+	void layout_store(ArchetypeStore& store, uint block_size) {
+		store.block_size = block_size;
+		store.max_per_block = block_capacity(store, block_size);
+		assert(store.max_per_block > 0);
+
+		u64 offset = 0;
+		for (uint i = 0; i < store.component_count; i++) { //note: offset of Entity(component_id: 0) is always 0
+			uint component = store.components[i];
+			store.offsets[component] = aligned_incr(&offset, component_size[component] * store.max_per_block, column_alignment(component));
+		}
+	}
+
+	//Smallest block that holds MIN_ENTITIES_PER_BLOCK, so archetypes with large components don't get tiny blocks
+	uint default_block_size(const ArchetypeStore& store) const {
+		uint block_size = BLOCK_SIZE;
+		while (block_size < MAX_BLOCK_SIZE && block_capacity(store, block_size) < MIN_ENTITIES_PER_BLOCK) block_size *= 2;
+		return block_size;
+	}
+
+	//Overrides the block size picked for the archetype, it can't have any entities yet.
+	//Loaded scenes keep the size, since it's derived from the saved layout.
+	void set_block_size(Archetype arch, uint block_size) {
+		ArchetypeStore& store = find_archetype(arch);
+		assert(store.entity_count_last_block == 0 && store.block_count <= 1);
+
+		if (store.blocks) release_block(store.blocks);
+		store.blocks = nullptr;
+		store.block_count = 0;
+
+		block_size_class(block_size);
+		layout_store(store, block_size);
+		add_block(store);
+	}
+
+	//Smallest block size that fits a layout made elsewhere, such as one saved with a scene
+	uint fitting_block_size(Archetype arch, const ArchetypeStore& store) const {
+		u64 end = 0;
+		for (uint i = 0; i < MAX_COMPONENTS; i++) {
+			if (!has_component(arch, i)) continue;
+			u64 column_end = store.offsets[i] + component_size[i] * store.max_per_block;
+			if (column_end > end) end = column_end;
+		}
+
+		uint block_size = BLOCK_SIZE;
+		while (block_size < sizeof(BlockHeader) + end) block_size *= 2;
+		return block_size;
+	}
+
+	void init_archetype_components(ArchetypeStore& store, Archetype arch) {
+		store.component_count = 0;
+		for (uint i = 0; i < MAX_COMPONENTS; i++) {
+			if (has_component(arch, i)) store.components[store.component_count++] = i;
+		}
+
+		memset(store.add_edges, 0, sizeof(store.add_edges));
+		memset(store.remove_edges, 0, sizeof(store.remove_edges));
+	}
+
+	//Adds a store whose blocks were filled elsewhere, such as when loading a scene.
+	//The ids in the blocks take their slots in the entity table.
+	void insert_archetype(Archetype arch, const ArchetypeStore& loaded) {
+		bool is_new = arches.index(arch) == -1;
+
+		ArchetypeStore& store = arches[arch];
+		store = loaded;
+		store.block_size = fitting_block_size(arch, loaded);
+		init_archetype_components(store, arch);
+
+		uint index = store_index(store);
+		if (is_new) archetype_indices.append(index);
+
+		uint count = store.entity_count_last_block;
+		for (BlockHeader* block = store.blocks; block; block = block->next) {
+			Entity* entities = (Entity*)(block + 1);
+			for (uint i = 0; i < count; i++) {
+				this->entities.claim_id(entities[i].id);
+				place(entities[i].id, index, block, i);
+			}
+			count = store.max_per_block;
+		}
+	}
+
 	ArchetypeStore& find_archetype(Archetype arch) {
 		int index = arches.index(arch);
 
@@ -254,23 +549,72 @@ struct World {
 		else return arches.values[index];
 	}
 
+	uint store_index(const ArchetypeStore& store) const {
+		return &store - arches.values;
+	}
+
+	//Index in arches of the archetype with component added or removed
+	uint archetype_edge(uint from, uint component, bool add) {
+		ArchetypeStore& store = arches.values[from];
+		uint* edges = add ? store.add_edges : store.remove_edges;
+
+		if (!edges[component]) {
+			Archetype arch = arches.keys[from];
+			Archetype to = add ? arch | (1ull << component) : arch & ~(1ull << component);
+			edges[component] = store_index(find_archetype(to)) + 1;
+		}
+
+		return edges[component] - 1;
+	}
+
+	//Records where the entity now lives
+	void place(ID id, uint store, BlockHeader* block, uint row) {
+		EntitySlot& slot = entities[entity_index(id)];
+		slot.block = block;
+		slot.store = store;
+		slot.row = row;
+	}
+
+	u8* component_in_block(const ArchetypeStore& store, BlockHeader* block, uint component, uint row) const {
+		return (u8*)(block + 1) + store.offsets[component] + row * component_size[component];
+	}
+
+	bool is_alive(ID id) const {
+		return entities.find(id) != nullptr;
+	}
+
+	//Null if the entity is not alive or doesn't have the component
+	void* component_ptr(uint component, ID id) const {
+		EntitySlot* slot = entities.find(id);
+		if (!slot || !has_component(arches.keys[slot->store], component)) return nullptr;
+
+		return component_in_block(arches.values[slot->store], slot->block, component, slot->row);
+	}
+
+	//Same as component_ptr, the block is marked as written since the component may be changed through the pointer
+	void* m_component_ptr(uint component, ID id) {
+		EntitySlot* slot = entities.find(id);
+		if (!slot || !has_component(arches.keys[slot->store], component)) return nullptr;
+
+		slot->block->versions[component] = change_version;
+		return component_in_block(arches.values[slot->store], slot->block, component, slot->row);
+	}
+
 	template<typename Component>
 	Component* get_component_ptr(u8* data, uint* offsets, uint offset) {
-		return (Component*)(data + offsets[type_id<Component>()]) + offset;
+		return (Component*)(data + offsets[component_id<Component>()]) + offset;
 	}
 
 	template<typename Component>
 	ref_tuple<Component> get_component(u8* data, uint* offsets, uint offset) {
-		return ((Component*)(data + offsets[type_id<Component>()]))[offset];
+		return ((Component*)(data + offsets[component_id<Component>()]))[offset];
 	}
 
 	template<typename Component>
-	ref_tuple<Component> init_component(u8* data, uint* offsets, uint offset, ID id) {
+	ref_tuple<Component> init_component(u8* data, uint* offsets, uint offset) {
 		Component* comp = get_component_ptr<Component>(data, offsets, offset);
 		new (comp) Component();
 
-		id_to_ptr[type_id<Component>()][id] = comp;
-
 		return *comp;
 	}
 
@@ -282,6 +626,7 @@ struct World {
 			store.entity_count_last_block = 1;
 		}
 
+		mark_written(store, store.blocks, ~0ull, change_version);
 		return offset;
 	}
 
@@ -298,14 +643,12 @@ struct World {
 
 		u8* data = last_block_data(store); //skip header
 
-		id_to_arch[id] = arch;
+		place(id, store_index(store), store.blocks, offset);
 
 		Entity& entity = *(Entity*)(data + offset * sizeof(Entity));
 		entity = {};
 		entity.id = id;
 
-		id_to_ptr[0][id] = &entity;
-
 		return entity;
 	}
 
@@ -321,40 +664,38 @@ struct World {
 
 		u8* data = last_block_data(store);
 
-		id_to_arch[id] = arch;
+		place(id, store_index(store), store.blocks, offset);
 
 		Entity& entity = *(Entity*)(data + sizeof(Entity) * offset);
 		entity = {};
 		entity.id = id;
 
-		id_to_ptr[0][id] = &entity;
-
 
 		//printf("MAKING ENTITY WITH ARCHETYPE %i, BASE %p, OFFSET %i, ENTITY %i\n", arch, data, offset, id);
 
-		return ref_tuple<Entity>(entity) + (init_component<Args>(data, store.offsets, offset, id) + ...);
+		return ref_tuple<Entity>(entity) + (init_component<Args>(data, store.offsets, offset) + ...);
 	}
 
 	template<typename T>
 	const T* by_id(ID id) const {
-		return (T*)id_to_ptr[type_id<T>()][id];
+		return (T*)component_ptr(component_id<T>(), id);
 	}
 
 	template<typename T>
 	T* m_by_id(ID id) {
-		return (T*)id_to_ptr[type_id<T>()][id];
+		return (T*)m_component_ptr(component_id<T>(), id);
 	}
 
 	template<typename T>
 	ref_tuple<T> ref_by_id(ID id) {
-		return ref_tuple<T>(*(T*)id_to_ptr[type_id<T>()][id]);
+		return ref_tuple<T>(*m_by_id<T>(id));
 	}
 
 	template<typename... Args>
 	maybe<ref_tuple<Args...>> get_by_id(ID id) {
 		Archetype arch = to_archetype<Args...>();
 
-		if ((id_to_arch[id] & arch) == arch) {
+		if ((arch_of_id(id) & arch) == arch) {
 			return maybe((ref_by_id<Args>(id) + ...));
 		}
 		else {
@@ -362,28 +703,22 @@ struct World {
 		}
 	}
 
-	Archetype arch_of_id(ID id) {
-		return id_to_arch[id];
+	//0 if the entity is not alive
+	Archetype arch_of_id(ID id) const {
+		EntitySlot* slot = entities.find(id);
+		return slot ? arches.keys[slot->store] : 0;
 	}
 
 	void free_now_by_id(ID id) {
 
 	}
 
-	ID pop_store(ArchetypeStore& store) {
-		Entity* data = (Entity*)(store.blocks + 1);
-		assert(store.entity_count_last_block != 0);
-		uint last_offset = --store.entity_count_last_block;
-
-		return data[last_offset].id;
-	}
-
 	void shrink_store_to_fit(ArchetypeStore& store) {
 		if (store.entity_count_last_block == 0) {
             BlockHeader* block = store.blocks;
             BlockHeader* previous_block = block->next;
 			if (previous_block) store.entity_count_last_block = store.max_per_block;
-				
+
             release_block(block);
 
             store.blocks = previous_block;
@@ -392,134 +727,171 @@ struct World {
 		}
 	}
 
-	void emplace_free_component(uint component_id, ID id, ID last_id, bool call_destructor) {
-		void* dst = id_to_ptr[component_id][id];
-		void* src = id_to_ptr[component_id][last_id];
+	//Moves the last entity of the store into the row left behind by an entity which moved out.
+	//Every component at the row must already have been moved elsewhere or destructed.
+	void fill_gap(uint index, BlockHeader* block, uint row) {
+		ArchetypeStore& store = arches.values[index];
+		assert(store.entity_count_last_block != 0);
+		removals++;
 
-		auto destructor = component_lifetime_funcs[component_id].destructor;
-		if (call_destructor && destructor) destructor(dst, 1);
+		BlockHeader* last_block = store.blocks;
+		uint last_row = --store.entity_count_last_block;
 
-        id_to_ptr[component_id][id] = 0;
-        if (id != last_id) {
-            memcpy(dst, src, component_size[component_id]);
+		if (block != last_block || row != last_row) {
+			ID last_id = ((Entity*)(last_block + 1))[last_row].id;
 
-            id_to_ptr[component_id][last_id] = dst;
-        }
-	}
+			for (uint i = 0; i < store.component_count; i++) {
+				uint component = store.components[i];
+				memcpy(component_in_block(store, block, component, row), component_in_block(store, last_block, component, last_row), component_size[component]);
+			}
 
-	void emplace_move_component(ArchetypeStore& store, uint component_id, ID id, ID last_id, uint offset, u8* data) {
-		uint size = component_size[component_id];
-        
-        void* ptr = id_to_ptr[component_id][id];
-        void* moving_to = data + store.offsets[component_id] + offset * size; //todo turn into function!
-        memcpy(moving_to, ptr, size);
-        id_to_ptr[component_id][id] = moving_to;
-        
-        if (id != last_id) {
-            void* last_element = id_to_ptr[component_id][last_id];
-            memcpy(ptr, last_element, size);
-            id_to_ptr[component_id][last_id] = ptr;
-        }
+			place(last_id, index, block, row);
+			mark_written(store, block, ~0ull, change_version);
+		}
+
+		shrink_store_to_fit(store);
 	}
 
-	void emplace_move_components(ArchetypeStore& store, Archetype arch, ID id, ID last_id) {
-		uint offset = store_make_space(store);
-		u8* data = last_block_data(store);
+	//Copies the listed components of the entity at slot into a new row of to, which is returned.
+	//The entity keeps its old row until fill_gap is called.
+	uint move_entity(const EntitySlot& slot, ArchetypeStore& to, const u8* components, uint component_count) {
+		ArchetypeStore& from = arches.values[slot.store];
+		uint row = store_make_space(to);
 
-		for (uint component_id = 0; component_id < MAX_COMPONENTS; component_id++) {
-			if ((1ull << component_id) & arch) emplace_move_component(store, component_id, id, last_id, offset, data);
+		for (uint i = 0; i < component_count; i++) {
+			uint component = components[i];
+			memcpy(component_in_block(to, to.blocks, component, row), component_in_block(from, slot.block, component, slot.row), component_size[component]);
 		}
+
+		return row;
 	}
 
 	//todo split into various edge cases: create all, delete all
+	//An entity moved to archetype 0 keeps its id, so it can be brought back by moving it out of 0 again
 	void change_archetype(ID id, Archetype from, Archetype to, bool call_lifetime = true) {
+		if (from == to) return;
+
 		ArchetypeStore* store = from > 0 ? &find_archetype(from) : nullptr;
 		ArchetypeStore* new_store = to > 0 ? &find_archetype(to) : nullptr;
-		ID last_id = store ? pop_store(*store) : 0;
-        
-        //printf("Destroying %i, moving %i in it's place\n", id, last_id);
+		EntitySlot old_slot = entities[entity_index(id)];
 
-		Archetype common = from & to;
-		Archetype removed = from & ~to;
-		Archetype added = to & ~from;
+		u8 kept[MAX_COMPONENTS];
+		uint kept_count = 0;
 
-		uint offset = new_store ? store_make_space(*new_store) : 0;
-		u8* data = new_store ? last_block_data(*new_store) : nullptr;
+		for (uint i = 0; store && i < store->component_count; i++) {
+			uint component = store->components[i];
+			if (has_component(to, component)) {
+				kept[kept_count++] = component;
+				continue;
+			}
 
-		if (new_store) {
-			assert(new_store->entity_count_last_block != 0);
-			//printf("ADDING ENTITY TO ARCHETYPE %ul count: %i\n", to, new_store ? new_store->entity_count_last_block : 0);
+			auto destructor = component_lifetime_funcs[component].destructor;
+			if (call_lifetime && destructor) destructor(component_in_block(*store, old_slot.block, component, old_slot.row), 1);
 		}
 
-		for (uint i = 0; i < MAX_COMPONENTS; i++) {
-			Archetype flag = 1ull << i;
+		uint row = 0;
+		if (new_store) row = store ? move_entity(old_slot, *new_store, kept, kept_count) : store_make_space(*new_store);
 
-			if (flag & common) emplace_move_component(*new_store, i, id, last_id, offset, data);
-			else if (flag & removed) emplace_free_component(i, id, last_id, call_lifetime);
-			else if (flag & added) {
-				//printf("MAKING ENTITY WITH ARCHETYPE %i, BASE %p, ENTITY %i\n", to, data, offset);
+		for (uint i = 0; new_store && i < new_store->component_count; i++) {
+			uint component = new_store->components[i];
+			if (has_component(from, component)) continue;
 
-				void* moving_to = data + new_store->offsets[i] + offset * component_size[i];
-				id_to_ptr[i][id] = moving_to;
+			//printf("MAKING ENTITY WITH ARCHETYPE %i, BASE %p, ENTITY %i\n", to, data, offset);
 
-				if (call_lifetime) {
-					auto constructor = component_lifetime_funcs[i];
-					component_lifetime_funcs[i].constructor(moving_to, 1);
-				}
-			}
+			void* moving_to = component_in_block(*new_store, new_store->blocks, component, row);
+
+			auto constructor = component_lifetime_funcs[component].constructor;
+			if (call_lifetime && constructor) constructor(moving_to, 1);
 		}
 
-		id_to_arch[id] = to;
-		if (store) shrink_store_to_fit(*store);
+		if (store) fill_gap(old_slot.store, old_slot.block, old_slot.row);
+
+		if (new_store) place(id, store_index(*new_store), new_store->blocks, row);
+		else entities[entity_index(id)].block = nullptr;
 	}
 
 	void free_by_id(ID id, bool call_destructor = true) { //todo handle id not existing!
-		Archetype arch = id_to_arch[id];
+		Archetype arch = arch_of_id(id);
 		assert(arch != 0);
 		change_archetype(id, arch, system_component_mask, call_destructor); //keep system components alive
-        free_ids.append(id);
+		entities.free_id(id);
 	}
 
-	template<typename T>
-	void free_by_id(ID id) { //todo handle id not existing!		
-		Archetype arch = id_to_arch[id];
-		ArchetypeStore& store = find_archetype(id_to_arch[id]);
-		ID last_id = pop_store(store);
+	//Moves the entity to the archetype without component, which must already have been destructed
+	void remove_component(ID id, uint component) {
+		EntitySlot slot = entities[entity_index(id)];
+		assert(is_alive(id) && has_component(arches.keys[slot.store], component));
 
-		const uint delete_component_id = type_id<T>();
-		Archetype new_arch = arch & ~(1ull << delete_component_id);
-		id_to_arch[id] = new_arch;
+		uint to = archetype_edge(slot.store, component, false);
+		ArchetypeStore& new_store = arches.values[to];
 
-		emplace_move_components(find_archetype(new_arch), new_arch, id, last_id);
+		uint row = move_entity(slot, new_store, new_store.components, new_store.component_count);
+		fill_gap(slot.store, slot.block, slot.row);
+		place(id, to, new_store.blocks, row);
+	}
 
-		((T*)id_to_ptr[delete_component_id][id])->~T();
-		emplace_free_component(delete_component_id, id, last_id, false);
+	//Moves the entity to the archetype with component, the returned component is left unconstructed
+	void* add_component(ID id, uint component) {
+		EntitySlot slot = entities[entity_index(id)];
+		assert(is_alive(id) && !has_component(arches.keys[slot.store], component));
 
-		id_to_arch[id] = new_arch;
-		shrink_store_to_fit(store);
+		uint to = archetype_edge(slot.store, component, true);
+		ArchetypeStore& store = arches.values[slot.store];
+		ArchetypeStore& new_store = arches.values[to];
+
+		uint row = move_entity(slot, new_store, store.components, store.component_count);
+		BlockHeader* block = new_store.blocks;
+
+		fill_gap(slot.store, slot.block, slot.row);
+		place(id, to, block, row);
+
+		return component_in_block(new_store, block, component, row);
+	}
+
+	template<typename T>
+	void free_by_id(ID id) { //todo handle id not existing!
+		const uint delete_component_id = component_id<T>();
+
+		((T*)component_ptr(delete_component_id, id))->~T();
+		remove_component(id, delete_component_id);
 	}
 
 	template<typename T>
 	T* add(ID id) { //todo handle id not existing!
-		Archetype arch = id_to_arch[id];
-		ArchetypeStore& store = find_archetype(id_to_arch[id]);
-		ID last_id = pop_store(store);
+		return new (add_component(id, component_id<T>())) T();
+	}
 
-		const uint add_component_id = type_id<T>();
-		Archetype new_arch = arch | (1ull << add_component_id);
-		id_to_arch[id] = new_arch;
+	//Creates count entities in the archetype at index, filling whole blocks at a time.
+	//The components are built with the registered constructors.
+	void make_many(uint index, const ID* ids, uint count) {
+		ArchetypeStore& store = arches.values[index];
 
-		ArchetypeStore& new_store = find_archetype(new_arch);
+		for (uint done = 0; done < count;) {
+			if (!store.blocks || store.entity_count_last_block >= store.max_per_block) add_block(store);
 
-		emplace_move_components(new_store, arch, id, last_id);
-		T* component = get_component_ptr<T>(last_block_data(new_store), new_store.offsets, new_store.entity_count_last_block - 1);
-		*component = T();
+			uint offset = store.entity_count_last_block;
+			uint n = min(count - done, store.max_per_block - offset);
+			u8* data = last_block_data(store);
 
-		id_to_arch[id] = new_arch;
-		id_to_ptr[add_component_id][id] = component;
-		shrink_store_to_fit(store);
+			for (uint i = 0; i < store.component_count; i++) {
+				uint component = store.components[i];
+				u8* components = data + store.offsets[component] + offset * component_size[component];
+
+				auto constructor = component_lifetime_funcs[component].constructor;
+				if (component != 0 && constructor) constructor(components, n);
+			}
 
-		return component;
+			Entity* entities = (Entity*)data + offset;
+			for (uint j = 0; j < n; j++) {
+				entities[j] = {};
+				entities[j].id = ids[done + j];
+				place(ids[done + j], index, store.blocks, offset + j);
+			}
+
+			mark_written(store, store.blocks, ~0ull, change_version);
+			store.entity_count_last_block += n;
+			done += n;
+		}
 	}
 
 	tvector<ComponentPtr> components_by_id(ID id, Archetype arch = ~0) {
@@ -530,42 +902,113 @@ struct World {
 		for (uint i = 0; i < MAX_COMPONENTS; i++) {
 			if (((1ull << i) & arch) == 0) continue;
 
-			components.append({ i, id_to_ptr[i][id] });
+			components.append({ i, component_ptr(i, id) });
 		}
 
 		return components;
 	}
 
+	//QUERIES
+	void update_query(Query& query, EntityQuery filter) {
+		if (query.world != this || query.world_epoch != epoch || query.filter != filter) {
+			query.filter = filter;
+			query.stores.clear();
+			query.archetypes_tested = 0;
+			query.world = this;
+			query.world_epoch = epoch;
+		}
+
+		for (; query.archetypes_tested < archetype_indices.length; query.archetypes_tested++) {
+			uint index = archetype_indices[query.archetypes_tested];
+			if (query_matches(filter, arches.keys[index])) query.stores.append(index);
+		}
+	}
+
+	//CHANGE TRACKING
+	//Writes during an iteration are stamped with the version it started at. A query with a changed filter
+	//then moves the version on, so next time it sees every write made after it started but not its own.
+	template<typename... Args>
+	ChangeTracking begin_tracking(Query* cached, EntityQuery query) {
+		ChangeTracking tracking;
+		tracking.written = write_archetype<Args...>() & ~1ull;
+		tracking.version = change_version;
+
+		if (query.changed) {
+			assert(cached); //the version a query last ran at is kept in the Query
+			tracking.changed = query.changed;
+			tracking.since = cached->changed_version;
+			cached->changed_version = change_version++;
+		}
+
+		return tracking;
+	}
+
+	bool block_changed(ArchetypeStore& store, BlockHeader* block, const ChangeTracking& tracking) {
+		if (!tracking.changed) return true;
+
+		for (uint i = 0; i < store.component_count; i++) {
+			uint component = store.components[i];
+			if (has_component(tracking.changed, component) && block->versions[component] > tracking.since) return true;
+		}
+
+		return false;
+	}
+
+	void mark_written(ArchetypeStore& store, BlockHeader* block, Archetype written, uint version) {
+		if (!written) return;
+
+		for (uint i = 0; i < store.component_count; i++) {
+			uint component = store.components[i];
+			if (has_component(written, component)) block->versions[component] = version;
+		}
+	}
+
 	template<typename... Args>
 	struct ComponentIterator {
 		World& world;
 		EntityQuery query;
+		ChangeTracking tracking;
+		const uint* matched; //stores of a cached query, otherwise every slot of arches is tested
+		uint store_count;
 		uint store_index;
 		uint entity_index = 0;
 
-		ComponentIterator(World& world, EntityQuery query) : world(world), query(query) {}
+		ComponentIterator(World& world, EntityQuery query, ChangeTracking tracking, const uint* matched, uint store_count) 
+		: world(world), query(query), tracking(tracking), matched(matched), store_count(store_count) {}
 
 		ArchetypeStore* store = NULL;
 		BlockHeader* block = NULL;
-		uint size_of_last_block;
+		uint size_of_last_block; //entities in block
 		u8* data;
 
-		void skip_archetype() {
+		//Moves on to the next block with entities that passes the change filter, going through the matching stores
+		void skip_blocks() {
 			auto& arches = world.arches;
 
-			while (store_index < ARCHETYPE_HASH) {
-				Archetype arch = arches.keys[store_index];
-				bool not_empty = arches.values[store_index].blocks;
+			while (store_index < store_count) {
+				if (!store) {
+					uint index = matched ? matched[store_index] : store_index;
 				
-				if (not_empty && (arch & query.all) == query.all && (query.some == 0 || (arch & query.some) != 0) && (arch & query.none) == 0) { // || !world.arches.values[store_index].blocks
-					store = &world.arches.values[store_index];
+					if (!matched && !(arches.is_full(index) && query_matches(query, arches.keys[index]))) {
+						store_index++;
+						continue;
+					}
+
+					store = &arches.values[index];
 					block = store->blocks;
 					size_of_last_block = store->entity_count_last_block;
-					data = (u8*)(block + 1);
+				}
 
-					break;
+				for (; block; block = block->next, size_of_last_block = store->max_per_block) {
+					if (size_of_last_block == 0 || !world.block_changed(*store, block, tracking)) continue;
+
+					world.mark_written(*store, block, tracking.written, tracking.version);
+					data = (u8*)(block + 1);
+					entity_index = 0;
+					return;
 				}
 
+				store = NULL;
 				store_index++;
 			}
 		}
@@ -573,14 +1016,8 @@ struct World {
 		void next() {
 			if (++entity_index >= size_of_last_block) {
 				block = block->next;
-				data = (u8*)(block + 1);
 				size_of_last_block = store->max_per_block;
-				entity_index = 0;
-
-				if (!block) {
-					store_index++;
-					skip_archetype();
-				}
+				skip_blocks();
 			}
 		}
 
@@ -612,6 +1049,9 @@ struct World {
 	struct ComponentFilter {
 		World& world;
 		EntityQuery query;
+		ChangeTracking tracking;
+		const uint* matched = nullptr;
+		uint store_count = ARCHETYPE_HASH;
 
 		ComponentFilter(World& world, EntityQuery query) : world(world), query(query) {
 			this->query.all |= to_archetype<Args...>();
@@ -620,17 +1060,26 @@ struct World {
 			assert((query.some & query.none) == 0);
 		}
 
+		ComponentFilter(World& world, Query& cached, EntityQuery query) : ComponentFilter(world, query) {
+			world.update_query(cached, this->query);
+			matched = cached.stores.data;
+			store_count = cached.stores.length;
+			tracking = world.begin_tracking<Args...>(&cached, this->query);
+		}
+
 		ComponentIterator<Args...> begin() {
-			ComponentIterator<Args...> it(world, query);
+			if (!matched) tracking = world.begin_tracking<Args...>(nullptr, query);
+
+			ComponentIterator<Args...> it(world, query, tracking, matched, store_count);
 			it.store_index = 0;
-			it.skip_archetype();
+			it.skip_blocks();
 			//it.skip_entities();
 			return it;
 		}
 
 		ComponentIterator<Args...> end() {
-			ComponentIterator<Args...> it(world, query);
-			it.store_index = ARCHETYPE_HASH;
+			ComponentIterator<Args...> it(world, query, tracking, matched, store_count);
+			it.store_index = store_count;
 			return it;
 		}
 	};
@@ -640,6 +1089,30 @@ struct World {
 		return ComponentFilter<Entity, Args...>(*this, query);
 	}
 
+	//Same as filter, but only visits the stores cached in query
+	template<typename... Args>
+	ComponentFilter<Entity, Args...> filter(Query& cached, EntityQuery query = EntityQuery()) {
+		return ComponentFilter<Entity, Args...>(*this, cached, query);
+	}
+
+	//Entities in the stores matching the query, without visiting them
+	uint count(Query& cached, EntityQuery query = EntityQuery()) {
+		update_query(cached, query);
+
+		uint count = 0;
+		for (uint index : cached.stores) {
+			ArchetypeStore& store = arches.values[index];
+			uint in_block = store.entity_count_last_block;
+
+			for (BlockHeader* block = store.blocks; block; block = block->next) {
+				count += in_block;
+				in_block = store.max_per_block;
+			}
+		}
+
+		return count;
+	}
+
 	template<typename... Args>
 	maybe<ref_tuple<Entity, Args...>> first(EntityQuery query = EntityQuery()) {
 		auto filter = ComponentFilter<Entity, Args...>(*this, query);
@@ -650,20 +1123,104 @@ struct World {
 		else return maybe(*begin);
 	}
 
-	void begin_frame() {
+	//CHUNK ITERATION
+	//Visits whole blocks instead of single entities, func is called as func(count, entities, components...)
+	//with one array per component. Components passed as const are only read.
+
+	//Blocks are marked as written when they are collected
+	void collect_store_chunks(ArchetypeStore& store, const ChangeTracking& tracking, vector<Chunk>& chunks) {
+		uint count = store.entity_count_last_block; //the first block is the one being filled
+
+		for (BlockHeader* block = store.blocks; block; block = block->next) {
+			if (count > 0 && block_changed(store, block, tracking)) {
+				mark_written(store, block, tracking.written, tracking.version);
+				chunks.append({ &store, block, count });
+			}
+			count = store.max_per_block;
+		}
+	}
+
+	template<typename... Args>
+	void collect_chunks(EntityQuery query, vector<Chunk>& chunks) {
+		ChangeTracking tracking = begin_tracking<Args...>(nullptr, query);
+
 		for (uint i = 0; i < ARCHETYPE_HASH; i++) {
-			if (!arches.is_full(i)) continue;
+			if (arches.is_full(i) && query_matches(query, arches.keys[i])) collect_store_chunks(arches.values[i], tracking, chunks);
+		}
+	}
 
-			ArchetypeStore& store = arches.values[i];
-			uint count = store.entity_count_last_block;
-			
-			/*EntityFlags zero_change_mask = ~(CREATED_THIS_FRAME | MODIFIED_THIS_FRAME | DESTROYED_THIS_FRAME);
+	template<typename... Args>
+	void collect_chunks(Query& cached, EntityQuery query, vector<Chunk>& chunks) {
+		update_query(cached, query);
+		ChangeTracking tracking = begin_tracking<Args...>(&cached, query);
+
+		for (uint index : cached.stores) collect_store_chunks(arches.values[index], tracking, chunks);
+	}
 
-			for (BlockHeader* header = store.blocks; header != nullptr; header = header->next) {
-				Entity* entities = (Entity*)(header + 1);
-				for (uint i = 0; i < count; i++) entities[i].flags &= zero_change_mask;
-				count = store.max_per_block;
-			}*/
+	template<typename T>
+	T* chunk_components(Chunk& chunk) {
+		return (T*)((u8*)(chunk.block + 1) + chunk.store->offsets[component_id<T>()]);
+	}
+
+	template<typename... Args, typename F>
+	void visit_chunks(slice<Chunk> chunks, F& func) {
+		for (Chunk& chunk : chunks) {
+			func(chunk.count, chunk_components<const Entity>(chunk), chunk_components<Args>(chunk)...);
 		}
 	}
+
+	template<typename... Args, typename F>
+	void parallel_visit_chunks(slice<Chunk> chunks, F& func, uint grain) {
+		parallel_for(0, chunks.length, grain, [&](uint begin, uint end) {
+			visit_chunks<Args...>({ chunks.data + begin, end - begin }, func);
+		});
+	}
+
+	//The chunk list lives on default_allocator, func or the parallel wait may switch fibers and resume on
+	//another worker, so a region of the temporary allocator can't be held across the visit
+	template<typename... Args, typename F>
+	void for_each_chunk(EntityQuery query, F&& func) {
+		vector<Chunk> chunks;
+		chunks.allocator = &default_allocator;
+		collect_chunks<Args...>(with_components<Args...>(query), chunks);
+		visit_chunks<Args...>(chunks, func);
+	}
+
+	template<typename... Args, typename F>
+	void for_each_chunk(Query& cached, EntityQuery query, F&& func) {
+		vector<Chunk> chunks;
+		chunks.allocator = &default_allocator;
+		collect_chunks<Args...>(cached, with_components<Args...>(query), chunks);
+		visit_chunks<Args...>(chunks, func);
+	}
+
+	//Hands out batches of grain chunks to the job system and blocks until every chunk has been visited.
+	//func runs concurrently, it must not create, destroy or add and remove components from entities,
+	//and only write the components of the chunk it was given.
+	template<typename... Args, typename F>
+	void parallel_for_each_chunk(EntityQuery query, F&& func, uint grain = 1) {
+		vector<Chunk> chunks;
+		chunks.allocator = &default_allocator;
+		collect_chunks<Args...>(with_components<Args...>(query), chunks);
+		parallel_visit_chunks<Args...>(chunks, func, grain);
+	}
+
+	template<typename... Args, typename F>
+	void parallel_for_each_chunk(Query& cached, EntityQuery query, F&& func, uint grain = 1) {
+		vector<Chunk> chunks;
+		chunks.allocator = &default_allocator;
+		collect_chunks<Args...>(cached, with_components<Args...>(query), chunks);
+		parallel_visit_chunks<Args...>(chunks, func, grain);
+	}
+
+	template<typename... Args>
+	static EntityQuery with_components(EntityQuery query) {
+		query.all |= to_archetype<Args...>();
+		return query;
+	}
+
+	//Versions don't need clearing, writes in a new frame just get a newer version
+	void begin_frame() {
+		change_version++;
+	}
 };
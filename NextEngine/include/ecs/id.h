@@ -1,6 +1,7 @@
 #pragma once
 
 #include "engine/core.h"
+#include "core/container/array.h"
 
 REFL using ID = uint;
 REFL using Layermask = u64;
@@ -9,13 +10,29 @@ REFL using EntityFlags = u64;
 using ComponentID = uint;
 
 constexpr uint MAX_COMPONENTS = 64;
-constexpr uint MAX_ENTITIES = 10000;
 constexpr uint ARCHETYPE_HASH = 103;
-constexpr uint BLOCK_SIZE = kb(8);
+constexpr uint BLOCK_SIZE = kb(8); //smallest block, larger ones are BLOCK_SIZE << size class
+constexpr uint BLOCK_SIZE_CLASSES = 4;
+constexpr uint MAX_BLOCK_SIZE = BLOCK_SIZE << (BLOCK_SIZE_CLASSES - 1);
+constexpr uint MIN_ENTITIES_PER_BLOCK = 32; //archetypes get larger blocks until this many fit
+constexpr uint BLOCK_CAPACITY_MULTIPLE = 8; //so loops 8 entities wide have no remainder in full blocks
+constexpr uint COLUMN_ALIGNMENT = 32; //columns start at least this aligned, for aligned SIMD loads
+constexpr uint MAX_COLUMN_ALIGNMENT = 64; //alignment of the component data in a block
 constexpr uint WORLD_SIZE = mb(50);
 
 const Archetype ANY_ARCHETYPE = ~0ull;
 
+//Ids pack the index of the entity's slot in World::entities with the slot's generation,
+//the top bit is left clear for the pending ids of command buffers. Index 0 is never used, so 0 is never an entity.
+//21 index bits allow 2M live entities, a slot is retired when its 10 bit generation would wrap, see EntityTable::free_id
+constexpr uint ENTITY_INDEX_BITS = 21;
+constexpr uint ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+constexpr uint ENTITY_GENERATION_MASK = 0x3ff;
+constexpr uint ENTITY_PAGE_SIZE = 1024;
+
+inline uint entity_index(ID id) { return id & ENTITY_INDEX_MASK; }
+inline uint entity_generation(ID id) { return (id >> ENTITY_INDEX_BITS) & ENTITY_GENERATION_MASK; }
+
 enum DirtyComponent {
 	DIRTY_COMPONENT = 1,
 	ADDED_COMPONENT = 2,
@@ -26,6 +43,7 @@ struct EntityQuery {
 	Archetype all = 0;
 	Archetype some = 0;
 	Archetype none = 0;
+	Archetype changed = 0; //only blocks where one of these was written since the Query last ran, see World::begin_tracking
 
 	template<typename... Args>
 	EntityQuery with_all(EntityFlags flags = 0);
@@ -35,6 +53,23 @@ struct EntityQuery {
 
 	template<typename... Args>
 	EntityQuery with_some(EntityFlags flags = 0);
+
+	template<typename... Args>
+	EntityQuery with_changed();
+
+	bool operator==(const EntityQuery& other) const { return all == other.all && some == other.some && none == other.none && changed == other.changed; }
+	bool operator!=(const EntityQuery& other) const { return !(*this == other); }
+};
+
+//Persistent query, remembers which archetype stores matched so iterating doesn't test every archetype again.
+//Only archetypes created since the last use are tested, the match list is rebuilt if the filter or world changes.
+struct Query {
+	EntityQuery filter;
+	array<ARCHETYPE_HASH, uint> stores; //indices into World::arches
+	uint archetypes_tested = 0;
+	const struct World* world = nullptr;
+	uint world_epoch = 0;
+	uint changed_version = 0; //version the query last ran at
 };
 
 
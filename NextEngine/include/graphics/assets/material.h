@@ -85,6 +85,6 @@ struct Materials {
 	array<8, material_handle> materials;
 };
 
-ENGINE_API material_handle mat_by_index(Materials&, uint material_id);
+ENGINE_API material_handle mat_by_index(const Materials&, uint material_id);
 material_handle make_SubstanceMaterial(string_view folder, string_view);
 
@@ -17,7 +17,7 @@ void copy_into_node(Node& node, T* to, T* from) {
 }
 
 inline Node& alloc_node(Partition& scene_partition) {
-	assert(scene_partition.count <= MAX_MESH_INSTANCES);
+	assert(scene_partition.node_count < MAX_NODES);
 
 	uint offset = ++scene_partition.node_count - 1;
 	Node& node = scene_partition.nodes[offset];
@@ -16,10 +16,13 @@ struct ModelRendererSystem;
 struct Viewport;
 
 ENGINE_API void build_acceleration_structure(ScenePartition& scene_partition, hash_set<MeshBucket, MAX_MESH_BUCKETS>& mesh_buckets, World& world);
-ENGINE_API void update_acceleration_structure(ScenePartition& scene_partition, hash_set<MeshBucket, MAX_MESH_BUCKETS>& mesh_buckets, World& world);
+
+//Rebuilds or refits the static hierarchy when static entities changed and updates the dynamic one with the
+//entities in layermask that changed, call once a frame before culling
+ENGINE_API void update_acceleration_structure(ScenePartition& scene_partition, hash_set<MeshBucket, MAX_MESH_BUCKETS>& mesh_buckets, World& world, EntityQuery layermask = EntityQuery());
 
 void render_debug_bvh(ScenePartition& scene_partition, RenderPass&);
 
 using MeshBuckets = hash_set<MeshBucket, MAX_MESH_BUCKETS>;
 
-void cull_meshes(const ScenePartition& scene_partition, World& world, MeshBuckets& buckets, uint viewport_count, CulledMeshBucket** culled_mesh_bucket, Viewport viewports[], EntityQuery query);
+void cull_meshes(const ScenePartition& scene_partition, uint viewport_count, CulledMeshBucket** culled_mesh_bucket, Viewport viewports[]);
@@ -2,10 +2,16 @@
 
 #include "engine/core.h"
 #include "core/math/aabb.h"
+#include "core/math/bvh.h"
+#include "core/math/aabb_batch.h"
+#include "core/math/dynamic_bvh.h"
+#include "core/container/vector.h"
+#include "ecs/id.h"
+#include <glm/mat4x4.hpp>
 #include <atomic>
 
+//Fixed size partition built by median splits, still used by editor picking which saves it as raw bytes
 #define MAX_NODES 500
-#define MAX_MESH_INSTANCES 10000
 
 struct Node {
 	AABB aabb;
@@ -21,8 +27,77 @@ struct Partition {
 	Node nodes[MAX_NODES];
 };
 
-struct ScenePartition : Partition {
-	AABB aabbs[MAX_MESH_INSTANCES];
-	int meshes[MAX_MESH_INSTANCES];
-	glm::mat4 model_m[MAX_MESH_INSTANCES];
-};
\ No newline at end of file
+//A mesh of an entity without the STATIC flag, the instances of an entity are linked through next
+struct DynamicMeshInstance {
+	ID entity;
+	uint leaf; //in DynamicPartition::bvh
+	uint next; //DYNAMIC_BVH_NULL for the last instance of the entity
+	int mesh;
+	AABB aabb;
+	glm::mat4 model_m;
+};
+
+//Mesh instances of moving entities in a dynamic BVH, see core/math/dynamic_bvh.h.
+//Only entities whose Transform, ModelRenderer or Materials changed since the last update are visited,
+//and the instances are checked for destroyed entities only when the world removed some.
+struct DynamicPartition {
+	DynamicBVH bvh;
+	vector<DynamicMeshInstance> instances;
+	vector<uint> free_instances;
+	vector<uint> entity_instances; //first instance by entity index, DYNAMIC_BVH_NULL if it has none
+	uint instance_count = 0;
+
+	Query changed;
+	EntityQuery query; //the entities the tree was built from
+	const struct World* world = nullptr;
+	uint world_epoch = 0;
+	uint world_removals = 0;
+
+	DynamicPartition() {
+		instances.allocator = &default_allocator;
+		free_instances.allocator = &default_allocator;
+		entity_instances.allocator = &default_allocator;
+	}
+};
+
+//Instances of a static entity, the leaf order index of each is in ScenePartition::instance_slots
+struct StaticEntityInstances {
+	ID entity;
+	uint first;
+	uint count;
+};
+
+//Static mesh instances in a SAH bounding volume hierarchy, see core/math/bvh.h.
+//The instance arrays are stored in leaf order, a leaf's instances are [offset, offset + count).
+//The hierarchy is rebuilt when a static entity is added or removed or its ModelRenderer or Materials are
+//written to. Writing only its Transform moves its instances and refits the hierarchy.
+struct ScenePartition {
+	BVH bvh;
+	vector<AABB> aabbs;
+	vector<int> meshes;
+	vector<glm::mat4> model_m;
+	vector<float> aabb_floats;
+	AABBArrays aabb_arrays = {}; //aabbs as arrays for the batched culling, points into aabb_floats
+
+	vector<StaticEntityInstances> entity_instances; //by entity index, count is 0 for entities without instances
+	vector<uint> instance_slots; //leaf order index of the instances in the order they were built
+
+	Query static_changed; //ModelRenderer and Materials writes
+	Query static_moved; //Transform writes
+	Query static_entities;
+	uint static_count = 0; //entities the hierarchy was built from
+	const struct World* world = nullptr;
+	uint world_epoch = 0;
+	uint world_removals = 0;
+
+	DynamicPartition dynamic;
+
+	ScenePartition() {
+		aabbs.allocator = &default_allocator;
+		meshes.allocator = &default_allocator;
+		model_m.allocator = &default_allocator;
+		aabb_floats.allocator = &default_allocator;
+		entity_instances.allocator = &default_allocator;
+		instance_slots.allocator = &default_allocator;
+	}
+};
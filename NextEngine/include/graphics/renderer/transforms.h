@@ -3,4 +3,8 @@
 #include <glm/mat4x4.hpp>
 #include "ecs/id.h"
 
-void ENGINE_API compute_model_matrices(glm::mat4* model_m, struct World& world, EntityQuery mask);
\ No newline at end of file
+//Transforms are split into arrays this many at a time, small enough to stay on the stack
+constexpr uint MODEL_MATRIX_BATCH = 64;
+
+//Same matrices as compute_model_matrix, the transforms are split into arrays for the SIMD path in core/math/model_matrices.h
+void ENGINE_API compute_model_matrices(glm::mat4* model_m, const struct Transform* transforms, uint count);
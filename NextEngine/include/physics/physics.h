@@ -52,6 +52,7 @@ SYSTEM_COMP struct BtRigidBodyPtr {
 
 struct PhysicsSystem {
 	struct BulletWrapper* bt_wrapper;
+	Query synced_bodies;
 
 	PhysicsSystem();
 	void init(struct World&);
@@ -7,6 +7,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/simd/matrix.h>
 #include "ecs/ecs.h"
+#include "ecs/system.h"
+#include "core/job_system/job.h"
 
 glm::mat4 compute_model_matrix(const Transform& trans) {
 	glm::mat4 identity(1.0);
@@ -29,10 +31,210 @@ void calc_global_transform(World& world, ID id) {
 	calc_global_transform(world, local, trans);
 }
 
-//todo more efficient system would be to store local transforms by depth, and calculate each level independently
-//parrelises nicely too!
+//HIERARCHY
+static bool written_since(World& world, ID id, uint component, uint since) {
+	EntitySlot* slot = world.entities.find(id);
+	return slot && slot->block->versions[component] > since;
+}
+
+//Only blocks with LocalTransforms written since the last update can have new owners or new children,
+//children that were removed show up as a different count
+static bool hierarchy_changed(TransformHierarchy& hierarchy, World& world, EntityQuery query) {
+	if (hierarchy.world != &world || hierarchy.world_epoch != world.epoch || hierarchy.query != query) return true;
+	if (world.change_version <= hierarchy.version) return true; //another world now lives at the same address
+
+	vector<Chunk> chunks;
+	chunks.allocator = &default_allocator;
+	world.collect_chunks<const LocalTransform, const Transform>(World::with_components<LocalTransform, Transform>(query), chunks);
+
+	uint local_id = component_id<LocalTransform>();
+	uint count = 0;
+
+	for (Chunk& chunk : chunks) {
+		count += chunk.count;
+		if (chunk.block->versions[local_id] <= hierarchy.version) continue;
+
+		const Entity* entities = world.chunk_components<const Entity>(chunk);
+		const LocalTransform* locals = world.chunk_components<const LocalTransform>(chunk);
+
+		for (uint i = 0; i < chunk.count; i++) {
+			uint index = entity_index(entities[i].id);
+			if (index >= hierarchy.node_of.length || hierarchy.node_of[index] == NO_TRANSFORM_NODE) return true;
+
+			TransformNode& node = hierarchy.nodes[hierarchy.node_of[index]];
+			if (node.id != entities[i].id || node.owner != locals[i].owner) return true;
+		}
+	}
+
+	return count != hierarchy.nodes.length;
+}
+
+TransformHierarchy::TransformHierarchy() {
+	nodes.allocator = &default_allocator;
+	levels.allocator = &default_allocator;
+	node_of.allocator = &default_allocator;
+	transforms.allocator = &default_allocator;
+	changed.allocator = &default_allocator;
+	locals.allocator = &default_allocator;
+	owners.allocator = &default_allocator;
+}
+
+void TransformHierarchy::rebuild(World& world, EntityQuery query) {
+	LinearRegion region(get_temporary_allocator());
+
+	this->world = &world;
+	world_epoch = world.epoch;
+	this->query = query;
+
+	tvector<TransformNode> found;
+	for (auto [e, local, trans] : world.filter<const LocalTransform, const Transform>(query)) {
+		found.append({ e.id, local.owner, NO_TRANSFORM_NODE });
+	}
+
+	uint count = found.length;
+
+	node_of.clear();
+	node_of.resize(world.entities.next_index);
+	for (uint& node : node_of) node = NO_TRANSFORM_NODE;
+	for (uint i = 0; i < count; i++) node_of[entity_index(found[i].id)] = i;
+
+	for (TransformNode& node : found) {
+		uint index = entity_index(node.owner);
+		if (index < node_of.length && node_of[index] != NO_TRANSFORM_NODE && found[node_of[index]].id == node.owner) {
+			node.parent = node_of[index];
+		}
+	}
+
+	//DEPTH
+	//Walks up to the first node with a known depth, then assigns depths on the way back down.
+	//An owner cycle is cut at the last node walked, which keeps its own transform, so it can't hang the update.
+	const uint VISITING = NO_TRANSFORM_NODE - 1;
+	uint* depths = TEMPORARY_ARRAY(uint, count);
+	uint* path = TEMPORARY_ARRAY(uint, count);
+	for (uint i = 0; i < count; i++) depths[i] = NO_TRANSFORM_NODE;
+
+	uint max_depth = 0;
+
+	for (uint i = 0; i < count; i++) {
+		uint length = 0;
+		uint node = i;
+		while (node != NO_TRANSFORM_NODE && depths[node] == NO_TRANSFORM_NODE) {
+			depths[node] = VISITING;
+			path[length++] = node;
+			node = found[node].parent;
+		}
+
+		uint depth = 0;
+		if (node != NO_TRANSFORM_NODE && depths[node] == VISITING) found[path[length - 1]].parent = path[length - 1];
+		else if (node != NO_TRANSFORM_NODE) depth = depths[node] + 1;
+
+		for (uint j = length; j-- > 0;) depths[path[j]] = depth++;
+		if (length > 0) max_depth = max(max_depth, depth - 1);
+	}
+
+	//BUCKET BY DEPTH
+	//Counting sort, nodes of a level stay in iteration order, so they mostly follow the blocks
+	levels.clear();
+	levels.resize(count > 0 ? max_depth + 2 : 1);
+	for (uint i = 0; i < count; i++) levels[depths[i] + 1]++;
+	for (uint i = 1; i < levels.length; i++) levels[i] += levels[i - 1];
+
+	uint* order = TEMPORARY_ARRAY(uint, count);
+	uint* next = TEMPORARY_ARRAY(uint, levels.length);
+	for (uint i = 0; i < levels.length; i++) next[i] = levels[i];
+	for (uint i = 0; i < count; i++) order[i] = next[depths[i]]++;
+
+	nodes.resize(count);
+	transforms.resize(count);
+	changed.resize(count);
+	locals.resize(count);
+	owners.resize(count);
+
+	for (uint i = 0; i < count; i++) {
+		TransformNode node = found[i];
+		if (node.parent != NO_TRANSFORM_NODE) node.parent = order[node.parent];
+
+		nodes[order[i]] = node;
+		node_of[entity_index(node.id)] = order[i];
+
+		//Nodes without an owner keep their own transform
+		transforms[order[i]] = *world.by_id<Transform>(node.id);
+	}
+}
+
+void TransformHierarchy::propagate(World& world, bool all) {
+	uint since = version;
+	version = world.change_version++;
+
+	uint local_id = component_id<LocalTransform>();
+	uint trans_id = component_id<Transform>();
+
+	//Each level only reads the one above, which is done by the time it starts
+	for (uint level = 0; level + 1 < levels.length; level++) {
+		parallel_for(levels[level], levels[level + 1], 64, [&](uint begin, uint end) {
+			for (uint i = begin; i < end; i++) {
+				TransformNode& node = nodes[i];
+				const Transform* owner_trans = nullptr;
+				bool owner_changed = false;
+
+				if (node.parent == i) {}
+				else if (node.parent != NO_TRANSFORM_NODE) {
+					owner_trans = &transforms[node.parent];
+					owner_changed = changed[node.parent];
+				}
+				else {
+					owner_trans = world.by_id<Transform>(node.owner);
+					owner_changed = owner_trans && written_since(world, node.owner, trans_id, since) && memcmp(owner_trans, &owners[i], sizeof(Transform)) != 0;
+				}
+
+				const LocalTransform& local = *world.by_id<LocalTransform>(node.id);
+				bool local_changed = written_since(world, node.id, local_id, since) && memcmp(&local, &locals[i], sizeof(LocalTransform)) != 0;
+
+				//A Transform written elsewhere is overwritten again, as if every node were propagated each update
+				Transform* current = (Transform*)world.component_ptr(trans_id, node.id);
+				bool overwritten = written_since(world, node.id, trans_id, since) && memcmp(current, &transforms[i], sizeof(Transform)) != 0;
+
+				changed[i] = owner_trans && (all || owner_changed || local_changed || overwritten);
+				if (!changed[i]) continue;
+
+				locals[i] = local;
+				if (node.parent == NO_TRANSFORM_NODE) owners[i] = *owner_trans;
+
+				Transform& trans = transforms[i];
+				trans.scale = owner_trans->scale * local.scale;
+				trans.rotation = owner_trans->rotation * local.rotation;
+				trans.position = owner_trans->position + owner_trans->rotation * local.position;
+				*current = trans;
+			}
+		});
+	}
+
+	//Block versions are marked afterwards, jobs sharing a block would race on them
+	for (uint i = 0; i < nodes.length; i++) {
+		if (changed[i]) world.m_component_ptr(trans_id, nodes[i].id);
+	}
+}
+
+void TransformHierarchy::update(World& world, UpdateCtx& params) {
+	bool rebuild_nodes = hierarchy_changed(*this, world, params.layermask);
+	if (rebuild_nodes) rebuild(world, params.layermask);
+	propagate(world, rebuild_nodes);
+}
+
+//One hierarchy per world, so switching between worlds doesn't rebuild them
 void update_local_transforms(World& world, UpdateCtx& params) {
-	for (auto [e, local, trans] : world.filter<LocalTransform, Transform>(params.layermask)) {
-		calc_global_transform(world, local, trans);
+	static vector<TransformHierarchy*> hierarchies;
+	hierarchies.allocator = &default_allocator;
+
+	TransformHierarchy* hierarchy = nullptr;
+	for (TransformHierarchy* cached : hierarchies) {
+		if (cached->world == &world) hierarchy = cached;
 	}
+
+	if (!hierarchy) {
+		hierarchy = new TransformHierarchy();
+		hierarchies.append(hierarchy);
+	}
+
+	hierarchy->update(world, params);
 }
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include "ecs/command_buffer.h"
+#include "core/container/sort.h"
+
+EntityCommandBuffer::~EntityCommandBuffer() {
+	clear();
+	for (u8* chunk : chunks) default_allocator.deallocate(chunk);
+}
+
+void* EntityCommandBuffer::alloc_payload(u64 size, uint alignment) {
+	//Aligned by address, the allocator only guarantees the alignment of malloc
+	if (chunk_count > 0) {
+		u64 base = (u64)chunks[chunk_count - 1];
+		u64 begin = align_offset(base + chunk_used, alignment);
+
+		if (begin + size <= base + COMMAND_PAYLOAD_CHUNK_SIZE) {
+			chunk_used = begin + size - base;
+			return (void*)begin;
+		}
+	}
+
+	if (size + alignment > COMMAND_PAYLOAD_CHUNK_SIZE) {
+		u8* memory = (u8*)default_allocator.allocate(size + alignment);
+		large_payloads.append(memory);
+		return (void*)align_offset((u64)memory, alignment);
+	}
+
+	if (chunk_count == chunks.length) chunks.append((u8*)default_allocator.allocate(COMMAND_PAYLOAD_CHUNK_SIZE));
+	chunk_count++;
+
+	u64 base = (u64)chunks[chunk_count - 1];
+	u64 begin = align_offset(base, alignment);
+	chunk_used = begin + size - base;
+	return (void*)begin;
+}
+
+void EntityCommandBuffer::release_payloads() {
+	for (u8* memory : large_payloads) default_allocator.deallocate(memory);
+	large_payloads.clear();
+	chunk_count = 0;
+	chunk_used = 0;
+}
+
+void EntityCommandBuffer::clear() {
+	for (EntityCommand& command : commands) {
+		if (command.type == ADD_COMPONENT_COMMAND) command.ops->destruct(command.payload);
+	}
+
+	commands.clear();
+	release_payloads();
+	made.clear();
+	made_ids.clear();
+}
+
+struct CommandRef {
+	EntityCommandBuffer* buffer;
+	EntityCommand* command;
+};
+
+static ID resolve_id(EntityCommandBuffer& buffer, ID id) {
+	return id & PENDING_ID_BIT ? buffer.made_ids[id & ~PENDING_ID_BIT] : id;
+}
+
+//Commands on a pending id change the archetype it is made with, so the entity is only moved once
+static void fold_into_make(CommandRef ref) {
+	EntityCommandBuffer& buffer = *ref.buffer;
+	EntityCommand& command = *ref.command;
+
+	EntityCommand& make = buffer.commands[buffer.made[command.id & ~PENDING_ID_BIT]];
+	if (command.type == ADD_COMPONENT_COMMAND) make.arch |= 1ull << command.component;
+	if (command.type == REMOVE_COMPONENT_COMMAND) make.arch &= ~(1ull << command.component);
+}
+
+static void make_entities(World& world, CommandRef* refs, uint count) {
+	uint made = 0;
+	for (uint i = 0; i < count; i++) {
+		if (refs[i].command->type == MAKE_ENTITY_COMMAND) made++;
+	}
+	if (made == 0) return;
+
+	uint* stores = TEMPORARY_ARRAY(uint, made);
+	ID* ids = TEMPORARY_ARRAY(ID, made);
+
+	//ids are handed out in sort key order
+	uint index = 0;
+	for (uint i = 0; i < count; i++) {
+		EntityCommandBuffer& buffer = *refs[i].buffer;
+		EntityCommand& command = *refs[i].command;
+		if (command.type != MAKE_ENTITY_COMMAND) continue;
+
+		ID id = world.make_id();
+		buffer.made_ids[command.id & ~PENDING_ID_BIT] = id;
+
+		stores[index] = world.store_index(world.find_archetype(command.arch));
+		ids[index] = id;
+		index++;
+	}
+
+	radix_sort(stores, ids, made);
+
+	for (uint begin = 0; begin < made;) {
+		uint end = begin + 1;
+		while (end < made && stores[end] == stores[begin]) end++;
+
+		world.make_many(stores[begin], ids + begin, end - begin);
+		begin = end;
+	}
+}
+
+static void run_command(World& world, CommandRef ref) {
+	EntityCommandBuffer& buffer = *ref.buffer;
+	EntityCommand& command = *ref.command;
+
+	ID id = resolve_id(buffer, command.id);
+	bool alive = world.is_alive(id);
+	bool has = alive && has_component(world.arch_of_id(id), command.component);
+
+	switch (command.type) {
+	case MAKE_ENTITY_COMMAND:
+		break;
+
+	case FREE_ENTITY_COMMAND:
+		if (alive) world.free_by_id(id);
+		break;
+
+	case ADD_COMPONENT_COMMAND: {
+		void* value = command.payload;
+		void* ptr = nullptr;
+		bool pending = command.id & PENDING_ID_BIT;
+
+		if (has) {
+			ptr = world.component_ptr(command.component, id);
+
+			//make_many only constructed the component if it has a registered constructor,
+			//otherwise it's raw memory until the first add command on the made entity
+			Archetype bit = 1ull << command.component;
+			EntityCommand* make = pending ? &buffer.commands[buffer.made[command.id & ~PENDING_ID_BIT]] : nullptr;
+			bool constructed = !make || (make->assigned & bit) || world.component_lifetime_funcs[command.component].constructor;
+
+			if (constructed) command.ops->destruct(ptr);
+			if (make) make->assigned |= bit;
+		}
+		else if (alive && !pending) {
+			ptr = world.add_component(id, command.component);
+		}
+
+		//Pending entities without the component had it removed again before being made
+		if (ptr) command.ops->move_construct(ptr, value);
+		else command.ops->destruct(value);
+		break;
+	}
+
+	case REMOVE_COMPONENT_COMMAND:
+		if (has && !(command.id & PENDING_ID_BIT)) {
+			command.ops->destruct(world.component_ptr(command.component, id));
+			world.remove_component(id, command.component);
+		}
+		break;
+	}
+}
+
+void playback(World& world, slice<EntityCommandBuffer*> buffers) {
+	LinearRegion region(get_temporary_allocator());
+
+	uint count = 0;
+	for (EntityCommandBuffer* buffer : buffers) {
+		count += buffer->commands.length;
+		buffer->made_ids.resize(buffer->made.length);
+	}
+
+	if (count == 0) return;
+
+	//Stable sort by key, ties stay in buffer then recording order
+	uint* keys = TEMPORARY_ARRAY(uint, count);
+	CommandRef* refs = TEMPORARY_ARRAY(CommandRef, count);
+
+	uint index = 0;
+	for (EntityCommandBuffer* buffer : buffers) {
+		for (EntityCommand& command : buffer->commands) {
+			keys[index] = command.sort_key;
+			refs[index] = { buffer, &command };
+			index++;
+		}
+	}
+
+	radix_sort(keys, refs, count);
+
+	for (uint i = 0; i < count; i++) {
+		EntityCommand& command = *refs[i].command;
+		if (command.type != MAKE_ENTITY_COMMAND && command.id & PENDING_ID_BIT) fold_into_make(refs[i]);
+	}
+
+	make_entities(world, refs, count);
+
+	for (uint i = 0; i < count; i++) run_command(world, refs[i]);
+
+	//Every payload was moved or destructed by run_command
+	for (EntityCommandBuffer* buffer : buffers) {
+		buffer->commands.clear();
+		buffer->release_payloads();
+		buffer->made.clear();
+		buffer->made_ids.clear();
+	}
+}
+
+void playback(World& world, EntityCommandBuffers& buffers) {
+	EntityCommandBuffer* pointers[MAX_THREADS];
+	uint count = 0;
+
+	for (EntityCommandBuffer& buffer : buffers.buffers) {
+		if (!buffer.empty()) pointers[count++] = &buffer;
+	}
+
+	playback(world, { pointers, count });
+}
+
+void playback(World& world, EntityCommandBuffer& buffer) {
+	EntityCommandBuffer* pointer = &buffer;
+	playback(world, { &pointer, 1 });
+}
@@ -92,6 +92,7 @@ void World::register_components(slice<struct RegisterComponent> components) {
         
         component_lifetime_funcs[component_id] = component.funcs;
         component_size[component_id] = component.type->size;
+        component_alignment[component_id] = component.alignment;
         component_type[component_id] = (refl::Struct*)deep_copy(component.type, copied_type);
         component_kind[component_id] = component.kind;
     }
@@ -157,9 +158,11 @@ void World::register_components(slice<struct RegisterComponent> components) {
                         }
                     }
                     
-                    for (uint i = 0; i < count; i++) {
-                        id_to_ptr[comp][i] = dst_component_data + i * size;
-                    }
+                }
+                
+                Entity* entities = (Entity*)dst_data + dst_entity_offset;
+                for (uint i = 0; i < count; i++) {
+                    place(entities[i].id, store_index(*new_store), copy_to, dst_entity_offset + i);
                 }
                 
                 entity_offset += count;
@@ -180,7 +183,7 @@ void World::register_components(slice<struct RegisterComponent> components) {
                 if (dst_entity_offset == entity_count) {
                     dst_entity_offset = 0;
                     
-                    BlockHeader* new_block = get_block();
+                    BlockHeader* new_block = get_block(new_store->block_size);
                     new_block->next = copy_to;
                     copy_to = new_block;
                 }
@@ -200,17 +203,18 @@ void World::register_components(slice<struct RegisterComponent> components) {
 }
 
 World& World::operator=(const World& from) {
-    memcpy(id_to_arch, from.id_to_arch, sizeof(id_to_arch));
     memcpy(component_type, from.component_type, sizeof(component_type));
     memcpy(component_size, from.component_size, sizeof(component_size));
+    memcpy(component_alignment, from.component_alignment, sizeof(component_alignment));
     memcpy(component_lifetime_funcs, from.component_lifetime_funcs, sizeof(component_lifetime_funcs));
     memcpy(&arches, &from.arches, sizeof(arches));
-    memcpy(&free_ids, &from.free_ids, sizeof(free_ids));
+    archetype_indices = from.archetype_indices;
+    epoch++;
 
     //CLEAR
-    memset(id_to_ptr, 0, sizeof(id_to_ptr));
-    world_memory_offset = 0;
-    block_free_list = nullptr;
+    clear();
+    memset(block_free_list, 0, sizeof(block_free_list));
+    entities = from.entities; //the blocks are pointed at the copies below
 
     //COPY ARCHETYPES
     //todo replace 103 with constant
@@ -224,7 +228,7 @@ World& World::operator=(const World& from) {
         BlockHeader* from_header = from_arch_store.blocks;
         if (!from_header) continue;
         
-        BlockHeader* header = get_block();
+        BlockHeader* header = get_block(from_arch_store.block_size);
         arch_store.blocks = header;
 
         uint entity_count = from_arch_store.entity_count_last_block;
@@ -244,18 +248,17 @@ World& World::operator=(const World& from) {
                 auto copy = component_lifetime_funcs[component].copy;
                 if (copy) copy(components, from_components, entity_count);
                 else memcpy(components, from_components, size * entity_count);
+            }
 
-                Entity* entities = (Entity*)data;
-                for (uint entity = 0; entity < entity_count; entity++) {
-                    ID id = entities[entity].id;
-                    id_to_ptr[component][id] = components + entity * size;
-                }
+            Entity* entities = (Entity*)data;
+            for (uint entity = 0; entity < entity_count; entity++) {
+                this->entities[entity_index(entities[entity].id)].block = header;
             }
 
             from_header = from_header->next;
             if (!from_header) break;
             
-            header->next = get_block();
+            header->next = get_block(from_arch_store.block_size);
             header = header->next;
             entity_count = max_per_block;
         }
@@ -276,17 +279,16 @@ ID World::clone(ID id) {
     for (uint i = 0; i < MAX_COMPONENTS; i++) {
         if (!has_component(arch, i)) continue;
         
-        u8* src = (u8*)id_to_ptr[i][id];
+        u8* src = (u8*)component_ptr(i, id);
         u8* dst = data + store.offsets[i] + component_size[i] * offset;
         
         auto func = component_lifetime_funcs[i].copy;
         if (func) func(dst, src, 1);
         else memcpy(dst, src, component_size[i]);
-        
-        id_to_ptr[i][new_id] = dst;
     }
     
-    id_to_arch[new_id] = arch;
+    ((Entity*)data)[offset].id = new_id;
+    place(new_id, store_index(store), store.blocks, offset);
     
     return new_id;
 }
@@ -6,6 +6,7 @@
 #include "engine/vfs.h"
 #include "graphics/rhi/buffer.h"
 #include "core/memory/linear_allocator.h"
+#include "core/memory/memory_tracking.h"
 #include "ecs/ecs.h"
 #include "graphics/assets/assets.h"
 #include "core/time.h"
@@ -112,8 +113,15 @@ void Modules::begin_frame() {
 	time->tick();
 }
 
+//Memory a frame's temporary allocations may keep committed, anything a spike committed above is released
+constexpr u64 TEMPORARY_HIGH_WATER = mb(32);
+
 void clear_temporary(void*) {
-	get_thread_local_temporary_allocator().clear();
+	LinearAllocator& allocator = get_thread_local_temporary_allocator();
+	record_temporary_peak(allocator.peak);
+	allocator.peak = 0;
+	allocator.clear();
+	allocator.trim(TEMPORARY_HIGH_WATER);
 }
 
 void Modules::end_frame() {
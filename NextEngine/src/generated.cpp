@@ -1136,30 +1136,39 @@ void register_default_components(World& world) {
     struct RegisterComponent components[25] = {};
     components[0].component_id = 1;
     components[0].type = get_Transform_type();
+    components[0].alignment = alignof(Transform);
     components[0].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((Transform*)data + i) Transform(); };
     components[1].component_id = 2;
     components[1].type = get_StaticTransform_type();
+    components[1].alignment = alignof(StaticTransform);
     components[1].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((StaticTransform*)data + i) StaticTransform(); };
     components[2].component_id = 3;
     components[2].type = get_LocalTransform_type();
+    components[2].alignment = alignof(LocalTransform);
     components[2].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((LocalTransform*)data + i) LocalTransform(); };
     components[3].component_id = 4;
     components[3].type = get_Camera_type();
+    components[3].alignment = alignof(Camera);
     components[3].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((Camera*)data + i) Camera(); };
     components[4].component_id = 5;
     components[4].type = get_Flyover_type();
+    components[4].alignment = alignof(Flyover);
     components[4].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((Flyover*)data + i) Flyover(); };
     components[5].component_id = 6;
     components[5].type = get_Skybox_type();
+    components[5].alignment = alignof(Skybox);
     components[5].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((Skybox*)data + i) Skybox(); };
     components[6].component_id = 7;
     components[6].type = get_TerrainControlPoint_type();
+    components[6].alignment = alignof(TerrainControlPoint);
     components[6].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((TerrainControlPoint*)data + i) TerrainControlPoint(); };
     components[7].component_id = 8;
     components[7].type = get_TerrainSplat_type();
+    components[7].alignment = alignof(TerrainSplat);
     components[7].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((TerrainSplat*)data + i) TerrainSplat(); };
     components[8].component_id = 9;
     components[8].type = get_Terrain_type();
+    components[8].alignment = alignof(Terrain);
     components[8].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((Terrain*)data + i) Terrain(); };
     components[8].funcs.copy = [](void* dst, void* src, uint count) { for (uint i=0; i<count; i++) new ((Terrain*)dst + i) Terrain(((Terrain*)src)[i]); };
     components[8].funcs.destructor = [](void* ptr, uint count) { for (uint i=0; i<count; i++) ((Terrain*)ptr)[i].~Terrain(); };
@@ -1173,15 +1182,19 @@ void register_default_components(World& world) {
 
     components[9].component_id = 10;
     components[9].type = get_DirLight_type();
+    components[9].alignment = alignof(DirLight);
     components[9].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((DirLight*)data + i) DirLight(); };
     components[10].component_id = 11;
     components[10].type = get_PointLight_type();
+    components[10].alignment = alignof(PointLight);
     components[10].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((PointLight*)data + i) PointLight(); };
     components[11].component_id = 12;
     components[11].type = get_SkyLight_type();
+    components[11].alignment = alignof(SkyLight);
     components[11].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((SkyLight*)data + i) SkyLight(); };
     components[12].component_id = 13;
     components[12].type = get_Grass_type();
+    components[12].alignment = alignof(Grass);
     components[12].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((Grass*)data + i) Grass(); };
     components[12].funcs.copy = [](void* dst, void* src, uint count) { for (uint i=0; i<count; i++) new ((Grass*)dst + i) Grass(((Grass*)src)[i]); };
     components[12].funcs.destructor = [](void* ptr, uint count) { for (uint i=0; i<count; i++) ((Grass*)ptr)[i].~Grass(); };
@@ -1195,40 +1208,52 @@ void register_default_components(World& world) {
 
     components[13].component_id = 14;
     components[13].type = get_CapsuleCollider_type();
+    components[13].alignment = alignof(CapsuleCollider);
     components[13].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((CapsuleCollider*)data + i) CapsuleCollider(); };
     components[14].component_id = 15;
     components[14].type = get_SphereCollider_type();
+    components[14].alignment = alignof(SphereCollider);
     components[14].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((SphereCollider*)data + i) SphereCollider(); };
     components[15].component_id = 16;
     components[15].type = get_BoxCollider_type();
+    components[15].alignment = alignof(BoxCollider);
     components[15].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((BoxCollider*)data + i) BoxCollider(); };
     components[16].component_id = 17;
     components[16].type = get_PlaneCollider_type();
+    components[16].alignment = alignof(PlaneCollider);
     components[16].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((PlaneCollider*)data + i) PlaneCollider(); };
     components[17].component_id = 18;
     components[17].type = get_RigidBody_type();
+    components[17].alignment = alignof(RigidBody);
     components[17].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((RigidBody*)data + i) RigidBody(); };
     components[18].component_id = 19;
     components[18].type = get_CharacterController_type();
+    components[18].alignment = alignof(CharacterController);
     components[18].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((CharacterController*)data + i) CharacterController(); };
     components[19].component_id = 24;
     components[19].type = get_BtRigidBodyPtr_type();
+    components[19].alignment = alignof(BtRigidBodyPtr);
     components[19].kind = SYSTEM_COMPONENT;
     components[19].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((BtRigidBodyPtr*)data + i) BtRigidBodyPtr(); };
     components[20].component_id = 25;
     components[20].type = get_CloudVolume_type();
+    components[20].alignment = alignof(CloudVolume);
     components[20].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((CloudVolume*)data + i) CloudVolume(); };
     components[21].component_id = 26;
     components[21].type = get_FogVolume_type();
+    components[21].alignment = alignof(FogVolume);
     components[21].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((FogVolume*)data + i) FogVolume(); };
     components[22].component_id = 20;
     components[22].type = get_Materials_type();
+    components[22].alignment = alignof(Materials);
     components[22].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((Materials*)data + i) Materials(); };
     components[23].component_id = 21;
     components[23].type = get_ModelRenderer_type();
+    components[23].alignment = alignof(ModelRenderer);
     components[23].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((ModelRenderer*)data + i) ModelRenderer(); };
     components[24].component_id = 0;
     components[24].type = get_Entity_type();
+    components[24].alignment = alignof(Entity);
     components[24].funcs.constructor = [](void* data, uint count) { for (uint i=0; i<count; i++) new ((Entity*)data + i) Entity(); };
     world.register_components({components, 25});
 
@@ -3,6 +3,7 @@
 #include "graphics/rhi/vulkan/vulkan.h"
 #include "graphics/rhi/async_cpu_copy.h"
 #include "graphics/assets/assets.h"
+#include "core/memory/memory_tracking.h"
 #include "graphics/rhi/vulkan/volk.h"
 #include "graphics/rhi/vulkan/buffer.h"
 #include "graphics/rhi/vulkan/draw.h"
@@ -16,7 +17,7 @@ struct AsyncCopyResources {
 };
 
 AsyncCopyResources* make_async_copy_resources(uint size) {
-    AsyncCopyResources& resources = *PERMANENT_ALLOC(AsyncCopyResources);
+    AsyncCopyResources& resources = *TAGGED_ALLOC(MEMORY_ASSETS, AsyncCopyResources);
 	VkDevice device = rhi.device;
 	VkPhysicalDevice physical_device = rhi.device;
 
@@ -348,14 +348,14 @@ bool reload_modified_shaders() {
 	auto& shaders = assets.shaders;
 	bool modified = false;
 
-	for (uint i = 0; i < shaders.slots.length; i++) {	
-		ShaderInfo& info = shaders.slots[i].info;
+	for (uint i = 0; i < shaders.handles.length; i++) {	
+		shader_handle handle = shaders.index_to_handle(i);
+		ShaderInfo& info = shaders.get(handle)->info;
 		
 		i64 v_time_modified = io_time_modified(info.vfilename);
 		i64 f_time_modified = io_time_modified(info.ffilename);
 	
 		if (v_time_modified > info.v_time_modified || f_time_modified > info.f_time_modified) {
-			shader_handle handle = shaders.index_to_handle(i);
 			reload_Shader(handle);
 			modified = true;
 		}
@@ -1,5 +1,4 @@
 #include "graphics/culling/culling.h"
-#include "graphics/culling/build_bvh.h"
 #include <glm/vec4.hpp>
 #include <glm/glm.hpp>
 #include "graphics/renderer/renderer.h"
@@ -16,6 +15,9 @@
 #include "ecs/ecs.h"
 #include "core/job_system/job.h"
 #include "core/memory/allocator.h"
+#include "core/math/aabb_batch.h"
+#include "core/container/bitset.h"
+#include "graphics/renderer/transforms.h"
 
 //could cache this result in viewport
 void extract_planes(Viewport& viewport) {
@@ -77,147 +79,75 @@ CullResult frustum_test(const glm::vec4 planes[6], const AABB& aabb) {
 	return result;
 }
 
-#define MAX_MESHES_PER_NODE 10
-#define MAX_DEPTH 5
-//#define DEBUG_OCTREE
-
-struct SubdivideBVHJob {
-	ScenePartition* scene_partition;
-	AABB node_aabb;
-	uint depth;
-	uint mesh_count;
-	AABB* aabbs;
-	int* meshes;
-	glm::mat4* models_m;
-	uint child_idx;
-};
+//The bucket a mesh is drawn with, added the first time the combination of model, mesh and material is seen
+int mesh_bucket(MeshBuckets& mesh_buckets, model_handle model, uint mesh_index, Mesh& mesh, const Materials& materials) {
+	material_handle mat_handle = mat_by_index(materials, mesh.material_id);
 
-void subdivide_BVH(SubdivideBVHJob& job) {
-	ScenePartition& scene_partition = *job.scene_partition;
-	
-	if (job.mesh_count <= MAX_MESHES_PER_NODE || job.depth >= MAX_DEPTH) {
-		Node& node = alloc_leaf_node(scene_partition, job.node_aabb, MAX_MESH_INSTANCES, job.mesh_count);
-	
-		copy_into_node(node, scene_partition.meshes, job.meshes);
-		copy_into_node(node, scene_partition.aabbs, job.aabbs);
-		copy_into_node(node, scene_partition.model_m, job.models_m);
+	MeshBucket bucket;
+	bucket.model = model;
+	bucket.mesh_id = mesh_index;
+	bucket.mat = mat_handle;
+	bucket.flags = CAST_SHADOWS;
 
-		job.child_idx = &node - scene_partition.nodes;
-	}
-	else {
-		LinearAllocator& temporary = get_thread_local_temporary_allocator();
-        LinearRegion region(temporary);
-        
-		BranchNodeInfo info = alloc_branch_node(scene_partition, job.node_aabb);
-
-		tvector<AABB> subdivided_aabbs[2];
-		tvector<int> subdivided_meshes[2];
-		tvector<glm::mat4> subdivided_model_m[2];
-
-		for (uint i = 0; i < 2; i++) {
-			subdivided_aabbs[i].allocator = &temporary;
-			subdivided_meshes[i].allocator = &temporary;
-			subdivided_model_m[i].allocator = &temporary;
-		}
+	//todo support shadow passes RenderPass::ScenePassCount
 
-        int* split_idx = alloc_t<int>(temporary, job.mesh_count);
-        uint offset = split_aabbs(scene_partition, info, {job.aabbs, job.mesh_count}, split_idx);
-        
-		for (int i = 0; i < job.mesh_count; i++) {
-            uint node_index = split_idx[i];
-
-			if (node_index == -1) {
-				scene_partition.aabbs[offset] = job.aabbs[i];
-				scene_partition.meshes[offset] = job.meshes[i];
-				scene_partition.model_m[offset] = job.models_m[i];
-                offset++;
-			}
-			else {
-				subdivided_aabbs[node_index].append(job.aabbs[i]);
-				subdivided_meshes[node_index].append(job.meshes[i]);
-				subdivided_model_m[node_index].append(job.models_m[i]);
-			}
-		}
-
-		JobDesc desc[2];
-        SubdivideBVHJob jobs[2];
-
-		uint count = 0;
-		for (int i = 0; i < 2; i++) {
-			if (subdivided_aabbs[i].length == 0) continue;
-			
-            jobs[count].scene_partition = job.scene_partition;
-            jobs[count].node_aabb = info.child_aabbs[i];
-			jobs[count].depth = job.depth + 1;
-			jobs[count].mesh_count = subdivided_aabbs[i].length;
-			jobs[count].aabbs = subdivided_aabbs[i].data;
-			jobs[count].meshes = subdivided_meshes[i].data;
-			jobs[count].models_m = subdivided_model_m[i].data;
-
-			desc[count] = {subdivide_BVH, jobs + i};
-			count++;
-		}
+	GraphicsPipelineDesc shadow_pipeline_desc;
+	mat_pipeline_desc(shadow_pipeline_desc, mat_handle, RenderPass::Shadow0, 0);
+	shadow_pipeline_desc.state = Cull_None | DynamicState_DepthBias;
 
-		wait_for_jobs(PRIORITY_HIGH, { desc, count });
+	bucket.depth_only_pipeline = query_Pipeline(shadow_pipeline_desc);
+	bucket.depth_prepass = query_pipeline(mat_handle, RenderPass::Scene, 0);
+	bucket.color_pipeline = query_pipeline(mat_handle, RenderPass::Scene, 1);
 
-		for (int i = 0; i < 2; i++) {
-			uint child_idx = jobs[i].child_idx;
-			info.node.child[info.node.child_count++] = child_idx;
-			info.node.aabb.update_aabb(scene_partition.nodes[child_idx].aabb);
-		}
-
-        info.node.child_count = count;
-		job.child_idx = &info.node - scene_partition.nodes;
-	}
+	return mesh_buckets.add(bucket);
 }
 
+//Also records the instances of each entity, so moving it only has to update those
 void assign_meshes_to_buckets(
     World& world,
     hash_set<MeshBucket, MAX_MESH_BUCKETS>& mesh_buckets,
     tvector<AABB>& aabbs,
     tvector<glm::mat4>& models_m,
     tvector<int>& meshes,
+    vector<StaticEntityInstances>& entity_instances,
     EntityQuery query
 ) {
-    for (auto [e,trans,model_renderer,materials] : world.filter<Transform,ModelRenderer, Materials>(query)) {
-        Model* model = get_Model(model_renderer.model_id);
-        glm::mat4 model_m = compute_model_matrix(trans);
+    world.for_each_chunk<const Transform, const ModelRenderer, const Materials>(query, [&](uint count, const Entity* entities, const Transform* transforms, const ModelRenderer* model_renderers, const Materials* materials) {
+        glm::mat4 batch_m[MODEL_MATRIX_BATCH];
 
-        if (model == NULL) continue;
+        for (uint i = 0; i < count; i++) {
+            if (i % MODEL_MATRIX_BATCH == 0) compute_model_matrices(batch_m, transforms + i, min(count - i, MODEL_MATRIX_BATCH));
 
-        for (int mesh_index = 0; mesh_index < model->meshes.length; mesh_index++) {
-            Mesh& mesh = model->meshes[mesh_index]; //todo extend for lods
+            const ModelRenderer& model_renderer = model_renderers[i];
+            Model* model = get_Model(model_renderer.model_id);
+            const glm::mat4& model_m = batch_m[i % MODEL_MATRIX_BATCH];
 
-			material_handle mat_handle = mat_by_index(materials, mesh.material_id);
+            uint index = entity_index(entities[i].id);
+            while (entity_instances.length <= index) entity_instances.append({});
+            entity_instances[index] = { entities[i].id, meshes.length, model ? model->meshes.length : 0 };
 
-            MeshBucket bucket;
-            bucket.model = model_renderer.model_id;
-            bucket.mesh_id = mesh_index;
-            bucket.mat = mat_handle;
-            bucket.flags = CAST_SHADOWS;
+            if (model == NULL) continue;
 
-            //todo support shadow passes RenderPass::ScenePassCount
+            for (int mesh_index = 0; mesh_index < model->meshes.length; mesh_index++) {
+                Mesh& mesh = model->meshes[mesh_index]; //todo extend for lods
 
-			GraphicsPipelineDesc shadow_pipeline_desc;
-			mat_pipeline_desc(shadow_pipeline_desc, mat_handle, RenderPass::Shadow0, 0);
-			shadow_pipeline_desc.state = Cull_None | DynamicState_DepthBias;
-
-            bucket.depth_only_pipeline = query_Pipeline(shadow_pipeline_desc);
-			bucket.depth_prepass = query_pipeline(mat_handle, RenderPass::Scene, 0);
-            bucket.color_pipeline = query_pipeline(mat_handle, RenderPass::Scene, 1);
-
-            aabbs.append(mesh.aabb.apply(model_m));
-            meshes.append(mesh_buckets.add(bucket));
-            models_m.append(model_m);
+                aabbs.append(mesh.aabb.apply(model_m));
+                meshes.append(mesh_bucket(mesh_buckets, model_renderer.model_id, mesh_index, mesh, materials[i]));
+                models_m.append(model_m);
+            }
         }
-    }
+    });
 
 }
 
-void build_acceleration_structure(ScenePartition& scene_partition, hash_set<MeshBucket, MAX_MESH_BUCKETS> & mesh_buckets, World& world) { //todo UGH THE CURRENT SYSTEM LIMITS HOW DATA ORIENTED THIS CAN BE
+//STATIC
+EntityQuery static_mesh_query() {
+	return World::with_components<Transform, ModelRenderer, Materials>(EntityQuery{ STATIC });
+}
+
+void build_acceleration_structure(ScenePartition& scene_partition, hash_set<MeshBucket, MAX_MESH_BUCKETS> & mesh_buckets, World& world) {
 	Profile profile("Build Acceleration");
 	
-	AABB world_bounds;	
 	LinearAllocator& temporary_allocator = get_temporary_allocator();
     LinearRegion linear_region(temporary_allocator);
 
@@ -229,44 +159,316 @@ void build_acceleration_structure(ScenePartition& scene_partition, hash_set<Mesh
 	meshes.allocator = &temporary_allocator;
 	models_m.allocator = &temporary_allocator;
     
-    assign_meshes_to_buckets(world, mesh_buckets, aabbs, models_m, meshes, {STATIC});
-    
-    for (AABB& aabb : aabbs) world_bounds.update_aabb(aabb);
+	EntityQuery query = static_mesh_query();
+	scene_partition.entity_instances.clear();
+    assign_meshes_to_buckets(world, mesh_buckets, aabbs, models_m, meshes, scene_partition.entity_instances, query);
+
+	scene_partition.world = &world;
+	scene_partition.world_epoch = world.epoch;
+	scene_partition.world_removals = world.removals;
+	scene_partition.static_count = world.count(scene_partition.static_entities, query);
+
+	build_bvh(scene_partition.bvh, aabbs);
+
+	//Store the instances in leaf order, so each leaf reads a contiguous range
+	const BVH& bvh = scene_partition.bvh;
+	uint count = aabbs.length;
+
+	scene_partition.aabbs.clear();
+	scene_partition.meshes.clear();
+	scene_partition.model_m.clear();
+	scene_partition.aabb_floats.clear();
+	scene_partition.instance_slots.clear();
+	scene_partition.aabbs.resize(count);
+	scene_partition.meshes.resize(count);
+	scene_partition.model_m.resize(count);
+	scene_partition.aabb_floats.resize(6 * count);
+	scene_partition.instance_slots.resize(count);
+
+	AABBArrays& aabb_arrays = scene_partition.aabb_arrays;
+	for (uint k = 0; k < 3; k++) {
+		aabb_arrays.center[k] = scene_partition.aabb_floats.data + k * count;
+		aabb_arrays.extent[k] = scene_partition.aabb_floats.data + (3 + k) * count;
+	}
+
+	for (uint i = 0; i < count; i++) {
+		uint instance = bvh.indices[i];
+		scene_partition.aabbs[i] = aabbs[instance];
+		scene_partition.meshes[i] = meshes[instance];
+		scene_partition.model_m[i] = models_m[instance];
+		scene_partition.instance_slots[instance] = i;
+		set_aabb(aabb_arrays, i, aabbs[instance]);
+	}
+}
+
+//Moves the instances of a static entity to its transform, false when its meshes no longer match
+static bool move_static_instances(ScenePartition& partition, ID id, const glm::mat4& model_m, const ModelRenderer& model_renderer) {
+	uint index = entity_index(id);
+	if (index >= partition.entity_instances.length || partition.entity_instances[index].entity != id) return false;
+
+	const StaticEntityInstances& instances = partition.entity_instances[index];
+	Model* model = get_Model(model_renderer.model_id);
+	if ((model ? model->meshes.length : 0) != instances.count) return false;
 
-	SubdivideBVHJob job = {&scene_partition, world_bounds};
-	job.depth = 0;
-	job.mesh_count = aabbs.length;
-	job.aabbs = aabbs.data;
-	job.meshes = meshes.data;
-	job.models_m = models_m.data;
+	for (uint mesh_index = 0; mesh_index < instances.count; mesh_index++) {
+		uint slot = partition.instance_slots[instances.first + mesh_index];
+		AABB aabb = model->meshes[mesh_index].aabb.apply(model_m);
 
-	subdivide_BVH(job);
+		partition.aabbs[slot] = aabb;
+		partition.model_m[slot] = model_m;
+		set_aabb(partition.aabb_arrays, slot, aabb);
+	}
+
+	return true;
 }
 
+static void refit_static_partition(ScenePartition& partition) {
+	for (BVHNode& node : partition.bvh.nodes) {
+		if (!is_leaf(node)) continue;
 
-#define MAX_DEPTH_CHECK_EACH 5
+		node.aabb = AABB();
+		for (uint i = node.offset; i < node.offset + node.count; i++) node.aabb.update_aabb(partition.aabbs[i]);
+	}
 
-void cull_node(CulledMeshBucket* culled, const ScenePartition& partition, const Node& node, int depth, glm::vec4 planes[6]) {
-	CullResult cull_result = frustum_test(planes, node.aabb);
-	if (cull_result == OUTSIDE) return;
-	
-	bool test_children = depth < MAX_DEPTH_CHECK_EACH;
+	refit_bvh(partition.bvh);
+}
+
+//Leaves are visited in order, so the ranges of consecutive visible leaves are culled as one batch.
+//visible needs a bit for every instance.
+void cull_scene_partition(CulledMeshBucket* culled, const ScenePartition& partition, glm::vec4 planes[6], u64* visible) {
+	auto overlaps = [&](const AABB& aabb) { return frustum_test(planes, aabb) != OUTSIDE; };
+	uint begin = 0;
+	uint end = 0;
+
+	auto cull_range = [&]() {
+		uint count = end - begin;
+		if (count == 0) return;
 
-	for (int i = node.offset; i < node.offset + node.count; i++) {
-		if (test_children && frustum_test(planes, partition.aabbs[i]) == OUTSIDE) continue;
+		uint words = bit_words(count);
+		frustum_cull_aabbs(visible, planes, offset_aabb_arrays(partition.aabb_arrays, begin), count);
+
+		for (bit_iterator it = bits_begin(visible, words), last = bits_end(visible, words); it != last; ++it) {
+			uint i = begin + *it;
+			culled[partition.meshes[i]].model_m.append(partition.model_m[i]);
+		}
+	};
+
+	query_bvh(partition.bvh, overlaps, [&](const BVHNode& leaf) {
+		if (leaf.offset != end) {
+			cull_range();
+			begin = leaf.offset;
+		}
+		end = leaf.offset + leaf.count;
+	});
+
+	cull_range();
+}
 
-		culled[partition.meshes[i]].model_m.append(partition.model_m[i]);
+//Leaves are larger than their instance, so the instances of the visible leaves are culled again as one batch
+//The scratch arrays are freed on return, the culled buckets grow in the temporary allocator
+void cull_dynamic_partition(CulledMeshBucket* culled, const DynamicPartition& partition, glm::vec4 planes[6]) {
+	auto overlaps = [&](const AABB& aabb) { return frustum_test(planes, aabb) != OUTSIDE; };
+
+	vector<uint> candidates;
+	candidates.allocator = &default_allocator;
+	candidates.reserve(partition.instance_count);
+
+	query_dynamic_bvh(partition.bvh, overlaps, [&](const DynamicBVHNode& leaf) {
+		candidates.append(leaf.user);
+	});
+
+	uint count = candidates.length;
+	vector<float> aabb_floats;
+	aabb_floats.allocator = &default_allocator;
+	aabb_floats.resize(6 * count);
+
+	AABBArrays aabbs;
+	for (uint i = 0; i < 3; i++) {
+		aabbs.center[i] = aabb_floats.data + i * count;
+		aabbs.extent[i] = aabb_floats.data + (3 + i) * count;
 	}
+	for (uint i = 0; i < count; i++) set_aabb(aabbs, i, partition.instances[candidates[i]].aabb);
+
+	uint words = bit_words(count);
+	vector<u64> visible;
+	visible.allocator = &default_allocator;
+	visible.resize(words);
+	frustum_cull_aabbs(visible.data, planes, aabbs, count);
 
-	for (int i = 0; i < node.child_count; i++) {
-		cull_node(culled, partition, partition.nodes[node.child[i]], depth, planes);
+	for (bit_iterator it = bits_begin(visible.data, words), end = bits_end(visible.data, words); it != end; ++it) {
+		const DynamicMeshInstance& instance = partition.instances[candidates[*it]];
+		culled[instance.mesh].model_m.append(instance.model_m);
 	}
 }
 
-void update_acceleration_structure(ScenePartition& scene_partition, MeshBuckets& mesh_buckets, World& world) {
-	if (scene_partition.node_count == 0) {
-		build_acceleration_structure(scene_partition, mesh_buckets, world);
+//Adding static entities or writing their ModelRenderer or Materials marks their blocks as changed and
+//rebuilds the hierarchy, removing one is only noticed through the number of static entities, which is counted
+//from the stores after the world removed entities. Transform writes only move the entity's instances and refit.
+void update_static_partition(ScenePartition& scene_partition, MeshBuckets& mesh_buckets, World& world) {
+	EntityQuery query = static_mesh_query();
+	bool rebuild = scene_partition.world != &world || scene_partition.world_epoch != world.epoch;
+
+	for (auto [e, model_renderer] : world.filter<const ModelRenderer>(scene_partition.static_changed, query.with_changed<ModelRenderer, Materials>())) {
+		rebuild = true;
+		break;
 	}
+
+	if (scene_partition.world_removals != world.removals) {
+		scene_partition.world_removals = world.removals;
+		rebuild |= world.count(scene_partition.static_entities, query) != scene_partition.static_count;
+	}
+
+	//Runs even when rebuilding, so the next update doesn't see the same writes again
+	bool refit = false;
+	world.for_each_chunk<const Transform, const ModelRenderer>(scene_partition.static_moved, query.with_changed<Transform>(), [&](uint count, const Entity* entities, const Transform* transforms, const ModelRenderer* model_renderers) {
+		glm::mat4 batch_m[MODEL_MATRIX_BATCH];
+
+		for (uint begin = 0; begin < count && !rebuild; begin += MODEL_MATRIX_BATCH) {
+			uint n = min(count - begin, MODEL_MATRIX_BATCH);
+			compute_model_matrices(batch_m, transforms + begin, n);
+
+			for (uint i = 0; i < n; i++) {
+				if (!move_static_instances(scene_partition, entities[begin + i].id, batch_m[i], model_renderers[begin + i])) {
+					rebuild = true;
+					break;
+				}
+				refit = true;
+			}
+		}
+	});
+
+	if (rebuild) build_acceleration_structure(scene_partition, mesh_buckets, world);
+	else if (refit) refit_static_partition(scene_partition);
+}
+
+//DYNAMIC
+constexpr uint DYNAMIC_REBALANCE_PER_FRAME = 64;
+
+static void remove_entity_instances(DynamicPartition& partition, uint first) {
+	for (uint i = first; i != DYNAMIC_BVH_NULL; i = partition.instances[i].next) {
+		remove_dynamic_bvh(partition.bvh, partition.instances[i].leaf);
+		partition.free_instances.append(i);
+		partition.instance_count--;
+	}
+}
+
+static uint alloc_instance(DynamicPartition& partition) {
+	partition.instance_count++;
+	if (partition.free_instances.length > 0) return partition.free_instances.pop();
+
+	partition.instances.append({});
+	return partition.instances.length - 1;
+}
+
+static void reset_dynamic_partition(DynamicPartition& partition, World& world, EntityQuery query) {
+	clear_dynamic_bvh(partition.bvh);
+	partition.instances.clear();
+	partition.free_instances.clear();
+	partition.entity_instances.clear();
+	partition.instance_count = 0;
+
+	partition.changed = Query(); //visits every entity the next time
+	partition.query = query;
+	partition.world = &world;
+	partition.world_epoch = world.epoch;
+	partition.world_removals = world.removals;
+}
+
+//Removes the instances of entities which were destroyed or no longer match the query
+static void remove_stale_instances(DynamicPartition& partition, World& world) {
+	for (uint index = 0; index < partition.entity_instances.length; index++) {
+		uint first = partition.entity_instances[index];
+		if (first == DYNAMIC_BVH_NULL) continue;
+
+		EntitySlot* slot = world.entities.find(partition.instances[first].entity);
+		if (slot && query_matches(partition.query, world.arches.keys[slot->store])) continue;
+
+		remove_entity_instances(partition, first);
+		partition.entity_instances[index] = DYNAMIC_BVH_NULL;
+	}
+}
+
+//Reuses the entity's instances in mesh order, so an entity which only moved just moves its leaves
+static void update_entity_instances(DynamicPartition& partition, MeshBuckets& mesh_buckets, ID id, const glm::mat4& model_m, const ModelRenderer& model_renderer, const Materials& materials) {
+	uint index = entity_index(id);
+	while (partition.entity_instances.length <= index) partition.entity_instances.append(DYNAMIC_BVH_NULL);
+
+	//The index was handed out again since
+	uint current = partition.entity_instances[index];
+	if (current != DYNAMIC_BVH_NULL && partition.instances[current].entity != id) {
+		remove_entity_instances(partition, current);
+		current = DYNAMIC_BVH_NULL;
+	}
+
+	Model* model = get_Model(model_renderer.model_id);
+	uint mesh_count = model ? model->meshes.length : 0;
+	uint previous = DYNAMIC_BVH_NULL;
+
+	for (uint mesh_index = 0; mesh_index < mesh_count; mesh_index++) {
+		Mesh& mesh = model->meshes[mesh_index];
+		AABB aabb = mesh.aabb.apply(model_m);
+
+		if (current == DYNAMIC_BVH_NULL) {
+			current = alloc_instance(partition);
+			partition.instances[current].entity = id;
+			partition.instances[current].next = DYNAMIC_BVH_NULL;
+			partition.instances[current].leaf = insert_dynamic_bvh(partition.bvh, aabb, current);
+		}
+		else {
+			move_dynamic_bvh(partition.bvh, partition.instances[current].leaf, aabb);
+		}
+
+		if (previous == DYNAMIC_BVH_NULL) partition.entity_instances[index] = current;
+		else partition.instances[previous].next = current;
+
+		DynamicMeshInstance& instance = partition.instances[current];
+		instance.mesh = mesh_bucket(mesh_buckets, model_renderer.model_id, mesh_index, mesh, materials);
+		instance.aabb = aabb;
+		instance.model_m = model_m;
+
+		previous = current;
+		current = instance.next;
+	}
+
+	//Meshes left over from a model with more of them
+	if (current != DYNAMIC_BVH_NULL) remove_entity_instances(partition, current);
+	if (previous == DYNAMIC_BVH_NULL) partition.entity_instances[index] = DYNAMIC_BVH_NULL;
+	else partition.instances[previous].next = DYNAMIC_BVH_NULL;
+}
+
+void update_dynamic_partition(DynamicPartition& partition, MeshBuckets& mesh_buckets, World& world, EntityQuery layermask) {
+	EntityQuery query = World::with_components<Transform, ModelRenderer, Materials>(layermask.with_none(STATIC));
+
+	if (partition.world != &world || partition.world_epoch != world.epoch || partition.query != query) {
+		reset_dynamic_partition(partition, world, query);
+	}
+
+	if (partition.world_removals != world.removals) {
+		remove_stale_instances(partition, world);
+		partition.world_removals = world.removals;
+	}
+
+	world.for_each_chunk<const Transform, const ModelRenderer, const Materials>(partition.changed, query.with_changed<Transform, ModelRenderer, Materials>(), [&](uint count, const Entity* entities, const Transform* transforms, const ModelRenderer* model_renderers, const Materials* materials) {
+		glm::mat4 batch_m[MODEL_MATRIX_BATCH];
+
+		for (uint begin = 0; begin < count; begin += MODEL_MATRIX_BATCH) {
+			uint n = min(count - begin, MODEL_MATRIX_BATCH);
+			compute_model_matrices(batch_m, transforms + begin, n);
+
+			for (uint i = begin; i < begin + n; i++) {
+				update_entity_instances(partition, mesh_buckets, entities[i].id, batch_m[i - begin], model_renderers[i], materials[i]);
+			}
+		}
+	});
+
+	rebalance_dynamic_bvh(partition.bvh, DYNAMIC_REBALANCE_PER_FRAME);
+}
+
+void update_acceleration_structure(ScenePartition& scene_partition, MeshBuckets& mesh_buckets, World& world, EntityQuery layermask) {
+	Profile profile("Update Acceleration");
+
+	update_static_partition(scene_partition, mesh_buckets, world);
+	update_dynamic_partition(scene_partition.dynamic, mesh_buckets, world, layermask);
 }
 
 /*
@@ -285,16 +487,12 @@ void cull_dynamic_meshes(const ScenePartition& scene_partition, World& world, Me
 }
 
 void cull_static_meshes(const ScenePartition& scene_partition, CulledMeshBucket* culled_mesh_bucket, glm::vec4 planes[6]) {
-    cull_node(culled_mesh_bucket, scene_partition, scene_partition.nodes[0], 0, planes);
+    cull_scene_partition(culled_mesh_bucket, scene_partition, planes);
 }
 */
 
 struct CullMeshJob {
 	const ScenePartition* partition;
-	MeshBuckets* buckets;
-	slice<AABB> aabbs;
-	slice<glm::mat4> model_m;
-	slice<int> meshes;
 	glm::vec4* planes;
 	CulledMeshBucket* result;
 };
@@ -304,45 +502,38 @@ void cull_mesh_job(CullMeshJob& job) {
 		job.result[i].model_m.clear();
 	}
 
-	for (uint i = 0; i < job.meshes.length; i++) {
-		if (frustum_test(job.planes, job.aabbs[i]) == OUTSIDE) continue;
-		job.result[job.meshes[i]].model_m.append(job.model_m[i]);
-	}
+	//Scratch lives on default_allocator, a region of the temporary allocator couldn't be reset
+	//while the culled buckets grow in it, and leaving it would keep the scratch until the end of the frame
+	vector<u64> visible;
+	visible.allocator = &default_allocator;
+	visible.resize(bit_words(job.partition->aabbs.length));
 
-	cull_node(job.result, *job.partition, job.partition->nodes[0], 0, job.planes);
+	cull_scene_partition(job.result, *job.partition, job.planes, visible.data);
+	cull_dynamic_partition(job.result, job.partition->dynamic, job.planes);
 }
 
-void cull_meshes(const ScenePartition& scene_partition, World& world, MeshBuckets& buckets, uint count, CulledMeshBucket** culled_mesh_bucket, Viewport viewports[], EntityQuery query) {
-	tvector<AABB> aabbs;
-	tvector<glm::mat4> model_m;
-	tvector<int> meshes;
-	
-	assign_meshes_to_buckets(world, buckets, aabbs, model_m, meshes, query.with_none(STATIC));
-	
+//The partition must be up to date, see update_acceleration_structure
+void cull_meshes(const ScenePartition& scene_partition, uint count, CulledMeshBucket** culled_mesh_bucket, Viewport viewports[]) {
 	CullMeshJob job[10];
 	JobDesc desc[10];
 	assert(count <= 10);
 
 	for (uint pass = 0; pass < count; pass++) {
-		job[pass] = { &scene_partition, &buckets, aabbs, model_m, meshes, viewports[pass].frustum_planes, culled_mesh_bucket[pass] };
+		job[pass] = { &scene_partition, viewports[pass].frustum_planes, culled_mesh_bucket[pass] };
 		desc[pass] = { cull_mesh_job, job + pass };
 	}
 
 	wait_for_jobs(PRIORITY_HIGH, { desc, count });
 }
 
-void render_node(RenderPass& ctx, material_handle mat, model_handle cube, ScenePartition& scene_partition, uint node_index) {
-	Node& node = scene_partition.nodes[node_index];
-
-	Transform trans;
-	trans.position = (node.aabb.max + node.aabb.min) * 0.5f;
-	trans.scale = node.aabb.max - node.aabb.min;
-	trans.scale *= 0.5f;
-
-	draw_mesh(ctx.cmd_buffer, cube, mat, trans);
+void render_nodes(RenderPass& ctx, material_handle mat, model_handle cube, ScenePartition& scene_partition) {
+	for (const BVHNode& node : scene_partition.bvh.nodes) {
+		Transform trans;
+		trans.position = (node.aabb.max + node.aabb.min) * 0.5f;
+		trans.scale = node.aabb.max - node.aabb.min;
+		trans.scale *= 0.5f;
 
-	for (int i = 0; i < 2; i++) {
-		if (node.child[i]) render_node(ctx, mat, cube, scene_partition, node.child[i]);
+		draw_mesh(ctx.cmd_buffer, cube, mat, trans);
 	}
 }
 
@@ -360,5 +551,5 @@ void render_debug_bvh(ScenePartition& scene_partition, RenderPass& ctx) {
 	//mat->set_vec3(shaders, "color", glm::vec3(1.0f, 0.0f, 0.0f));
 	//mat->state = &draw_wireframe_state;
 
-	//render_node(ctx, mat, models.get(cube), scene_partition.nodes[0]);
+	//render_nodes(ctx, mat, models.get(cube), scene_partition);
 }
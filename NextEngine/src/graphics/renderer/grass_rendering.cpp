@@ -1,4 +1,5 @@
 #include "graphics/renderer/grass.h"
+#include "graphics/renderer/transforms.h"
 #include "ecs/ecs.h"
 #include "components/transform.h"
 #include "components/grass.h"
@@ -8,17 +9,15 @@
 #include "core/profiler.h"
 #include "graphics/culling/culling.h"
 #include "graphics/rhi/draw.h"
+#include "core/math/aabb_batch.h"
+#include "core/container/bitset.h"
 
 #include <algorithm>
 #include "core/job_system/job.h"
 
 glm::mat4* compute_model_matrices(vector<Transform>& transforms) {
 	glm::mat4* result = TEMPORARY_ARRAY(glm::mat4, transforms.length);
-
-	for (unsigned int i = 0; i < transforms.length; i++) {
-		result[i] = compute_model_matrix(transforms[i]); 
-	}
-
+	compute_model_matrices(result, transforms.data, transforms.length);
 	return result;
 }
 
@@ -46,7 +45,16 @@ void cull_grass_particles(CullGrassJob& job) {
 		job.output[i].allocator = &allocator;
 	}
 
-	for (uint i = 0; i < job.positions.length; i++) {
+	//Frustum cull every instance in one batch, the scratch arrays live as long as the outputs
+	uint count = job.positions.length;
+	AABBArrays aabbs = alloc_aabb_arrays(allocator, count);
+	u64* visible = alloc_t<u64>(allocator, bit_words(count));
+
+	transform_aabbs(aabbs, input.model_aabb, job.model_m.data, count);
+	frustum_cull_aabbs(visible, input.planes, aabbs, count);
+
+	for (bit_iterator it = bits_begin(visible, bit_words(count)), end = bits_end(visible, bit_words(count)); it != end; ++it) {
+		uint i = *it;
 		glm::vec3 position = job.positions[i];
 
 		glm::vec3 vec = position - input.cam_pos;
@@ -54,9 +62,6 @@ void cull_grass_particles(CullGrassJob& job) {
 
 		if (dist > input.culling_distance) continue;
 
-		AABB aabb = input.model_aabb.apply(job.model_m[i]);
-		if (frustum_test(input.planes, aabb) == OUTSIDE) continue;
-
 		//float grazing_multiplier = glm::abs(glm::dot(glm::normalize(position - cam_pos), glm::vec3(0,1,0)));
 		//grazing_multiplier = 1.0 - grazing_multiplier;
 
@@ -133,7 +138,7 @@ void extract_grass_render_data(GrassRenderData& data, World& world, Viewport vie
 				jobs[i].model_m.length = i + 1 == buckets ? grass.positions.length - i * bucket_size : bucket_size;
 				jobs[i].positions.length = jobs[i].model_m.length;
 
-				job_desc.append(JobDesc{ cull_grass_particles, jobs + i });
+				job_desc.append(JobDesc{ cull_grass_particles, jobs + i, FIBER_STACK_SMALL });
 			}
 
 			job_results[pass] = {jobs, buckets};
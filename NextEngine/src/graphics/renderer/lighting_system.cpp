@@ -60,7 +60,7 @@ void fill_light_ubo(LightUBO& light_ubo, World& world, Viewport& viewport, Entit
 	light_ubo = {};
 	light_ubo.viewpos = viewport.cam_pos;
 
-	for (auto [e, trans, point_light] : world.filter<Transform, PointLight>(mask)) {
+	for (auto [e, trans, point_light] : world.filter<const Transform, const PointLight>(mask)) {
 		PointLightUBO& ubo = light_ubo.point_lights[light_ubo.num_point_lights++];
 		ubo.position = trans.position;
 		ubo.color = glm::vec4(point_light.color, 1.0);
@@ -69,7 +69,7 @@ void fill_light_ubo(LightUBO& light_ubo, World& world, Viewport& viewport, Entit
 		if (light_ubo.num_point_lights == MAX_POINT_LIGHTS) break;
 	}
 
-	for (auto [e,dir_light] : world.filter<DirLight>(mask)) {
+	for (auto [e,dir_light] : world.filter<const DirLight>(mask)) {
 		DirLightUBO ubo = {};
 		ubo.direction = glm::vec4(dir_light.direction, 1.0);
 		ubo.color = glm::vec4(dir_light.color, 1.0);
@@ -112,10 +112,9 @@ void mat_channel4(MaterialDesc& desc, string_view name, glm::vec4 value, texture
 	desc.params.append(param);
 }
 
-material_handle mat_by_index(Materials& materials, uint material_id) {
-	if (materials.materials.length <= material_id) { //todo add this as a preprocess pass
-		materials.materials.resize(material_id + 1);
-	}
+//Doesn't grow materials, so culling can read it without marking the block written
+material_handle mat_by_index(const Materials& materials, uint material_id) {
+	if (materials.materials.length <= material_id) return default_materials.missing; //todo add this as a preprocess pass
 	material_handle mat_handle = materials.materials[material_id];
 	if (mat_handle.id == INVALID_HANDLE) mat_handle = default_materials.missing;
 	return mat_handle;
@@ -6,6 +6,7 @@
 #include "components/camera.h"
 #include "graphics/rhi/draw.h"
 #include "core/memory/linear_allocator.h"
+#include "core/memory/memory_tracking.h"
 #include "graphics/pass/pass.h"
 #include "graphics/rhi/window.h"
 #include "graphics/rhi/frame_buffer.h"
@@ -68,7 +69,7 @@ void make_scene_pass(Renderer& renderer, uint width, uint height, uint msaa) {
 }
 
 Renderer* make_Renderer(const RenderSettings& settings, World& world) {
-	Renderer* renderer = PERMANENT_ALLOC(Renderer);
+	Renderer* renderer = TAGGED_ALLOC(MEMORY_RENDERER, Renderer);
 	renderer->settings = settings;
     
 	uint width = settings.display_resolution_width;
@@ -121,11 +122,7 @@ void render_overlay(Renderer& renderer, RenderPass& render_pass) {
 }
 
 void extract_render_data(Renderer& renderer, Viewport& viewport, FrameData& frame,  World& world, EntityQuery layermask, EntityQuery camera_layermask) {
-	static bool updated_acceleration = false;
-	if (!updated_acceleration) {
-		build_acceleration_structure(renderer.scene_partition, renderer.mesh_buckets, world);
-		updated_acceleration = true;
-	}
+	update_acceleration_structure(renderer.scene_partition, renderer.mesh_buckets, world, layermask);
 	
 	for (uint i = 0; i < RenderPass::ScenePassCount; i++) {
 		frame.culled_mesh_bucket[i] = TEMPORARY_ARRAY(CulledMeshBucket, MAX_MESH_BUCKETS);
@@ -143,7 +140,7 @@ void extract_render_data(Renderer& renderer, Viewport& viewport, FrameData& fram
 	fill_volumetric_ubo(frame.volumetric_ubo, frame.composite_ubo, world, renderer.settings.volumetric, viewport, camera_layermask);
 	fill_composite_ubo(frame.composite_ubo, viewport);
 
-	cull_meshes(renderer.scene_partition, world, renderer.mesh_buckets, RenderPass::ScenePassCount, frame.culled_mesh_bucket, viewports, layermask);
+	cull_meshes(renderer.scene_partition, RenderPass::ScenePassCount, frame.culled_mesh_bucket, viewports);
 		
 	extract_grass_render_data(frame.grass_data, world, viewports);
 	extract_render_data_terrain(frame.terrain_data, world, &viewport, layermask);
@@ -1,18 +1,42 @@
-#include "ecs/ecs.h"
 #include "graphics/renderer/transforms.h"
 #include "components/transform.h"
 #include "core/memory/allocator.h"
-#include <glm/gtc/matrix_transform.hpp>
+#include "core/math/model_matrices.h"
 
-void compute_model_matrices(glm::mat4* model_m, World& world, EntityQuery mask) {
-	for (auto [e, trans] : world.filter<Transform>(mask)) {
-		glm::mat4 identity;
+struct TransformBatch {
+	float position[3][MODEL_MATRIX_BATCH];
+	float rotation[4][MODEL_MATRIX_BATCH];
+	float scale[3][MODEL_MATRIX_BATCH];
 
-		glm::mat4 translate = glm::translate(identity, trans.position);
-		glm::mat4 scale = glm::scale(translate, trans.scale);
-		glm::mat4 rotation = glm::mat4_cast(trans.rotation);
+	TransformArrays arrays() {
+		return {
+			{ position[0], position[1], position[2] },
+			{ rotation[0], rotation[1], rotation[2], rotation[3] },
+			{ scale[0], scale[1], scale[2] }
+		};
+	}
+};
 
-		model_m[e.id] = scale * rotation;
+static void split_transforms(TransformBatch& batch, const Transform* transforms, uint count) {
+	for (uint i = 0; i < count; i++) {
+		const Transform& trans = transforms[i];
+		for (uint j = 0; j < 3; j++) {
+			batch.position[j][i] = trans.position[j];
+			batch.scale[j][i] = trans.scale[j];
+		}
+		batch.rotation[0][i] = trans.rotation.x;
+		batch.rotation[1][i] = trans.rotation.y;
+		batch.rotation[2][i] = trans.rotation.z;
+		batch.rotation[3][i] = trans.rotation.w;
 	}
 }
 
+void compute_model_matrices(glm::mat4* model_m, const Transform* transforms, uint count) {
+	TransformBatch batch;
+
+	for (uint begin = 0; begin < count; begin += MODEL_MATRIX_BATCH) {
+		uint n = min(count - begin, MODEL_MATRIX_BATCH);
+		split_transforms(batch, transforms + begin, n);
+		compute_model_matrices(model_m + begin, batch.arrays(), n);
+	}
+}
@@ -1,6 +1,7 @@
 #include "components/terrain.h"
 #include "physics/physics.h"
 #include "ecs/ecs.h"
+#include "ecs/command_buffer.h"
 #include "components/transform.h"
 #include <glm/glm.hpp>
 
@@ -274,19 +275,54 @@ RigidBodySettings default_rb_settings(Entity e, Transform& trans, RigidBody& rb)
 	return settings;
 }
 
+//False when neither the position nor the velocity changed
+bool sync_rigid_body(Transform& trans, const BtRigidBodyPtr& ptr, RigidBody& rb) {
+	if (rb.mass == 0) return false;
+
+	btRigidBody* bt_rigid_body = ptr.bt_rigid_body;
+	BulletWrapperTransform trans_of_rb;
+
+	transform_of_RigidBody(bt_rigid_body, &trans_of_rb);
+
+	glm::vec3 position = trans.position;
+	glm::vec3 velocity = rb.velocity;
+
+	if (!rb.override_position) trans.position = trans_of_rb.position;
+	else trans_of_rb.position = trans.position;
+	
+	if (!rb.override_velocity_x) rb.velocity.x = trans_of_rb.velocity.x;
+	else trans_of_rb.velocity.x = rb.velocity.x;
+
+	if (!rb.override_velocity_y) rb.velocity.y = trans_of_rb.velocity.y;
+	else trans_of_rb.velocity.y = rb.velocity.y;
+
+	if (!rb.override_velocity_z) rb.velocity.z = trans_of_rb.velocity.z;
+	else trans_of_rb.velocity.z = rb.velocity.z;
+
+	set_transform_of_RigidBody(bt_rigid_body, &trans_of_rb);
+	return position != trans.position || velocity != rb.velocity;
+}
+
 void PhysicsSystem::update(World& world, UpdateCtx& params) {
 	step_BulletWrapper(bt_wrapper, params.delta_time);
 
 	EntityQuery to_be_initialized = params.layermask.with_none<BtRigidBodyPtr>();
 
+	//Adding or removing BtRigidBodyPtr moves the entity to another archetype, which can't happen while it is
+	//being iterated, so the changes are recorded and played back after each filter.
+	//An entity with several colliders then only gets a body from the first filter, as before.
+	EntityCommandBuffer commands;
+
 	for (auto [e, trans, collider, rb] : world.filter<Transform, SphereCollider, RigidBody>(to_be_initialized)) {
 		RigidBodySettings settings = default_rb_settings(e, trans, rb);
 		settings.shape = make_SphereShape(collider.radius * trans.scale.x);
 		if (rb.continous) settings.sweep_radius = collider.radius * trans.scale.x;
 		
-		world.add<BtRigidBodyPtr>(e.id)->bt_rigid_body = make_RigidBody(bt_wrapper, &settings);
+		commands.add(e.id, BtRigidBodyPtr{ make_RigidBody(bt_wrapper, &settings) });
 	}
 
+	playback(world, commands);
+
 	for (auto [e, trans, collider, rb] : world.filter<Transform, BoxCollider, RigidBody>(to_be_initialized)) {
 		RigidBodySettings settings = default_rb_settings(e, trans, rb);
 
@@ -294,24 +330,30 @@ void PhysicsSystem::update(World& world, UpdateCtx& params) {
 		settings.shape = make_BoxShape(size);
 		if (rb.continous) settings.sweep_radius = glm::max(size.z, glm::max(size.x, size.y));
 
-		world.add<BtRigidBodyPtr>(e.id)->bt_rigid_body = make_RigidBody(bt_wrapper, &settings);
+		commands.add(e.id, BtRigidBodyPtr{ make_RigidBody(bt_wrapper, &settings) });
 	}
 
+	playback(world, commands);
+
 	for (auto [e, trans, collider, rb] : world.filter<Transform, CapsuleCollider, RigidBody>(to_be_initialized)) {
 		RigidBodySettings settings = default_rb_settings(e, trans, rb);
 		settings.shape = make_CapsuleShape(collider.radius * trans.scale.x, collider.height * trans.scale.y);
 		if (rb.continous) settings.sweep_radius = collider.radius * trans.scale.x + collider.height * trans.scale.y;
 
-		world.add<BtRigidBodyPtr>(e.id)->bt_rigid_body = make_RigidBody(bt_wrapper, &settings);
+		commands.add(e.id, BtRigidBodyPtr{ make_RigidBody(bt_wrapper, &settings) });
 	}
 
+	playback(world, commands);
+
 	for (auto [e, trans, collider, rb] : world.filter<Transform, PlaneCollider, RigidBody>(to_be_initialized)) {
 		RigidBodySettings settings = default_rb_settings(e, trans, rb);
 		settings.shape = make_PlaneShape(collider.normal);
 
-		world.add<BtRigidBodyPtr>(e.id)->bt_rigid_body = make_RigidBody(bt_wrapper, &settings);
+		commands.add(e.id, BtRigidBodyPtr{ make_RigidBody(bt_wrapper, &settings) });
 	}
 
+	playback(world, commands);
+
 	for (auto [e, trans, collider, rb] : world.filter<Transform, Terrain, RigidBody>(to_be_initialized)) {
 		RigidBodySettings settings = default_rb_settings(e, trans, rb);
 		int width = collider.width * 32;
@@ -347,35 +389,39 @@ void PhysicsSystem::update(World& world, UpdateCtx& params) {
 
 		//shape->setLocalScaling(btVector3(size_per_quad, size_per_quad, size_per_quad));
 
-		world.add<BtRigidBodyPtr>(e.id)->bt_rigid_body = make_RigidBody(bt_wrapper, &settings);
+		commands.add(e.id, BtRigidBodyPtr{ make_RigidBody(bt_wrapper, &settings) });
 	}
 
+	playback(world, commands);
+
 	for (auto [e, ptr] : world.filter<BtRigidBodyPtr>(params.layermask.with_none<RigidBody>())) {
 		free_RigidBody(bt_wrapper, ptr.bt_rigid_body);
+		commands.remove<BtRigidBodyPtr>(e.id);
 	}
 
-	for (auto [e,trans,ptr,rb]: world.filter<Transform, BtRigidBodyPtr, RigidBody>(params.layermask)) {
-		if (rb.mass == 0) continue;
+	playback(world, commands);
 
-		btRigidBody* bt_rigid_body = ptr.bt_rigid_body;
-		BulletWrapperTransform trans_of_rb;
+	//Each body is only touched by the job owning its chunk, which also marks the block.
+	//The chunks are collected as read only, so blocks where no body moved aren't marked written every frame.
+	vector<Chunk> chunks;
+	chunks.allocator = &default_allocator;
+	world.collect_chunks<const Transform, const BtRigidBodyPtr, const RigidBody>(synced_bodies, World::with_components<Transform, BtRigidBodyPtr, RigidBody>(params.layermask), chunks);
 
-		transform_of_RigidBody(bt_rigid_body, &trans_of_rb);
+	Archetype synced = to_archetype<Transform, RigidBody>();
+	uint version = world.change_version;
 
-		if (!rb.override_position) trans.position = trans_of_rb.position;
-		else trans_of_rb.position = trans.position;
-		
-		if (!rb.override_velocity_x) rb.velocity.x = trans_of_rb.velocity.x;
-		else trans_of_rb.velocity.x = rb.velocity.x;
+	parallel_for(0, chunks.length, 1, [&](uint begin, uint end) {
+		for (uint c = begin; c < end; c++) {
+			Chunk& chunk = chunks[c];
+			Transform* trans = world.chunk_components<Transform>(chunk);
+			const BtRigidBodyPtr* ptr = world.chunk_components<const BtRigidBodyPtr>(chunk);
+			RigidBody* rb = world.chunk_components<RigidBody>(chunk);
 
-		if (!rb.override_velocity_y) rb.velocity.y = trans_of_rb.velocity.y;
-		else trans_of_rb.velocity.y = rb.velocity.y;
-
-		if (!rb.override_velocity_z) rb.velocity.z = trans_of_rb.velocity.z;
-		else trans_of_rb.velocity.z = rb.velocity.z;
-
-		set_transform_of_RigidBody(bt_rigid_body, &trans_of_rb);
-	}
+			bool changed = false;
+			for (uint i = 0; i < chunk.count; i++) changed |= sync_rigid_body(trans[i], ptr[i], rb[i]);
+			if (changed) world.mark_written(*chunk.store, chunk.block, synced, version);
+		}
+	});
 
 	auto terrains = world.first<Terrain, Transform>();
 	if (!terrains) return;
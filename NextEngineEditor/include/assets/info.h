@@ -1,6 +1,7 @@
 #pragma once
 
 #include "node.h"
+#include "core/container/flat_hash_map.h"
 
 const uint MAX_ASSETS = 1000;
 const uint MAX_PER_ASSET_TYPE = 1024;
@@ -8,7 +9,8 @@ const uint MAX_PER_ASSET_TYPE = 1024;
 struct AssetInfo {
 	array<MAX_ASSETS, asset_handle> free_ids = 0;
 	AssetNode* asset_handle_to_node[MAX_ASSETS];
-	AssetNode* asset_type_handle_to_node[AssetNode::Count][MAX_ASSETS];
+	//By the id of the engine handle, which packs a generation and the serialized bit so it can't index an array
+	flat_hash_map<uint, AssetNode*> asset_type_handle_to_node[AssetNode::Count];
 	AssetNode toplevel;
 	material_handle default_material;
 };
@@ -18,6 +20,7 @@ struct AssetPreviewResources;
 
 void register_asset_ptr(AssetInfo& tab, AssetNode* node);
 AssetNode* get_asset(AssetInfo& tab, asset_handle handle);
+AssetNode* get_asset_of_type(AssetInfo& tab, AssetNode::Type type, uint handle_id);
 void add_to_folder(AssetInfo& self, asset_handle folder_handle, AssetNode&& asset);
 void free_asset(AssetPreviewResources& resources, AssetNode& asset);
 void remove_from_folder(AssetInfo& self, asset_handle folder_handle, AssetNode* asset);
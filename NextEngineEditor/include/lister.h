@@ -25,7 +25,7 @@ struct EntityEditor { //Editor meta data for this entity
 
 struct Lister {
 	EntityNode root_node;
-	EntityNode* by_id[MAX_ENTITIES];
+	vector<EntityNode*> by_id; //by entity_index, grows as entities are added
 
 	string_buffer filter;
 
@@ -35,5 +35,6 @@ struct Lister {
 
 void register_entity(Lister&, string_view, ID);
 EntityNode* node_by_id(Lister& lister, ID id);
+EntityNode*& node_slot(Lister& lister, ID id);
 string_buffer name_with_id(struct World&, ID id);
 void clone_entity(Lister& lister, World& world, ID id);
@@ -408,11 +408,11 @@ bool load_asset_info(AssetPreviewResources& resources, AssetInfo& info, Deserial
 
 	for (MaterialLoadJob& job : jobs.materials) {
 		make_Material(job.handle, *job.desc);
-		//render_preview_for(resources, info.asset_type_handle_to_node[AssetNode::Material][job.handle.id]->material);
+		//render_preview_for(resources, get_asset_of_type(info, AssetNode::Material, job.handle.id)->material);
 	}
 
 	for (ModelLoadJob& job : jobs.models) {
-		ModelAsset& asset = info.asset_type_handle_to_node[AssetNode::Model][job.handle.id]->model;
+		ModelAsset& asset = get_asset_of_type(info, AssetNode::Model, job.handle.id)->model;
 
 		load_Model(job.handle, job.path, job.model, asset.lod_distance);		
 	}
@@ -49,6 +49,7 @@ AssetNode::~AssetNode() {
 }
 
 void register_asset_ptr(AssetInfo& tab, AssetNode* node) {
+	assert(node->handle.id < MAX_ASSETS); //handed out from free_ids
 	tab.asset_handle_to_node[node->handle.id] = node;
 
 	if (node->type != AssetNode::Folder) tab.asset_type_handle_to_node[node->type][node->asset.handle] = node;
@@ -58,6 +59,11 @@ AssetNode* get_asset(AssetInfo& tab, asset_handle handle) {
 	return tab.asset_handle_to_node[handle.id];
 }
 
+AssetNode* get_asset_of_type(AssetInfo& tab, AssetNode::Type type, uint handle_id) {
+	AssetNode** node = tab.asset_type_handle_to_node[type].get(handle_id);
+	return node ? *node : nullptr;
+}
+
 void add_to_folder(AssetInfo& self, asset_handle folder_handle, AssetNode&& asset) {
 	AssetFolder& folder = get_asset(self, folder_handle)->folder;
 
@@ -118,12 +124,16 @@ void accept_move_to_folder(AssetInfo& tab, AssetNode** ptr) {
 	for (uint type = 0; type < AssetNode::Type::Count; type++) {
 		if (const ImGuiPayload* payload = ImGui::AcceptDragDropPayload(drop_types[type])) {
 			uint id = *(uint*)payload->Data;
-			*ptr = tab.asset_type_handle_to_node[type][id];
+			*ptr = get_asset_of_type(tab, (AssetNode::Type)type, id);
 		}
 	}
 }
 
 void make_AssetInfo(AssetInfo& info) {
+	for (uint type = 0; type < AssetNode::Count; type++) {
+		info.asset_type_handle_to_node[type].allocator = &default_allocator;
+	}
+
 	for (uint i = MAX_ASSETS - 1; i > 0; i--) {
 		info.free_ids.append({ i });
 	}
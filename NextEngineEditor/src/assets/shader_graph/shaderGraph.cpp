@@ -534,7 +534,7 @@ MaterialDesc mat_desc_for_shader_graph(ShaderAsset& asset) {
 }
 
 void set_params_for_shader_graph(AssetTab& asset_tab, shader_handle shader_handle) {
-	AssetNode* asset_node = asset_tab.info.asset_type_handle_to_node[AssetNode::Shader][shader_handle.id];
+	AssetNode* asset_node = get_asset_of_type(asset_tab.info, AssetNode::Shader, shader_handle.id);
 	ShaderAsset* asset = asset_node ? &asset_node->shader : nullptr;
 	if (!asset) return;
 
@@ -638,7 +638,7 @@ void ShaderGraph::render(World& world, RenderPass& ctx, Input& input) {
     ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0,0));
 
 	//Draw Nodes
-	for (unsigned int i = 0; i < nodes_manager.slots.length; i++) {
+	for (unsigned int i = 0; i < nodes_manager.handles.length; i++) {
 		render_node(*this, nodes_manager.index_to_handle(i));
 	}
     
@@ -647,7 +647,7 @@ void ShaderGraph::render(World& world, RenderPass& ctx, Input& input) {
 	draw_list->ChannelsSetCurrent(0);
 
 	//Draw Links
-	for (unsigned int i = 0; i < nodes_manager.slots.length; i++) {
+	for (unsigned int i = 0; i < nodes_manager.handles.length; i++) {
 		ShaderNode* node = nodes_manager.get(nodes_manager.index_to_handle(i));
 
 		for (auto& input : node->inputs) {
@@ -831,7 +831,7 @@ void ShaderCompiler::compile() {
 
 	shader_node_handle base_node = { INVALID_HANDLE };
 		
-	for (int i = 0; i < graph.nodes_manager.slots.length; i++) {
+	for (int i = 0; i < graph.nodes_manager.handles.length; i++) {
 		ShaderNode* node = graph.nodes_manager.get(graph.nodes_manager.index_to_handle(i));
 		
 		if (node->type == ShaderNode::PBR_NODE) {
@@ -1370,12 +1370,12 @@ void serialize_shader_asset(SerializerBuffer& buffer,  ShaderAsset* asset) {
 	ShaderGraph* graph = asset->graph;
 
 	buffer.write_string(asset->name);
-	buffer.write_int(graph->nodes_manager.slots.length);
+	buffer.write_int(graph->nodes_manager.handles.length);
 
-	for (unsigned int i = 0; i < graph->nodes_manager.slots.length; i++) {
+	for (unsigned int i = 0; i < graph->nodes_manager.handles.length; i++) {
 		buffer.write_int(graph->nodes_manager.index_to_handle(i).id);
 
-		ShaderNode* node = &graph->nodes_manager.slots[i];
+		ShaderNode* node = graph->nodes_manager.get(graph->nodes_manager.index_to_handle(i));
 		
 		buffer.write_int(node->type);
 		buffer.write_byte(node->collapsed);
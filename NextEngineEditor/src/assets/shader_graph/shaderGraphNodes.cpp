@@ -381,7 +381,7 @@ void new_node_popup(ShaderAsset* asset) {
 void ShaderCompiler::find_dependencies() {
 	graph.dependencies.clear();
 
-	for (int i = 0; i < graph.nodes_manager.slots.length; i++) {
+	for (int i = 0; i < graph.nodes_manager.handles.length; i++) {
 		shader_node_handle handle = graph.nodes_manager.index_to_handle(i);
 		ShaderNode* node = graph.nodes_manager.get(handle);
 
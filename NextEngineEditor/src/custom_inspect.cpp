@@ -66,7 +66,7 @@ bool Shader_inspect(void* data, string_view prefix, Editor& editor) { //todo how
 
 bool render_asset_preview(AssetTab& asset_tab, AssetNode::Type type, uint* asset_handle, string_view prefix) {
 	AssetNode* node = NULL;
-	if (*asset_handle != INVALID_HANDLE && *asset_handle < MAX_ASSETS) node = asset_tab.info.asset_type_handle_to_node[type][*asset_handle]; //todo probably want reference to editor
+	if (*asset_handle != INVALID_HANDLE) node = get_asset_of_type(asset_tab.info, type, *asset_handle); //todo probably want reference to editor
 
     if (node) {
         preview_image(asset_tab.preview_resources, node->model.rot_preview, ImVec2(128, 128));
@@ -108,7 +108,7 @@ void* get_ptr(slice<ElementPtr> elements) {
         switch (element.type) {
             case ElementPtr::Component: {
                 World& world = *(World*)ptr;
-                ptr = world.id_to_ptr[element.component_id][element.id];
+                ptr = world.m_component_ptr(element.component_id, element.id);
                 break;
             }
             
@@ -127,7 +127,7 @@ void* get_ptr(slice<ElementPtr> elements) {
                 
             case ElementPtr::AssetNode: {
                 AssetInfo& info = *(AssetInfo*)ptr;
-                ptr = &info.asset_type_handle_to_node[element.component_id][element.id]->texture;
+                ptr = &get_asset_of_type(info, (AssetNode::Type)element.component_id, element.id)->texture;
                 break;
             }
                 
@@ -306,7 +306,7 @@ void create_components(World& world, EntityCopy* copy) {
 	std::swap(copy->from, copy->to);
 
 	for (EntityCopy::Component& component : copy->components) {
-		u8* ptr = (u8*)world.id_to_ptr[component.component_id][copy->id];
+		u8* ptr = (u8*)world.m_component_ptr(component.component_id, copy->id);
 		memcpy(ptr, component.ptr.data(), world.component_size[component.component_id]);
 
 		if (component.component_id == 0) {
@@ -227,7 +227,7 @@ void DisplayComponents::render(World& world, RenderPass& params, Editor& editor)
 		if (selected_id >= 0) {
 			auto name_and_id = tformat("Entity #", selected_id);
 
-			EntityNode* node = editor.lister.by_id[selected_id];
+			EntityNode* node = node_by_id(editor.lister, selected_id);
 			if (node) {
 				ImGui::InputText(name_and_id.c_str(), node->name);
 			}
@@ -245,7 +245,7 @@ void DisplayComponents::render(World& world, RenderPass& params, Editor& editor)
 				ComponentKind kind = world.component_kind[component_id];
 				refl::Struct* type = world.component_type[component_id];
 				if (kind != REGULAR_COMPONENT || !type) continue; //todo add editor support for component flags
-				void* data = world.id_to_ptr[component_id][selected_id];
+				void* data = world.m_component_ptr(component_id, selected_id);
 
 				ImGui::BeginGroup();
 				
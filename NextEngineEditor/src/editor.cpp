@@ -234,7 +234,7 @@ World& get_World(Editor& editor) {
 const char* scene_save_path = "data/world_save_file.ne";
 
 void recurisively_register_id(Lister& lister, EntityNode& node) {
-	lister.by_id[node.id] = &node;
+	node_slot(lister, node.id) = &node;
 
 	for (EntityNode& child : node.children) {
 		child.parent = node.id;
@@ -248,8 +248,11 @@ bool load_world(Editor& editor, DeserializerBuffer& buffer, const char** err) {
 
 	world.clear();
 
-	read_uint_from_buffer(buffer, world.free_ids.length);
-	read_n_from_buffer(buffer, world.free_ids.data, world.free_ids.length * sizeof(ID));
+	uint free_id_count;
+	read_uint_from_buffer(buffer, free_id_count);
+	ID* free_ids = TEMPORARY_ARRAY(ID, free_id_count);
+	read_n_from_buffer(buffer, free_ids, free_id_count * sizeof(ID));
+	world.entities.load_free_ids({ free_ids, free_id_count });
 
 	uint num_archetypes;
 	read_uint_from_buffer(buffer, num_archetypes);
@@ -273,12 +276,13 @@ bool load_world(Editor& editor, DeserializerBuffer& buffer, const char** err) {
 		uint entities = store.entity_count_last_block;
 
 		BlockHeader** next_block_chain = &store.blocks;
+		uint block_size = world.fitting_block_size(arch, store); //scenes keep the layout they were saved with
 
 		printf("=========\n");
 		printf("Loading archetype %i, Entities (%i), Block Header (%i)\n", arch, entities, store.block_count);
 
 		for (uint i = 0; i < store.block_count; i++) {
-			BlockHeader* block_header = world.alloc_block();
+			BlockHeader* block_header = world.alloc_block(block_size);
 			*next_block_chain = block_header;
 
 			u8* data = (u8*)(block_header + 1);
@@ -288,30 +292,19 @@ bool load_world(Editor& editor, DeserializerBuffer& buffer, const char** err) {
 					refl::Type* type = world.component_type[component_id];
 					printf("Component name %s\n", type ? type->name : "");
 					u8* base_component = data + store.offsets[component_id];
-					uint size = world.component_size[component_id];
 
 					if (auto constructor = funcs[component_id].constructor) constructor(base_component, entities); 
 
 					if (auto deserialize_non_trivial = funcs[component_id].deserialize) deserialize_non_trivial(buffer, base_component, entities);
 					else read_n_from_buffer(buffer, base_component, world.component_size[component_id] * entities);
-
-					for (uint i = 0; i < entities; i++) {
-						ID id = ((Entity*)(data + sizeof(Entity) * i))->id;
-						world.id_to_ptr[component_id][id] = base_component + size * i;
-					}
 				}
 			}
 
-			for (uint i = 0; i < entities; i++) {
-				ID id = ((Entity*)(data + sizeof(Entity) * i))->id;
-				world.id_to_arch[id] = arch;
-			}
-
 			next_block_chain = &block_header->next;
 			entities = store.max_per_block;
 		}
 
-		world.arches.set(arch, store);
+		world.insert_archetype(arch, store);
 	}
 
 	return true;
@@ -320,14 +313,31 @@ bool load_world(Editor& editor, DeserializerBuffer& buffer, const char** err) {
 bool load_scene_hierarchy(Lister& lister, DeserializerBuffer& buffer, const char** err) {
 	read_EntityNode_from_buffer(buffer, lister.root_node);
 
-	memset(lister.by_id, 0, sizeof(lister.by_id));
+	lister.by_id.clear();
 	recurisively_register_id(lister, lister.root_node);
 
 	return true;
 }
 
+template<typename T>
+void read_pod_vector_from_buffer(DeserializerBuffer& buffer, vector<T>& values) {
+	values.clear();
+	values.resize(read_uint_from_buffer(buffer));
+	read_n_from_buffer(buffer, values.data, sizeof(T) * values.length);
+}
+
+template<typename T>
+void write_pod_vector_to_buffer(SerializerBuffer& buffer, vector<T>& values) {
+	write_uint_to_buffer(buffer, values.length);
+	write_n_to_buffer(buffer, values.data, sizeof(T) * values.length);
+}
+
 bool load_scene_partition(Renderer& renderer, ScenePartition& partition, DeserializerBuffer& buffer, const char** err) {
-	read_n_from_buffer(buffer, &partition, sizeof(ScenePartition));
+	read_pod_vector_from_buffer(buffer, partition.bvh.nodes);
+	read_pod_vector_from_buffer(buffer, partition.bvh.indices);
+	read_pod_vector_from_buffer(buffer, partition.aabbs);
+	read_pod_vector_from_buffer(buffer, partition.meshes);
+	read_pod_vector_from_buffer(buffer, partition.model_m);
 
 	//todo this also has to save mesh buckets
 	//and generate the various pipelines
@@ -393,8 +403,9 @@ bool save_world(Editor& editor, SerializerBuffer& buffer, const char** err) {
 	World& world = get_World(editor);
 	ComponentLifetimeFunc* funcs = world.component_lifetime_funcs;
 
-	write_uint_to_buffer(buffer, world.free_ids.length);
-	write_n_to_buffer(buffer, world.free_ids.data, world.free_ids.length * sizeof(ID));
+	tvector<ID> free_ids = world.entities.free_ids();
+	write_uint_to_buffer(buffer, free_ids.length);
+	write_n_to_buffer(buffer, free_ids.data, free_ids.length * sizeof(ID));
 
 	uint num_archetypes = 0;
 	for (int i = 0; i < ARCHETYPE_HASH; i++) {
@@ -446,7 +457,11 @@ bool save_scene_hierarchy(Lister& lister, SerializerBuffer& buffer, const char**
 }
 
 bool save_scene_paritition(ScenePartition& partition, SerializerBuffer& buffer, const char** err) {
-	write_n_to_buffer(buffer, &partition, sizeof(ScenePartition));
+	write_pod_vector_to_buffer(buffer, partition.bvh.nodes);
+	write_pod_vector_to_buffer(buffer, partition.bvh.indices);
+	write_pod_vector_to_buffer(buffer, partition.aabbs);
+	write_pod_vector_to_buffer(buffer, partition.meshes);
+	write_pod_vector_to_buffer(buffer, partition.model_m);
 	return true;
 }
 
@@ -456,9 +471,10 @@ bool save_picking_scene_partition(PickingScenePartition& partition, SerializerBu
 }
 
 bool save_scene(Editor& editor, const char** err) {
+	LinearAllocator scene_allocator(LINEAR_VIRTUAL, gb(4));
+
 	SerializerBuffer buffer = {};
-	buffer.capacity = mb(10);
-	buffer.data = TEMPORARY_ARRAY(char, buffer.capacity);
+	buffer.allocator = &scene_allocator;
 
 	if (!save_world(editor, buffer, err)) return false;
 	if (!save_scene_hierarchy(editor.lister, buffer, err)) return false;
@@ -904,7 +920,7 @@ glm::vec3 Editor::place_at_cursor() {
 }
 
 void spawn_Model(World& world, Editor& editor, model_handle model_handle) { //todo maybe move to assetTab
-	AssetNode* node = editor.asset_info.asset_type_handle_to_node[AssetNode::Model][model_handle.id];
+	AssetNode* node = get_asset_of_type(editor.asset_info, AssetNode::Model, model_handle.id);
 	ModelAsset* model_asset = node ? &node->model : nullptr;
 		
 	if (model_asset) {
@@ -1266,9 +1282,7 @@ void respond_to_framediffs(Editor& editor) {
 		Renderer& renderer = editor.renderer;
 		bool is_static = true;
 
-		renderer.scene_partition.node_count = 0;
 		editor.picking.partition.node_count = 0;
-		renderer.scene_partition.count = 0;
 		editor.picking.partition.count = 0;
 
 		editor.picking.rebuild_acceleration_structure(editor.world);
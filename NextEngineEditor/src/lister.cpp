@@ -24,7 +24,16 @@ struct AddChild {
 
 EntityNode* node_by_id(Lister& lister, ID id) {
     if (id == 0) return &lister.root_node;
-    else return lister.by_id[id];
+    
+    uint index = entity_index(id);
+    EntityNode* node = index < lister.by_id.length ? lister.by_id[index] : nullptr;
+    return node && node->id == id ? node : nullptr; //a stale id of a reused index finds nothing
+}
+
+EntityNode*& node_slot(Lister& lister, ID id) {
+    uint index = entity_index(id);
+    if (index >= lister.by_id.length) lister.by_id.resize(index + 1);
+    return lister.by_id[index];
 }
 
 void render_hierarchy(tvector<AddChild>& defer_add_child, EntityNode& node, Editor& editor, int indent = 0) {
@@ -125,7 +134,7 @@ void remove_child(Lister& lister, EntityNode* child) {
 	uint index = child - parent->children.data; //todo merge this function with remove folder
 	for (uint i = index; i < parent->children.length - 1; i++) {
 		parent->children[i] = std::move(parent->children[i + 1]);
-		lister.by_id[parent->children[i].id] = parent->children.data + i;
+		node_slot(lister, parent->children[i].id) = parent->children.data + i;
 	}
 
 	parent->children.length--;
@@ -138,11 +147,11 @@ void add_child_in_lister(Lister& lister, EntityNode& parent, EntityNode&& child)
 	parent.children.append(std::move(child));
 
 	if (capacity == parent.children.capacity) { //NO RESIZE
-		lister.by_id[child.id] = &parent.children.last();
+		node_slot(lister, child.id) = &parent.children.last();
 	}
 	else { //RESIZE MEANING POINTERS ARE INVALIDATED!
 		for (EntityNode& children : parent.children) {
-			lister.by_id[children.id] = &children;
+			node_slot(lister, children.id) = &children;
 		}
 	}
 }
@@ -174,7 +183,7 @@ void add_child(Lister& lister, World& world, ID parent, EntityNode&& child_node)
 }
 
 void add_child(Lister& lister, World& world, ID parent, ID child) {
-	EntityNode* child_ptr = lister.by_id[child];
+	EntityNode* child_ptr = node_by_id(lister, child);
 	EntityNode child_node = std::move(*child_ptr);
 	remove_child(lister, child_ptr);
 
@@ -193,7 +202,7 @@ EntityNode remove_child(Lister& lister, EntityNode& parent, ID id) {
 	for (uint i = position; i + 1 < parent.children.length; i++) {
 		EntityNode& insert_at = parent.children[i];
 		insert_at = std::move(parent.children[i + 1]);
-		lister.by_id[insert_at.id] = &insert_at;
+		node_slot(lister, insert_at.id) = &insert_at;
 	}
 	parent.children.length--;
 
@@ -261,7 +270,7 @@ void create_object_popup(Editor& editor, World& world, material_handle default_m
 }
 
 Lister::Lister() {
-    by_id[0] = &root_node; //self-referential do not move lister!
+    by_id.append(&root_node); //self-referential do not move lister!
 }
 
 void clone_entity(Lister& lister, World& world, ID parent, EntityNode& node) {
@@ -299,12 +308,12 @@ void Lister::render(World& world, Editor& editor, RenderPass& params) {
 		if (filter.starts_with("#")) {
 			auto splice = filter.sub(1, filter.size());
 
-			ID id;
-			if (!string_to_uint(splice, &id) || (id < 0 || id >= MAX_ENTITIES)) {
+			ID id = 0;
+			if (!string_to_uint(splice, &id)) {
 				ImGui::Text("Please enter a valid ID");
 			}
 
-			EntityNode* e = by_id[id]; 
+			EntityNode* e = node_by_id(*this, id);
 			if (e) filter_root = e;
 			else ImGui::Text("Gameobject with id not found");
 		} 
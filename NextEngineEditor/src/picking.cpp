@@ -132,7 +132,7 @@ void build_acceleration_structure(PickingScenePartition& scene_partition, World&
 	tvector<uint> tags;
 
 	//todo only generate bvh for static elements
-	for (auto [e, trans, model_renderer] : world.filter<Transform, ModelRenderer>()) {
+	for (auto [e, trans, model_renderer] : world.filter<const Transform, const ModelRenderer>()) {
 		auto model_m = compute_model_matrix(trans);
 
 		Model* model = get_Model(model_renderer.model_id);		
@@ -145,7 +145,7 @@ void build_acceleration_structure(PickingScenePartition& scene_partition, World&
 		tags.append(0);
 	}
 
-	for (auto[e, trans, control] : world.filter<Transform, TerrainControlPoint>()) {
+	for (auto[e, trans, control] : world.filter<const Transform, TerrainControlPoint>()) {
 		AABB aabb;
 		aabb.min = trans.position + glm::vec3(-0.5, -0.5, -0.5);
 		aabb.max = trans.position + glm::vec3(0.5, 0.5, 0.5);
@@ -156,7 +156,7 @@ void build_acceleration_structure(PickingScenePartition& scene_partition, World&
 		tags.append(GIZMO_TAG);
 	}
 
-	for (auto[e, trans, control] : world.filter<Transform, TerrainSplat>()) {
+	for (auto[e, trans, control] : world.filter<const Transform, TerrainSplat>()) {
 		AABB aabb;
 		aabb.min = trans.position + glm::vec3(-0.5, -0.5, -0.5);
 		aabb.max = trans.position + glm::vec3(0.5, 0.5, 0.5);
@@ -166,7 +166,7 @@ void build_acceleration_structure(PickingScenePartition& scene_partition, World&
 		ids.append(e.id);
 		tags.append(GIZMO_TAG);
 	}
-	for (auto[e, trans, terrain] : world.filter<Transform, Terrain>()) {
+	for (auto[e, trans, terrain] : world.filter<const Transform, Terrain>()) {
 		auto model_m = compute_model_matrix(trans);
 
 		uint width = terrain.width;
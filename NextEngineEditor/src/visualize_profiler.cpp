@@ -1,7 +1,9 @@
 #include <imgui/imgui.h>
 #include "visualize_profiler.h"
 #include "core/profiler.h"
+#include "core/trace.h"
 #include "core/memory/linear_allocator.h"
+#include "core/memory/memory_tracking.h"
 #include "core/container/hash_map.h"
 #include "core/container/sstring.h"
 #include <stdio.h>
@@ -72,6 +74,46 @@ ProfileDrawData draw_profile(ProfileCtx& ctx, uint frame, const ProfileData& pro
 	return data;
 }
 
+#define mb_f(bytes) ((double)(bytes) / (1024.0 * 1024.0))
+
+void render_memory_stats() {
+	ImGui::Columns(5);
+	ImGui::Text("Tag"); ImGui::NextColumn();
+	ImGui::Text("Allocated"); ImGui::NextColumn();
+	ImGui::Text("High water"); ImGui::NextColumn();
+	ImGui::Text("Allocations"); ImGui::NextColumn();
+	ImGui::Text("Budget"); ImGui::NextColumn();
+
+	for (uint tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+		MemoryStats stats = get_memory_stats((MemoryTag)tag);
+		if (stats.high_water == 0) continue;
+
+		ImGui::Text("%s", memory_tag_name((MemoryTag)tag)); ImGui::NextColumn();
+		ImGui::Text("%.2f mb", mb_f(stats.allocated)); ImGui::NextColumn();
+		ImGui::Text("%.2f mb", mb_f(stats.high_water)); ImGui::NextColumn();
+		ImGui::Text("%llu", (unsigned long long)stats.allocations); ImGui::NextColumn();
+		if (stats.budget) ImGui::Text("%.2f mb", mb_f(stats.budget));
+		else ImGui::Text("-");
+		ImGui::NextColumn();
+	}
+
+	ImGui::Columns(3);
+	ImGui::Separator();
+	ImGui::Text("Temporary"); ImGui::NextColumn();
+	ImGui::Text("Last frame peak"); ImGui::NextColumn();
+	ImGui::Text("High water"); ImGui::NextColumn();
+
+	for (uint worker = 0; worker < worker_thread_count(); worker++) {
+		TemporaryMemoryStats stats = get_temporary_memory_stats(worker);
+
+		ImGui::Text("Worker %u", worker); ImGui::NextColumn();
+		ImGui::Text("%.2f mb", mb_f(stats.last_frame_peak)); ImGui::NextColumn();
+		ImGui::Text("%.2f mb", mb_f(stats.high_water)); ImGui::NextColumn();
+	}
+
+	ImGui::Columns(1);
+}
+
 void VisualizeProfiler::render(struct World& world, struct Editor& editor, struct RenderPass& ctx) {
 	ImGui::PushStyleVar(ImGuiStyleVar_WindowBorderSize, 1.0f);
 	if (ImGui::Begin("Profiler", NULL)) {
@@ -91,6 +133,18 @@ void VisualizeProfiler::render(struct World& world, struct Editor& editor, struc
 				if (ImGui::Button("Pause")) Profiler::paused = true;
 			}
 
+			ImGui::SameLine();
+
+			if (is_tracing()) {
+				if (ImGui::Button("Save Trace")) {
+					export_chrome_trace("trace.json");
+					end_tracing();
+				}
+			}
+			else {
+				if (ImGui::Button("Record Trace")) begin_tracing();
+			}
+
             ImGui::SameLine(); //ImGui::GetContentRegionAvailWidth());
 		}
 
@@ -257,6 +311,8 @@ void VisualizeProfiler::render(struct World& world, struct Editor& editor, struc
 
 
 		//ImGui::PlotLines("FPS", fps_times.data, fps_times.length, 0, NULL, 0, 70, ImVec2(300, 240));
+
+		if (ImGui::CollapsingHeader("Memory")) render_memory_stats();
 	}
 
 	ImGui::PopStyleVar();
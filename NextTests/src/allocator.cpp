@@ -0,0 +1,34 @@
+#include "test.h"
+#include "core/memory/allocator.h"
+
+static bool is_aligned(void* ptr, uint alignment) {
+	return (u64)ptr % alignment == 0;
+}
+
+//Every size class and the malloc path keep MAX_ALLOCATOR_ALIGNMENT, larger alignments are rounded up to a class
+TEST(slab_allocator_alignment) {
+	const uint SIZES[] = { 1, 16, 17, 80, 100, 129, 160, 200, 1000, 3000, 8192, 8193, 100000 };
+	const uint ALIGNMENTS[] = { 1, 16, 32, 64, 128, 4096 };
+
+	for (uint size : SIZES) {
+		void* ptr = default_allocator.allocate(size);
+		CHECK(is_aligned(ptr, MAX_ALLOCATOR_ALIGNMENT));
+		memset(ptr, 0xff, size);
+		default_allocator.deallocate(ptr);
+
+		for (uint alignment : ALIGNMENTS) {
+			void* blocks[4];
+			for (void*& block : blocks) {
+				block = default_allocator.allocate(size, alignment);
+				CHECK(is_aligned(block, alignment));
+				memset(block, 0xff, size);
+			}
+			for (void* block : blocks) default_allocator.deallocate(block);
+		}
+	}
+
+	struct alignas(64) Padded { u8 value[80]; };
+	Padded* padded = ALLOC(Padded);
+	CHECK(is_aligned(padded, 64));
+	default_allocator.deallocate(padded);
+}
@@ -0,0 +1,79 @@
+#include "test.h"
+#include "core/container/bitset.h"
+#include "core/simd.h"
+
+static u64 next_random(u64& state) {
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+//Every level has to match a plain word loop, sizes straddle the AVX2 threshold and leave remainders for each path
+TEST(bitset_ops_match_across_simd_levels) {
+	const uint MAX_WORDS = 3 * BITS_AVX2_WORDS + 3;
+	const SimdLevel LEVELS[] = { SIMD_SCALAR, SIMD_SSE2, SIMD_SSE4, SIMD_AVX2 };
+
+	SimdLevel detected = detect_simd_level();
+	u64 state = 0x9e3779b97f4a7c15ull;
+
+	for (SimdLevel level : LEVELS) {
+		if (level > detected) continue;
+		set_simd_level(level);
+
+		for (uint words = 0; words <= MAX_WORDS; words++) {
+			u64 a[MAX_WORDS], b[MAX_WORDS];
+			for (uint i = 0; i < words; i++) {
+				a[i] = next_random(state);
+				b[i] = next_random(state);
+			}
+
+			u64 expected[4][MAX_WORDS];
+			uint expected_count = 0;
+			for (uint i = 0; i < words; i++) {
+				expected[0][i] = a[i] | b[i];
+				expected[1][i] = a[i] & b[i];
+				expected[2][i] = a[i] ^ b[i];
+				expected[3][i] = a[i] & ~b[i];
+				expected_count += count_bits(a[i]);
+			}
+
+			u64 result[4][MAX_WORDS];
+			for (uint op = 0; op < 4; op++) memcpy(result[op], a, sizeof(u64) * words);
+
+			bits_or(result[0], b, words);
+			bits_and(result[1], b, words);
+			bits_xor(result[2], b, words);
+			bits_andnot(result[3], b, words);
+
+			for (uint op = 0; op < 4; op++) CHECK(memcmp(result[op], expected[op], sizeof(u64) * words) == 0);
+			CHECK(bits_count(a, words) == expected_count);
+		}
+	}
+
+	set_simd_level(detected);
+}
+
+TEST(dynamic_bitset_find_and_iterate) {
+	dynamic_bitset bits(1000);
+	const uint SET[] = { 0, 63, 64, 65, 500, 998, 999 };
+	for (uint i : SET) bits.set(i);
+
+	CHECK(bits.count() == 7);
+	CHECK(bits.count(64, 999) == 4);
+
+	uint visited = 0;
+	for (uint i : bits) CHECK(i == SET[visited++]);
+	CHECK(visited == 7);
+
+	CHECK(bits.find_next(1) == 63);
+	CHECK(bits.find_next(501) == 998);
+
+	dynamic_bitset all(1000);
+	all.set_all();
+	CHECK(all.count() == 1000);
+
+	all.andnot(bits);
+	CHECK(all.count() == 993);
+	CHECK(!all.get(500) && all.get(501));
+}
@@ -0,0 +1,194 @@
+#include "test.h"
+#include "ecs/command_buffer.h"
+#include <string.h>
+
+struct Health { int value; };
+struct Name { const char* value; };
+struct alignas(64) Wide { float lanes[16]; };
+struct Tag { int value; };
+
+DEFINE_APP_COMPONENT_ID(Health, 1)
+DEFINE_APP_COMPONENT_ID(Name, 2)
+DEFINE_APP_COMPONENT_ID(Wide, 3)
+DEFINE_APP_COMPONENT_ID(Tag, 4)
+
+template<typename T>
+static void register_test_component(World& world) {
+	world.component_size[component_id<T>()] = sizeof(T);
+	world.component_alignment[component_id<T>()] = alignof(T);
+}
+
+static World* make_test_world() {
+	World* world = new World(mb(16));
+	world->component_size[0] = sizeof(Entity);
+	register_test_component<Health>(*world);
+	register_test_component<Name>(*world);
+	register_test_component<Wide>(*world);
+	register_test_component<Tag>(*world);
+	return world;
+}
+
+static ID make_with_health(World& world, int value) {
+	auto [e, health] = world.make<Health>();
+	health.value = value;
+	return e.id;
+}
+
+//One buffer recording every kind of command, on existing and on pending entities
+TEST(command_buffer_mixed_playback) {
+	World& world = *make_test_world();
+	EntityCommandBuffer buffer;
+
+	ID named = make_with_health(world, 1);
+	ID unhealthy = make_with_health(world, 2);
+	ID freed = make_with_health(world, 3);
+	ID ordered = make_with_health(world, 4);
+	ID renamed = make_with_health(world, 5);
+
+	//Commands on a pending id fold into the archetype it is made with, the removed Tag is never added
+	ID made = buffer.make<Health>();
+	CHECK(made & PENDING_ID_BIT);
+	buffer.add(made, Health{ 7 });
+	buffer.add(made, Name{ "made" });
+	buffer.add(made, Tag{ 1 });
+	buffer.remove<Tag>(made);
+
+	//Made and freed in the same playback, the over aligned payload still sits on its alignment in the chunk
+	ID made_and_freed = buffer.make();
+	Wide wide = {};
+	for (uint i = 0; i < 16; i++) wide.lanes[i] = (float)i;
+	buffer.add(made_and_freed, wide);
+	buffer.free(made_and_freed);
+
+	buffer.add(named, Name{ "named" });
+	buffer.remove<Health>(unhealthy);
+	buffer.free(freed);
+
+	//Higher keys run later no matter the order they were recorded in
+	buffer.sort_key = 2;
+	buffer.add(ordered, Health{ 2 });
+	buffer.sort_key = 1;
+	buffer.add(ordered, Health{ 1 });
+
+	buffer.sort_key = 4;
+	buffer.remove<Name>(renamed);
+	buffer.sort_key = 3;
+	buffer.add(renamed, Name{ "renamed" });
+
+	uint wide_payloads = 0;
+	for (EntityCommand& command : buffer.commands) {
+		if (command.type != ADD_COMPONENT_COMMAND || command.component != component_id<Wide>()) continue;
+		CHECK((u64)command.payload % alignof(Wide) == 0);
+		wide_payloads++;
+	}
+	CHECK(wide_payloads == 1);
+
+	playback(world, buffer);
+	CHECK(buffer.empty());
+
+	CHECK(world.arch_of_id(named) == to_archetype<Health, Name>());
+	CHECK(strcmp(world.by_id<Name>(named)->value, "named") == 0);
+
+	CHECK(world.arch_of_id(unhealthy) == to_archetype<>());
+	CHECK(!world.is_alive(freed));
+
+	CHECK(world.by_id<Health>(ordered)->value == 2);
+	CHECK(world.arch_of_id(renamed) == to_archetype<Health>());
+
+	uint made_count = 0;
+	for (auto [e, health, name] : world.filter<Health, Name>()) {
+		if (e.id == named) continue;
+
+		made_count++;
+		CHECK(!(e.id & PENDING_ID_BIT));
+		CHECK(world.is_alive(e.id));
+		CHECK(world.arch_of_id(e.id) == to_archetype<Health, Name>());
+		CHECK(health.value == 7);
+		CHECK(strcmp(name.value, "made") == 0);
+	}
+	CHECK(made_count == 1);
+
+	uint wide_count = 0;
+	for (auto [e, wide] : world.filter<Wide>()) wide_count++;
+	CHECK(wide_count == 0);
+
+	delete &world;
+}
+
+//Jobs record into the buffer of their worker, playback merges them by sort key
+TEST(command_buffer_parallel_recording) {
+	const uint COUNT = 2000;
+
+	World& world = *make_test_world();
+	EntityCommandBuffers& buffers = *new EntityCommandBuffers();
+
+	for (uint i = 0; i < COUNT; i++) make_with_health(world, i);
+
+	world.parallel_for_each_chunk<const Health>(EntityQuery(), [&](uint count, const Entity* entities, const Health* health) {
+		EntityCommandBuffer& buffer = buffers.local();
+
+		for (uint i = 0; i < count; i++) {
+			buffer.sort_key = health[i].value;
+
+			if (health[i].value % 4 == 0) {
+				buffer.free(entities[i].id);
+			}
+			else if (health[i].value % 4 == 1) {
+				ID spawned = buffer.make<Tag>();
+				buffer.add(spawned, Tag{ health[i].value });
+			}
+			else if (health[i].value % 4 == 2) {
+				buffer.add(entities[i].id, Wide{});
+			}
+		}
+	}, 4);
+
+	playback(world, buffers);
+	for (EntityCommandBuffer& buffer : buffers.buffers) CHECK(buffer.empty());
+
+	uint healthy = 0, wide = 0, tags = 0;
+	for (auto [e, health] : world.filter<Health>()) {
+		healthy++;
+		CHECK(health.value % 4 != 0);
+		CHECK(has_component(world.arch_of_id(e.id), component_id<Wide>()) == (health.value % 4 == 2));
+	}
+	for (auto [e, w] : world.filter<Wide>()) wide++;
+
+	for (auto [e, tag] : world.filter<Tag>()) {
+		tags++;
+		CHECK(tag.value % 4 == 1);
+		CHECK(world.arch_of_id(e.id) == to_archetype<Tag>());
+	}
+
+	CHECK(healthy == COUNT - COUNT / 4);
+	CHECK(wide == COUNT / 4);
+	CHECK(tags == COUNT / 4);
+
+	delete &buffers;
+	delete &world;
+}
+
+//Reusing one index until its generation runs out retires the slot, so no stale id ever finds the entity living there
+TEST(entity_table_generation_wrap) {
+	EntityTable table;
+	BlockHeader* block = (BlockHeader*)&table; //only compared against null
+
+	ID first = table.make_id();
+	ID id = first;
+	vector<ID> stale;
+
+	for (uint i = 0; i <= ENTITY_GENERATION_MASK; i++) {
+		table[entity_index(id)].block = block;
+		CHECK(table.find(id));
+		for (ID old : stale) CHECK(!table.find(old));
+
+		table.free_id(id);
+		stale.append(id);
+		id = table.make_id();
+	}
+
+	CHECK(entity_index(id) != entity_index(first));
+	CHECK(table.retired_indices.length == 1);
+	table[entity_index(id)].block = block;
+	for (ID old : stale) CHECK(!table.find(old));
+}
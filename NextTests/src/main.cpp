@@ -0,0 +1,62 @@
+#include "test.h"
+#include "core/job_system/job.h"
+#include "core/job_system/fiber.h"
+#include "core/memory/linear_allocator.h"
+#include "core/context.h"
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+//usage: NextTests [name]
+//Runs every test, or only those whose name contains the argument.
+
+static TestCase* first_test;
+static TestCase* last_test;
+static std::atomic<uint> failed_checks;
+
+void register_test(TestCase* test) {
+	if (last_test) last_test->next = test;
+	else first_test = test;
+	last_test = test;
+}
+
+void check_failed(const char* expr, const char* file, int line) {
+	fprintf(stderr, "%s:%i: CHECK(%s) failed\n", file, line, expr);
+	failed_checks++;
+}
+
+int main(int argc, char** argv) {
+	const char* filter = argc > 1 ? argv[1] : nullptr;
+
+	make_job_system(20);
+	convert_thread_to_fiber();
+
+	LinearAllocator temporary_allocator(mb(10));
+	Context& context = get_context();
+	context.allocator = &default_allocator;
+	context.temporary_allocator = &temporary_allocator;
+
+	uint run = 0;
+	uint failed = 0;
+
+	for (TestCase* test = first_test; test; test = test->next) {
+		if (filter && !strstr(test->name, filter)) continue;
+
+		uint failed_before = failed_checks;
+		test->func();
+		temporary_allocator.clear();
+
+		bool passed = failed_checks == failed_before;
+		printf("%s %s\n", passed ? "ok  " : "FAIL", test->name);
+
+		run++;
+		if (!passed) failed++;
+	}
+
+	printf("%u of %u tests passed\n", run - failed, run);
+
+	convert_fiber_to_thread();
+	destroy_job_system();
+
+	return failed;
+}
@@ -0,0 +1,70 @@
+#include "test.h"
+#include "core/math/model_matrices.h"
+#include "core/simd.h"
+#include <math.h>
+
+static float next_float(u64& state, float min, float max) {
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return min + (max - min) * (float)(state >> 40) / (float)(1 << 24);
+}
+
+static bool nearly_equal(const float* a, const float* b, uint count) {
+	for (uint i = 0; i < count; i++) {
+		if (fabsf(a[i] - b[i]) > 1e-5f * fmaxf(1.0f, fabsf(b[i]))) return false;
+	}
+	return true;
+}
+
+//Every level has to match the scalar lanes, counts leave remainders for the AVX, SSE and scalar paths
+TEST(model_matrices_match_across_simd_levels) {
+	const uint MAX_COUNT = 2 * 8 + 7;
+	const SimdLevel LEVELS[] = { SIMD_SSE2, SIMD_SSE4, SIMD_AVX2 };
+
+	float position[3][MAX_COUNT], rotation[4][MAX_COUNT], scale[3][MAX_COUNT];
+	u64 state = 0x9e3779b97f4a7c15ull;
+
+	for (uint i = 0; i < MAX_COUNT; i++) {
+		float q[4], length = 0.0f;
+		for (uint j = 0; j < 4; j++) {
+			q[j] = next_float(state, -1.0f, 1.0f);
+			length += q[j] * q[j];
+		}
+		for (uint j = 0; j < 4; j++) rotation[j][i] = q[j] / sqrtf(length);
+
+		for (uint j = 0; j < 3; j++) {
+			position[j][i] = next_float(state, -100.0f, 100.0f);
+			scale[j][i] = next_float(state, 0.1f, 10.0f);
+		}
+	}
+
+	TransformArrays arrays = {
+		{ position[0], position[1], position[2] },
+		{ rotation[0], rotation[1], rotation[2], rotation[3] },
+		{ scale[0], scale[1], scale[2] }
+	};
+
+	glm::mat4 expected4[MAX_COUNT], result4[MAX_COUNT];
+	glm::mat4x3 expected3[MAX_COUNT], result3[MAX_COUNT];
+
+	SimdLevel detected = detect_simd_level();
+
+	for (uint count = 0; count <= MAX_COUNT; count++) {
+		set_simd_level(SIMD_SCALAR);
+		compute_model_matrices(expected4, arrays, count);
+		compute_model_matrices(expected3, arrays, count);
+
+		for (SimdLevel level : LEVELS) {
+			if (level > detected) continue;
+			set_simd_level(level);
+
+			compute_model_matrices(result4, arrays, count);
+			compute_model_matrices(result3, arrays, count);
+			CHECK(nearly_equal((float*)result4, (float*)expected4, count * 16));
+			CHECK(nearly_equal((float*)result3, (float*)expected3, count * 12));
+		}
+	}
+
+	set_simd_level(detected);
+}
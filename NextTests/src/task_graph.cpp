@@ -0,0 +1,81 @@
+#include "test.h"
+#include "core/job_system/task_graph.h"
+#include <atomic>
+
+//Every task records when it ran and how often, so the order can be checked against the edges afterwards
+struct OrderedTask {
+	std::atomic<uint>* clock;
+	uint order;
+	uint runs;
+};
+
+static void run_ordered_task(OrderedTask& task) {
+	task.order = (*task.clock)++;
+	task.runs++;
+}
+
+static void reset_tasks(OrderedTask* tasks, uint count) {
+	for (uint i = 0; i < count; i++) tasks[i].runs = 0;
+}
+
+//Every predecessor of every node finished before the node started
+static void check_order(TaskGraph& graph, OrderedTask* tasks, uint runs) {
+	for (task_handle handle = 0; handle < graph.nodes.length; handle++) {
+		TaskNode& node = graph.nodes[handle];
+		CHECK(tasks[handle].runs == runs);
+
+		for (uint i = 0; i < node.predecessor_count; i++) {
+			task_handle predecessor = graph.predecessors[node.predecessor_offset + i];
+			CHECK(tasks[predecessor].order < tasks[handle].order);
+		}
+	}
+}
+
+//Diamond a -> b, c -> d, then d fans out to many tasks which all fan into one
+TEST(task_graph_diamond_fan_in) {
+	const uint FAN = 64;
+	const uint REPEAT = 100;
+
+	std::atomic<uint> clock = 0;
+	OrderedTask tasks[FAN + 6] = {};
+	for (OrderedTask& task : tasks) task.clock = &clock;
+
+	TaskGraph graph;
+	task_handle a = add_task(graph, run_ordered_task, tasks + 0);
+	task_handle b = add_task(graph, run_ordered_task, tasks + 1, { a });
+	task_handle c = add_task(graph, run_ordered_task, tasks + 2, { a });
+	task_handle bc[] = { b, c };
+	task_handle d = add_task(graph, run_ordered_task, tasks + 3, { bc, 2 });
+
+	task_handle fan[FAN];
+	for (uint i = 0; i < FAN; i++) fan[i] = add_task(graph, run_ordered_task, tasks + 4 + i, { d });
+	task_handle join = add_task(graph, run_ordered_task, tasks + 4 + FAN, { fan, FAN });
+
+	CHECK(join == FAN + 4);
+
+	//Rescheduling reuses the pending counters
+	for (uint i = 0; i < REPEAT; i++) run_task_graph(graph, PRIORITY_HIGH);
+	check_order(graph, tasks, REPEAT);
+
+	//Growing the graph reallocates them, the new task depends on tasks of both halves of the graph
+	reset_tasks(tasks, FAN + 6);
+	task_handle join_and_b[] = { join, b };
+	add_task(graph, run_ordered_task, tasks + 5 + FAN, { join_and_b, 2 });
+
+	run_task_graph(graph, PRIORITY_HIGH);
+	check_order(graph, tasks, 1);
+
+	//A cleared graph starts from handle 0 again
+	clear_task_graph(graph);
+	reset_tasks(tasks, FAN + 6);
+
+	task_handle first = add_task(graph, run_ordered_task, tasks + 0);
+	task_handle second = add_task(graph, run_ordered_task, tasks + 1, { first });
+	task_handle both[] = { first, second };
+	add_task(graph, run_ordered_task, tasks + 2, { both, 2 });
+
+	CHECK(first == 0);
+	run_task_graph(graph, PRIORITY_HIGH);
+	check_order(graph, tasks, 1);
+	for (uint i = 3; i < FAN + 6; i++) CHECK(tasks[i].runs == 0);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "core/core.h"
+
+//TESTS
+//Every TEST registers itself before main runs. main runs them one after another on a thread converted to
+//a fiber, with the job system running, and exits with the number of failed tests, so scripts can gate on it.
+//CHECK can be used from jobs on any worker.
+
+struct TestCase {
+	const char* name;
+	void(*func)();
+	TestCase* next;
+};
+
+void register_test(TestCase* test);
+void check_failed(const char* expr, const char* file, int line);
+
+struct TestRegistrar {
+	TestRegistrar(TestCase* test) { register_test(test); }
+};
+
+#define TEST(name) \
+	static void test_##name(); \
+	static TestCase test_case_##name = { #name, test_##name, nullptr }; \
+	static TestRegistrar test_registrar_##name(&test_case_##name); \
+	static void test_##name()
+
+//Variadic so expressions with template argument lists need no extra parentheses
+#define CHECK(...) do { if (!(__VA_ARGS__)) check_failed(#__VA_ARGS__, __FILE__, __LINE__); } while (0)
@@ -0,0 +1,49 @@
+#include "test.h"
+#include "core/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+static char* read_trace(const char* path) {
+	FILE* file = fopen(path, "rb");
+	if (!file) return nullptr;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	char* data = (char*)malloc(size + 1);
+	data[fread(data, 1, size, file)] = '\0';
+	fclose(file);
+	return data;
+}
+
+//Editor and IO threads are not job workers, their events are dropped instead of written to a worker's ring
+TEST(trace_event_from_non_worker_thread) {
+	const char* path = "NextTests_trace.json";
+
+	begin_tracing();
+
+	std::thread thread([] {
+		trace_event(TRACE_SCOPE_BEGIN, "non_worker_scope");
+		trace_event(TRACE_SCOPE_END, "non_worker_scope");
+	});
+	thread.join();
+
+	trace_event(TRACE_SCOPE_BEGIN, "worker_scope");
+	trace_event(TRACE_SCOPE_END, "worker_scope");
+	end_tracing();
+
+	CHECK(export_chrome_trace(path));
+
+	char* trace = read_trace(path);
+	CHECK(trace);
+	if (trace) {
+		CHECK(strstr(trace, "\"worker_scope\""));
+		CHECK(!strstr(trace, "non_worker_scope"));
+	}
+
+	free(trace);
+	remove(path);
+}
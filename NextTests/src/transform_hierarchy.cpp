@@ -0,0 +1,60 @@
+#include "test.h"
+#include "components/transform.h"
+#include "ecs/ecs.h"
+
+static World* make_transform_world() {
+	World* world = new World(mb(16));
+	world->component_size[0] = sizeof(Entity);
+	world->component_size[component_id<Transform>()] = sizeof(Transform);
+	world->component_alignment[component_id<Transform>()] = alignof(Transform);
+	world->component_size[component_id<LocalTransform>()] = sizeof(LocalTransform);
+	world->component_alignment[component_id<LocalTransform>()] = alignof(LocalTransform);
+	return world;
+}
+
+static ID make_child(World& world, ID owner, float x) {
+	auto [e, trans, local] = world.make<Transform, LocalTransform>();
+	local.position.x = x;
+	local.owner = owner;
+	return e.id;
+}
+
+//Root -> child -> grandchild, each child one unit further along x than its owner
+TEST(transform_hierarchy_overwrites_children) {
+	World& world = *make_transform_world();
+
+	auto [root_e, root] = world.make<Transform>();
+	ID root_id = root_e.id;
+	root.position.x = 10.0f;
+
+	ID child = make_child(world, root_id, 1.0f);
+	ID grandchild = make_child(world, child, 1.0f);
+
+	TransformHierarchy& hierarchy = *new TransformHierarchy();
+	hierarchy.rebuild(world, EntityQuery());
+	hierarchy.propagate(world, true);
+
+	CHECK(hierarchy.nodes.length == 2 && hierarchy.levels.length == 3); //the root has no LocalTransform, so it isn't a node
+	CHECK(world.by_id<Transform>(child)->position.x == 11.0f);
+	CHECK(world.by_id<Transform>(grandchild)->position.x == 12.0f);
+
+	//Moving the root moves the whole subtree
+	world.m_by_id<Transform>(root_id)->position.x = 20.0f;
+	hierarchy.propagate(world, false);
+	CHECK(world.by_id<Transform>(child)->position.x == 21.0f);
+	CHECK(world.by_id<Transform>(grandchild)->position.x == 22.0f);
+
+	//A child Transform written directly is overwritten by the next update, and so are its children
+	world.m_by_id<Transform>(child)->position.x = -5.0f;
+	world.m_by_id<Transform>(grandchild)->position.x = -5.0f;
+	hierarchy.propagate(world, false);
+	CHECK(world.by_id<Transform>(child)->position.x == 21.0f);
+	CHECK(world.by_id<Transform>(grandchild)->position.x == 22.0f);
+
+	//Nothing written, nothing propagated
+	hierarchy.propagate(world, false);
+	for (bool changed : hierarchy.changed) CHECK(!changed);
+
+	delete &hierarchy;
+	delete &world;
+}
@@ -7,6 +7,8 @@
 #include "graphics/rhi/rhi.h"
 #include "engine/vfs.h"
 #include "core/container/hash_map.h"
+#include "core/container/handle_manager.h"
+#include "core/memory/memory_tracking.h"
 #include "graphics/assets/assets.h"
 
 const uint MAX_UI_TEXTURES = 16;
@@ -29,7 +31,7 @@ struct UIRenderer {
 UIRenderer* make_ui_renderer() {
     //LOAD SHADERS
     
-    UIRenderer* renderer = PERMANENT_ALLOC(UIRenderer);
+    UIRenderer* renderer = TAGGED_ALLOC(MEMORY_UI, UIRenderer);
     
     shader_handle shader = load_Shader("shaders/imgui_shader.vert", "shaders/imgui_shader.frag");
 
@@ -118,8 +120,8 @@ void submit_draw_data(UIRenderer& renderer, CommandBuffer& cmd_buffer, UIDrawDat
     for (const UICmdBuffer& cmd_list : data.layers) {
         for (const UICmd& cmd : cmd_list.cmds) {
             combined_samplers[cmd.texture.id].texture = cmd.texture;
-            //todo eleminate magic value
-            if (cmd.texture.id > 100) combined_samplers[cmd.texture.id].sampler = renderer.sampler;
+            //Imported images are filtered, textures created at runtime such as the font atlas stay nearest
+            if (is_serialized_handle(cmd.texture.id)) combined_samplers[cmd.texture.id].sampler = renderer.sampler;
         }
     }
 
@@ -12,6 +12,7 @@
 #include "ui/layout.h"
 #include "graphics/assets/texture.h"
 #include "core/memory/linear_allocator.h"
+#include "core/memory/memory_tracking.h"
 #include "core/container/hash_map.h"
 #include "core/container/handle_manager.h"
 #include "engine/input.h"
@@ -20,7 +21,7 @@
 #include "core/math/vec3.h"
 
 UI* make_ui() {
-    UI* ui = PERMANENT_ALLOC(UI);
+    UI* ui = TAGGED_ALLOC(MEMORY_UI, UI);
     ui->renderer = make_ui_renderer();
     ui->allocator = &get_temporary_allocator();
     
@@ -1410,6 +1410,7 @@ namespace pixc::reflection::compiler {
 
             fprintf(f, "%s.component_id = %i;\n", component, id);
             fprintf(f, "%s.type = get_%s_type();\n", component, name.full);
+            fprintf(f, "%s.alignment = alignof(%s);\n", component, name.type);
             if ((type->flags & ENTITY_FLAG_TAG) == ENTITY_FLAG_TAG) {
                 fprintf(f, "%s.kind = FLAG_COMPONENT;\n", component);
                 continue;
@@ -2021,8 +2022,8 @@ int main(int argc, const char** c_args) {
 	LinearAllocator& permanent_allocator = get_thread_local_permanent_allocator(); 
 	LinearAllocator& temporary_allocator = get_thread_local_temporary_allocator();
 	
-	permanent_allocator = LinearAllocator(mb(10));
-	temporary_allocator = LinearAllocator(mb(10));
+	permanent_allocator = LinearAllocator(LINEAR_VIRTUAL, gb(1));
+	temporary_allocator = LinearAllocator(LINEAR_VIRTUAL, gb(1));
 
 	Context context;
 	context.temporary_allocator = &get_thread_local_temporary_allocator();
@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "bowWeapon.h"
 #include <ecs/ecs.h>
+#include <ecs/command_buffer.h>
 #include "playerInput.h"
 #include "physics/physics.h"
 #include "components/transform.h"
@@ -135,11 +136,14 @@ glm::quat quat_look_rotation(glm::vec3 direction, glm::vec3 upDirection) {
 void update_bows(World& world, UpdateCtx& params) {
 	PlayerInput* input = get_player_input(world);
 
+	//Expired arrows are freed after the loop, freeing moves another entity into their slot while it is iterated
+	EntityCommandBuffer despawned;
+
 	for (auto[e, trans, local, rb, arrow] : world.filter<Transform, LocalTransform, RigidBody, Arrow>(params.layermask)) {
 		if (arrow.state == Arrow::Fired) {
 			arrow.duration -= params.delta_time;
 			if (arrow.duration <= 0) {
-				world.free_by_id(e.id);
+				despawned.free(e.id);
 			}
 			else {
 				glm::mat4 rot = glm::lookAt(glm::vec3(0, 0, 0), glm::normalize(rb.velocity), glm::vec3(0, 1, 0));
@@ -149,6 +153,8 @@ void update_bows(World& world, UpdateCtx& params) {
 		}
 	}
 
+	playback(world, despawned);
+
 	for (auto[e, trans, local, bow] : world.filter<Transform, LocalTransform, Bow>(params.layermask)) {
 		auto camera_components = world.get_by_id<LocalTransform, Transform>(local.owner);
 		if (!camera_components) continue;
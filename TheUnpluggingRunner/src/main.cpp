@@ -83,8 +83,8 @@ void job_system_test_main() {
 
 void init_workers(void*) {
     printf("Initialized worker %i\n", get_worker_id());
-    get_thread_local_permanent_allocator() = LinearAllocator(mb(10));
-    get_thread_local_temporary_allocator() = LinearAllocator(mb(100));
+    get_thread_local_permanent_allocator() = LinearAllocator(LINEAR_VIRTUAL, gb(1));
+    get_thread_local_temporary_allocator() = LinearAllocator(LINEAR_VIRTUAL, gb(4));
 
     Context& ctx = get_context();
     ctx.allocator = &default_allocator;
@@ -97,8 +97,8 @@ void fiber_main(void* data) {
 	LinearAllocator& permanent_allocator = get_thread_local_permanent_allocator(); 
 	LinearAllocator& temporary_allocator = get_thread_local_temporary_allocator();
 
-	permanent_allocator = LinearAllocator(mb(200));
-	temporary_allocator = LinearAllocator(mb(200));
+	permanent_allocator = LinearAllocator(LINEAR_VIRTUAL, gb(4));
+	temporary_allocator = LinearAllocator(LINEAR_VIRTUAL, gb(4));
 
 	Context& context = get_context();
 	context.temporary_allocator = &get_thread_local_temporary_allocator();
@@ -87,6 +87,9 @@ function default_config()
     filter "system:macosx"
         defines "NE_PLATFORM_MACOSX"
 
+    filter "system:linux"
+        defines "NE_PLATFORM_LINUX"
+
     filter "configurations:Debug"
         defines "NE_DEBUG"
         symbols "On"
@@ -152,6 +155,122 @@ project "ReflectionTool"
 	default_config()
 	set_rpath()
 
+project "JobBenchmark"
+	location "JobBenchmark"
+	kind "ConsoleApp"
+
+	includedirs {
+		"NextCore/include",
+	}
+
+	if os.istarget("macosx") then
+	    postbuildcommands {
+	        "cp ../bin/" .. outputdir .. "/NextCore/libNextCore.dylib ../bin/" .. outputdir .. "/%{prj.name}/libNextCore.dylib",
+        }
+	else
+		postbuildcommands {
+			"{COPY} ../bin/" .. outputdir .. "/NextCore/NextCore.dll ../bin/" .. outputdir .. "/%{prj.name}",
+        }
+    end
+
+	links 
+	{
+		"NextCore",
+	}
+
+	-- bin/<config>/JobBenchmark/JobBenchmark --scaling --out job_benchmark.json
+
+	default_config()
+	set_rpath()
+
+project "ContainerBenchmark"
+	location "ContainerBenchmark"
+	kind "ConsoleApp"
+
+	includedirs {
+		"NextCore/include",
+	}
+
+	if os.istarget("macosx") then
+	    postbuildcommands {
+	        "cp ../bin/" .. outputdir .. "/NextCore/libNextCore.dylib ../bin/" .. outputdir .. "/%{prj.name}/libNextCore.dylib",
+        }
+	else
+		postbuildcommands {
+			"{COPY} ../bin/" .. outputdir .. "/NextCore/NextCore.dll ../bin/" .. outputdir .. "/%{prj.name}",
+        }
+    end
+
+	links 
+	{
+		"NextCore",
+	}
+
+	-- bin/<config>/ContainerBenchmark/ContainerBenchmark --out container_benchmark.json
+
+	default_config()
+	set_rpath()
+
+project "MathBenchmark"
+	location "MathBenchmark"
+	kind "ConsoleApp"
+
+	includedirs {
+		"NextCore/include",
+	}
+
+	if os.istarget("macosx") then
+	    postbuildcommands {
+	        "cp ../bin/" .. outputdir .. "/NextCore/libNextCore.dylib ../bin/" .. outputdir .. "/%{prj.name}/libNextCore.dylib",
+        }
+	else
+		postbuildcommands {
+			"{COPY} ../bin/" .. outputdir .. "/NextCore/NextCore.dll ../bin/" .. outputdir .. "/%{prj.name}",
+        }
+    end
+
+	links 
+	{
+		"NextCore",
+	}
+
+	-- bin/<config>/MathBenchmark/MathBenchmark --out math_benchmark.json
+
+	default_config()
+	set_rpath()
+
+project "NextTests"
+	location "NextTests"
+	kind "ConsoleApp"
+
+	includedirs {
+		"NextEngine/include",
+		"NextCore/include",
+	}
+
+	if os.istarget("macosx") then
+	    postbuildcommands {
+	        "cp ../bin/" .. outputdir .. "/NextCore/libNextCore.dylib ../bin/" .. outputdir .. "/%{prj.name}/libNextCore.dylib",
+	        "cp ../bin/" .. outputdir .. "/NextEngine/libNextEngine.dylib ../bin/" .. outputdir .. "/%{prj.name}/libNextEngine.dylib",
+        }
+	else
+		postbuildcommands {
+			"{COPY} ../bin/" .. outputdir .. "/NextCore/NextCore.dll ../bin/" .. outputdir .. "/%{prj.name}",
+			"{COPY} ../bin/" .. outputdir .. "/NextEngine/NextEngine.dll ../bin/" .. outputdir .. "/%{prj.name}",
+        }
+    end
+
+	links 
+	{
+		"NextCore",
+		"NextEngine",
+	}
+
+	-- bin/<config>/NextTests/NextTests [name], exits with the number of failed tests
+
+	default_config()
+	set_rpath()
+
 VULKAN_SDK = os.getenv("VULKAN_SDK")
 
 project "NextEngine"